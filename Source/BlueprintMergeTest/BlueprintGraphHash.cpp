@@ -0,0 +1,440 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintGraphHash.h"
+#include "BlueprintMergePath.h"
+#include "BlueprintPropertySchema.h"
+#include "EdGraph/EdGraph.h"
+#include "EdGraph/EdGraphNode.h"
+#include "EdGraph/EdGraphPin.h"
+#include "Misc/ScopeLock.h"
+#include "UObject/Package.h"
+
+
+namespace
+{
+	template<typename ValueType>
+	void UpdateValue(FXxHash64Builder& Builder, const ValueType& Value)
+	{
+		Builder.Update(&Value, sizeof(ValueType));
+	}
+
+	void UpdateName(FXxHash64Builder& Builder, const FName& Name)
+	{
+		// FName の比較は大文字小文字を区別しないので、比較用のインデックスを使う
+		UpdateValue(Builder, GetTypeHash(Name));
+	}
+
+	void UpdateString(FXxHash64Builder& Builder, const FString& String)
+	{
+		// FString の比較は大文字小文字を区別しない
+		const FString LowerString = String.ToLower();
+		Builder.Update(*LowerString, LowerString.Len() * sizeof(TCHAR));
+		UpdateValue(Builder, LowerString.Len());
+	}
+
+	void UpdateExactString(FXxHash64Builder& Builder, const FString& String)
+	{
+		Builder.Update(*String, String.Len() * sizeof(TCHAR));
+		UpdateValue(Builder, String.Len());
+	}
+
+	// テキストは、表示用の文字列ではなくソースの文字列とローカライズの名前空間・キーでハッシュする
+	// UBlueprintMergeLibrary::IdenticalTexts と同じ比較になるようにする
+	void UpdateText(FXxHash64Builder& Builder, const FText& Text)
+	{
+		const FString* SourceString = FTextInspector::GetSourceString(Text);
+		UpdateExactString(Builder, SourceString ? *SourceString : FString());
+		UpdateExactString(Builder, FTextInspector::GetNamespace(Text).Get(FString()));
+		UpdateExactString(Builder, FTextInspector::GetKey(Text).Get(FString()));
+		UpdateValue(Builder, Text.IsCultureInvariant());
+	}
+
+	// プロパティのパスは、テーブルに依存しない構造のハッシュを使う
+	void UpdatePath(FXxHash64Builder& Builder, const FName& Path)
+	{
+		UpdateValue(Builder, FBlueprintMergePathTable::HashPath(Path));
+	}
+
+	// ハッシュの計算 (グラフ全体やノード) ごとに 1 つのパスのテーブルを使う
+	// マージの外から呼ばれた場合も、パスをテーブルに登録してハッシュが変わらないようにする
+	// 既に現在のテーブルがある場合 (マージ中や、グラフのハッシュの中のノード) はそれを使う
+	class FHashPathScope
+	{
+	public:
+		FHashPathScope()
+		{
+			if (!FBlueprintMergePathTable::GetCurrent())
+			{
+				LocalPaths.Emplace();
+				PathScope.Emplace(&LocalPaths.GetValue());
+			}
+		}
+
+	private:
+		TOptional<FBlueprintMergePathTable> LocalPaths;
+		TOptional<FBlueprintMergePathTable::FScope> PathScope;
+	};
+}
+
+uint64 FBlueprintGraphHash::HashGraph(const UEdGraph* Graph)
+{
+	if (!Graph)
+	{
+		return 0;
+	}
+
+	FBlueprintGraphHashCache& Cache = FBlueprintGraphHashCache::Get();
+
+	uint64 Hash = 0;
+	if (Cache.Find(Graph, Hash))
+	{
+		return Hash;
+	}
+
+	Hash = ComputeGraphHash(Graph);
+	Cache.Add(Graph, Hash);
+	return Hash;
+}
+
+uint64 FBlueprintGraphHash::ComputeGraphHash(const UEdGraph* Graph)
+{
+	if (!Graph)
+	{
+		return 0;
+	}
+
+	FHashPathScope PathScope;
+
+	FXxHash64Builder Builder;
+	UpdateObjectProperties(Builder, Graph, Graph->GetOutermostObject());
+
+	// ノードは名前で対応付けるので、並び順に依存しないように名前順でハッシュする
+	TArray<TPair<FName, uint64>, TInlineAllocator<64>> NodeHashes;
+	NodeHashes.Reserve(Graph->Nodes.Num());
+	for (const UEdGraphNode* Node : Graph->Nodes)
+	{
+		if (Node)
+		{
+			NodeHashes.Emplace(Node->GetFName(), HashNode(Node));
+		}
+	}
+	NodeHashes.Sort([](const TPair<FName, uint64>& A, const TPair<FName, uint64>& B)
+	{
+		return A.Key.FastLess(B.Key);
+	});
+
+	for (const TPair<FName, uint64>& NodeHash : NodeHashes)
+	{
+		UpdateName(Builder, NodeHash.Key);
+		UpdateValue(Builder, NodeHash.Value);
+	}
+
+	// リンクはノードのハッシュに含めないので、グラフのハッシュに加える
+	TArray<uint64, TInlineAllocator<64>> LinkHashes;
+	for (const UEdGraphNode* Node : Graph->Nodes)
+	{
+		if (!Node)
+		{
+			continue;
+		}
+
+		for (const UEdGraphPin* Pin : Node->Pins)
+		{
+			if (Pin && Pin->Direction == EGPD_Output)
+			{
+				for (const UEdGraphPin* LinkedPin : Pin->LinkedTo)
+				{
+					LinkHashes.Add(HashLink(Pin, LinkedPin));
+				}
+			}
+		}
+	}
+	LinkHashes.Sort();
+
+	UpdateValue(Builder, LinkHashes.Num());
+	for (const uint64 LinkHash : LinkHashes)
+	{
+		UpdateValue(Builder, LinkHash);
+	}
+	return Builder.Finalize().Hash;
+}
+
+uint64 FBlueprintGraphHash::HashNode(const UEdGraphNode* Node)
+{
+	if (!Node)
+	{
+		return 0;
+	}
+
+	FHashPathScope PathScope;
+
+	FXxHash64Builder Builder;
+	UpdateValue(Builder, Node->GetClass());
+	UpdateObjectProperties(Builder, Node, Node->GetOutermostObject());
+
+	// ピンも名前で対応付けるので、名前順でハッシュする
+	TArray<TPair<FName, uint64>, TInlineAllocator<16>> PinHashes;
+	PinHashes.Reserve(Node->Pins.Num());
+	for (const UEdGraphPin* Pin : Node->Pins)
+	{
+		if (Pin)
+		{
+			PinHashes.Emplace(Pin->PinName, HashPin(Pin));
+		}
+	}
+	PinHashes.Sort([](const TPair<FName, uint64>& A, const TPair<FName, uint64>& B)
+	{
+		return A.Key.FastLess(B.Key);
+	});
+
+	for (const TPair<FName, uint64>& PinHash : PinHashes)
+	{
+		UpdateName(Builder, PinHash.Key);
+		UpdateValue(Builder, PinHash.Value);
+	}
+	return Builder.Finalize().Hash;
+}
+
+uint64 FBlueprintGraphHash::HashPin(const UEdGraphPin* Pin)
+{
+	if (!Pin)
+	{
+		return 0;
+	}
+
+	const UObject* Root = Pin->GetOwningNode() ? Pin->GetOwningNode()->GetOutermostObject() : nullptr;
+
+	// ピンの識別情報と型 (PinId は GUID なので含めない)
+	FXxHash64Builder Builder;
+	UpdateName(Builder, Pin->PinName);
+	UpdateValue(Builder, Pin->Direction);
+
+	const FEdGraphPinType& PinType = Pin->PinType;
+	UpdateName(Builder, PinType.PinCategory);
+	UpdateName(Builder, PinType.PinSubCategory);
+	UpdateObjectReference(Builder, PinType.PinSubCategoryObject.Get(), Root);
+	UpdateValue(Builder, PinType.ContainerType);
+	UpdateValue(Builder, PinType.bIsReference);
+	UpdateValue(Builder, PinType.bIsConst);
+	UpdateValue(Builder, PinType.bIsWeakPointer);
+	UpdateName(Builder, PinType.PinValueType.TerminalCategory);
+	UpdateName(Builder, PinType.PinValueType.TerminalSubCategory);
+	UpdateObjectReference(Builder, PinType.PinValueType.TerminalSubCategoryObject.Get(), Root);
+
+	// 既定値 (文字列は大文字小文字を区別する)
+	UpdateExactString(Builder, Pin->DefaultValue);
+	UpdateObjectReference(Builder, Pin->DefaultObject, Root);
+	UpdateText(Builder, Pin->DefaultTextValue);
+	return Builder.Finalize().Hash;
+}
+
+uint64 FBlueprintGraphHash::HashLink(const UEdGraphPin* OutputPin, const UEdGraphPin* InputPin)
+{
+	// ノードはグラフの中で名前で対応付けるので、(ノードの名前, ピンの名前) の組でハッシュする
+	auto UpdateEndpoint = [](FXxHash64Builder& Builder, const UEdGraphPin* Pin)
+	{
+		const UEdGraphNode* Node = Pin ? Pin->GetOwningNodeUnchecked() : nullptr;
+		UpdateName(Builder, Node ? Node->GetFName() : NAME_None);
+		UpdateName(Builder, Pin ? Pin->PinName : NAME_None);
+	};
+
+	FXxHash64Builder Builder;
+	UpdateEndpoint(Builder, OutputPin);
+	UpdateEndpoint(Builder, InputPin);
+	return Builder.Finalize().Hash;
+}
+
+uint64 FBlueprintGraphHash::HashGraphProperties(const UEdGraph* Graph)
+{
+	if (!Graph)
+	{
+		return 0;
+	}
+
+	FHashPathScope PathScope;
+
+	FXxHash64Builder Builder;
+	static const FName NodesName(TEXT("Nodes"));
+	UpdateObjectProperties(Builder, Graph, Graph->GetOutermostObject(), NodesName);
+	return Builder.Finalize().Hash;
+}
+
+void FBlueprintGraphHash::UpdateObjectProperties(FXxHash64Builder& Builder, const UObject* Object, const UObject* Root, const FName& ExcludedRootName)
+{
+	// パスのテーブルは呼び出し元 (FHashPathScope) で用意する
+	check(FBlueprintMergePathTable::GetCurrent());
+
+	TSharedRef<const FBlueprintPropertySchema> Schema = FBlueprintPropertySchemaCache::Get().FindOrAdd(Object->GetClass());
+	const TArray<FBlueprintPropertySchemaEntry>& Entries = Schema->GetEntries();
+	Schema->ForEachValue(Object, false, [&Builder, &Entries, Root, &ExcludedRootName](const FName& Path, const FProperty* Property, const void* Value, int32 EntryIndex)
+	{
+		// GUIDは自動生成されるため比較しない
+		// スキーマのエントリは事前に求めた印を使い、動的なコンテナの要素だけパスの文字列で調べる
+		if (EntryIndex != INDEX_NONE ? Entries[EntryIndex].bIsGuid : IsGuidPath(Path))
+		{
+			return;
+		}
+
+		if (!ExcludedRootName.IsNone() && FBlueprintMergePathTable::GetRootName(Path) == ExcludedRootName)
+		{
+			return;
+		}
+
+		UpdatePath(Builder, Path);
+		UpdatePropertyValue(Builder, Property, Value, Root);
+	});
+}
+
+void FBlueprintGraphHash::UpdatePropertyValue(FXxHash64Builder& Builder, const FProperty* Property, const void* Value, const UObject* Root)
+{
+	if (const FBoolProperty* BoolProperty = CastField<FBoolProperty>(Property))
+	{
+		UpdateValue(Builder, BoolProperty->GetPropertyValue(Value));
+	}
+	else if (const FFloatProperty* FloatProperty = CastField<FFloatProperty>(Property))
+	{
+		// -0 と +0 は等しいので揃える
+		const float FloatValue = FloatProperty->GetPropertyValue(Value);
+		UpdateValue(Builder, FloatValue == 0.0f ? 0.0f : FloatValue);
+	}
+	else if (const FDoubleProperty* DoubleProperty = CastField<FDoubleProperty>(Property))
+	{
+		const double DoubleValue = DoubleProperty->GetPropertyValue(Value);
+		UpdateValue(Builder, DoubleValue == 0.0 ? 0.0 : DoubleValue);
+	}
+	else if (Property->IsA<FNumericProperty>() || Property->IsA<FEnumProperty>())
+	{
+		Builder.Update(Value, Property->GetElementSize());
+	}
+	else if (const FNameProperty* NameProperty = CastField<FNameProperty>(Property))
+	{
+		UpdateName(Builder, NameProperty->GetPropertyValue(Value));
+	}
+	else if (const FStrProperty* StrProperty = CastField<FStrProperty>(Property))
+	{
+		UpdateString(Builder, StrProperty->GetPropertyValue(Value));
+	}
+	else if (const FTextProperty* TextProperty = CastField<FTextProperty>(Property))
+	{
+		UpdateText(Builder, TextProperty->GetPropertyValue(Value));
+	}
+	else if (const FSoftObjectProperty* SoftObjectProperty = CastField<FSoftObjectProperty>(Property))
+	{
+		// 読み込みを発生させないように、パスでハッシュする
+		UpdateValue(Builder, GetTypeHash(SoftObjectProperty->GetPropertyValue(Value).ToSoftObjectPath()));
+	}
+	else if (const FObjectPropertyBase* ObjectProperty = CastField<FObjectPropertyBase>(Property))
+	{
+		UpdateObjectReference(Builder, ObjectProperty->GetObjectPropertyValue(Value), Root);
+	}
+	else if (Property->HasAllPropertyFlags(CPF_HasGetValueTypeHash))
+	{
+		UpdateValue(Builder, Property->GetValueTypeHash(Value));
+	}
+	else
+	{
+		// ハッシュ関数を持たないプロパティは文字列化してハッシュする
+		FString ValueString;
+		Property->ExportTextItem_Direct(ValueString, Value, nullptr, nullptr, PPF_None);
+		UpdateString(Builder, ValueString);
+	}
+}
+
+void FBlueprintGraphHash::UpdateObjectReference(FXxHash64Builder& Builder, const UObject* Object, const UObject* Root)
+{
+	if (!Object)
+	{
+		UpdateValue(Builder, uint32(0));
+		return;
+	}
+
+	if (!Root || Object->GetOutermostObject() != Root)
+	{
+		// 外部のオブジェクトは同じオブジェクトを指しているか
+		UpdateValue(Builder, GetTypeHash(FSoftObjectPath(Object)));
+		return;
+	}
+
+	// パッケージ内のオブジェクトは、アセットからの相対パスでハッシュする
+	// アセット名は Base / Left / Right で異なるので、最上位のオブジェクトは種類だけを使う
+	for (const UObject* Current = Object; Current && Current != Root; Current = Current->GetOuter())
+	{
+		if (Current->GetOuter() == Root)
+		{
+			const uint32 TopLevelKind = Current->IsA<UClass>() ? 1 : Current->HasAnyFlags(RF_ClassDefaultObject) ? 2 : 3;
+			UpdateValue(Builder, TopLevelKind);
+			break;
+		}
+		UpdateName(Builder, Current->GetFName());
+	}
+}
+
+bool FBlueprintGraphHash::IsGuidPath(const FName& Path)
+{
+	return FBlueprintMergePathTable::PathContains(Path, TEXT("GUID"));
+}
+
+FBlueprintGraphHashCache& FBlueprintGraphHashCache::Get()
+{
+	static FBlueprintGraphHashCache Instance;
+	return Instance;
+}
+
+bool FBlueprintGraphHashCache::IsCacheable(const UPackage* Package)
+{
+	// 編集中のパッケージや一時的なパッケージは内容が変わるのでキャッシュしない
+	return Package &&
+		Package != GetTransientPackage() &&
+		!Package->HasAnyFlags(RF_Transient) &&
+		!Package->IsDirty() &&
+		!Package->GetSavedHash().IsZero();
+}
+
+bool FBlueprintGraphHashCache::Find(const UEdGraph* Graph, uint64& OutHash)
+{
+	const UPackage* Package = Graph->GetPackage();
+	if (!IsCacheable(Package))
+	{
+		return false;
+	}
+
+	FScopeLock Lock(&CriticalSection);
+	const FPackageEntry* Entry = Packages.Find(Package->GetFName());
+	if (!Entry || Entry->SavedHash != Package->GetSavedHash())
+	{
+		return false;
+	}
+
+	if (const uint64* Hash = Entry->GraphHashes.Find(FObjectKey(Graph)))
+	{
+		OutHash = *Hash;
+		return true;
+	}
+	return false;
+}
+
+void FBlueprintGraphHashCache::Add(const UEdGraph* Graph, uint64 Hash)
+{
+	const UPackage* Package = Graph->GetPackage();
+	if (!IsCacheable(Package))
+	{
+		return;
+	}
+
+	FScopeLock Lock(&CriticalSection);
+	FPackageEntry& Entry = Packages.FindOrAdd(Package->GetFName());
+	if (Entry.SavedHash != Package->GetSavedHash())
+	{
+		// パッケージが保存し直されたので、古いハッシュは捨てる
+		Entry.SavedHash = Package->GetSavedHash();
+		Entry.GraphHashes.Reset();
+	}
+	Entry.GraphHashes.Add(FObjectKey(Graph), Hash);
+}
+
+void FBlueprintGraphHashCache::Empty()
+{
+	FScopeLock Lock(&CriticalSection);
+	Packages.Empty();
+}
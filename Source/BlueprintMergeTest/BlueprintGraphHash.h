@@ -0,0 +1,78 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Hash/xxhash.h"
+#include "IO/IoHash.h"
+#include "UObject/ObjectKey.h"
+
+class UEdGraph;
+class UEdGraphNode;
+class UEdGraphPin;
+
+// グラフ・ノード・ピンの内容のハッシュ
+// グラフのハッシュはノードとリンクのハッシュから、ノードのハッシュはプロパティとピンのハッシュから作る
+// GUID は自動生成されるため、パスに GUID を含むプロパティはハッシュに含めない
+class FBlueprintGraphHash
+{
+public:
+	// グラフのハッシュ (変更されていないパッケージのグラフはキャッシュを使う)
+	static uint64 HashGraph(const UEdGraph* Graph);
+
+	// キャッシュを使わずにグラフのハッシュを計算する
+	static uint64 ComputeGraphHash(const UEdGraph* Graph);
+
+	// グラフ自身のプロパティのハッシュ (ノードの一覧は含めない)
+	static uint64 HashGraphProperties(const UEdGraph* Graph);
+
+	// ノードのハッシュ (ピンのリンクは含めない)
+	static uint64 HashNode(const UEdGraphNode* Node);
+
+	// ピンの名前・型・既定値のハッシュ
+	static uint64 HashPin(const UEdGraphPin* Pin);
+
+	// 出力ピンから入力ピンへのリンクのハッシュ (両端のノードの名前とピンの名前)
+	static uint64 HashLink(const UEdGraphPin* OutputPin, const UEdGraphPin* InputPin);
+
+private:
+	// オブジェクトのプロパティをハッシュに加える
+	// ExcludedRootName から始まるパスのプロパティは含めない
+	static void UpdateObjectProperties(FXxHash64Builder& Builder, const UObject* Object, const UObject* Root, const FName& ExcludedRootName = NAME_None);
+
+	// プロパティの値をハッシュに加える
+	static void UpdatePropertyValue(FXxHash64Builder& Builder, const FProperty* Property, const void* Value, const UObject* Root);
+
+	// オブジェクトの参照をハッシュに加える
+	// Root (パッケージ) の中のオブジェクトは、アセットからの相対パスでハッシュする
+	static void UpdateObjectReference(FXxHash64Builder& Builder, const UObject* Object, const UObject* Root);
+
+	static bool IsGuidPath(const FName& Path);
+};
+
+// グラフのハッシュのパッケージごとのキャッシュ
+// 保存されたまま変更されていないパッケージのグラフだけをキャッシュする
+class FBlueprintGraphHashCache
+{
+public:
+	static FBlueprintGraphHashCache& Get();
+
+	// キャッシュがあればハッシュを返す
+	bool Find(const UEdGraph* Graph, uint64& OutHash);
+	void Add(const UEdGraph* Graph, uint64 Hash);
+
+	void Empty();
+
+private:
+	// キャッシュできるパッケージか
+	static bool IsCacheable(const UPackage* Package);
+
+	struct FPackageEntry
+	{
+		FIoHash SavedHash;
+		TMap<FObjectKey, uint64> GraphHashes;
+	};
+
+	FCriticalSection CriticalSection;
+	TMap<FName, FPackageEntry> Packages;
+};
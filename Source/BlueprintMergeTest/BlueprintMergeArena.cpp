@@ -0,0 +1,181 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeArena.h"
+#include "BlueprintMergeStats.h"
+#include <atomic>
+
+
+namespace
+{
+	// ブロックの大きさに対して大きすぎる確保は、専用のブロックにする
+	constexpr SIZE_T LargeAllocationDivisor = 4;
+
+	constexpr uint32 MinAlignment = 16;
+
+	thread_local FMergeArena* CurrentArena = nullptr;
+
+	std::atomic<SIZE_T> PeakHighWaterMark = 0;
+	std::atomic<SIZE_T> PeakReservedBytes = 0;
+
+	void UpdatePeak(std::atomic<SIZE_T>& Peak, SIZE_T Value)
+	{
+		SIZE_T Current = Peak.load(std::memory_order_relaxed);
+		while (Current < Value && !Peak.compare_exchange_weak(Current, Value, std::memory_order_relaxed))
+		{
+		}
+	}
+}
+
+FMergeArena::FMergeArena(SIZE_T InBlockSize)
+	: BlockSize(InBlockSize)
+{
+}
+
+FMergeArena::~FMergeArena()
+{
+	Reset();
+}
+
+void* FMergeArena::Allocate(SIZE_T Size, uint32 Alignment)
+{
+	Alignment = FMath::Max(Alignment, MinAlignment);
+
+	uint8* Result = Cursor ? Align(Cursor, Alignment) : nullptr;
+	if (!Result || Result + Size > BlockEnd)
+	{
+		if (Size > BlockSize / LargeAllocationDivisor)
+		{
+			// 現在のブロックの残りを無駄にしないように、カーソルは動かさない
+			Result = AllocateBlock(Size, Alignment);
+			UsedBytes += Size;
+			return Result;
+		}
+
+		BlockBegin = AllocateBlock(BlockSize, Alignment);
+		BlockEnd = BlockBegin + BlockSize;
+		Result = BlockBegin;
+	}
+
+	Cursor = Result + Size;
+	UsedBytes += Size;
+	return Result;
+}
+
+void* FMergeArena::Reallocate(void* Old, SIZE_T OldSize, SIZE_T CopySize, SIZE_T NewSize, uint32 Alignment)
+{
+	uint8* OldBytes = static_cast<uint8*>(Old);
+	if (OldBytes && OldBytes >= BlockBegin && OldBytes + OldSize == Cursor && OldBytes + NewSize <= BlockEnd)
+	{
+		Cursor = OldBytes + NewSize;
+		UsedBytes = UsedBytes - OldSize + NewSize;
+		return Old;
+	}
+
+	void* Result = Allocate(NewSize, Alignment);
+	if (OldBytes && CopySize > 0)
+	{
+		FMemory::Memcpy(Result, Old, FMath::Min(CopySize, NewSize));
+	}
+	return Result;
+}
+
+void FMergeArena::Reset()
+{
+	HighWaterMark = GetHighWaterMark();
+	UpdatePeak(PeakHighWaterMark, HighWaterMark);
+	UpdatePeak(PeakReservedBytes, ReservedBytes);
+
+	for (void* Block : Blocks)
+	{
+		FMemory::Free(Block);
+	}
+	Blocks.Reset();
+
+	BlockBegin = nullptr;
+	BlockEnd = nullptr;
+	Cursor = nullptr;
+	UsedBytes = 0;
+	ReservedBytes = 0;
+}
+
+uint8* FMergeArena::AllocateBlock(SIZE_T Size, uint32 Alignment)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(ArenaBlocks, 1);
+
+	void* Block = FMemory::Malloc(Size, Alignment);
+	Blocks.Add(Block);
+	ReservedBytes += Size;
+	return static_cast<uint8*>(Block);
+}
+
+SIZE_T FMergeArena::GetPeakHighWaterMark()
+{
+	return PeakHighWaterMark.load(std::memory_order_relaxed);
+}
+
+SIZE_T FMergeArena::GetPeakReservedBytes()
+{
+	return PeakReservedBytes.load(std::memory_order_relaxed);
+}
+
+void FMergeArena::ResetPeak()
+{
+	PeakHighWaterMark.store(0, std::memory_order_relaxed);
+	PeakReservedBytes.store(0, std::memory_order_relaxed);
+}
+
+FMergeArena* FMergeArena::GetCurrent()
+{
+	return CurrentArena;
+}
+
+FMergeArena::FScope::FScope(FMergeArena* Arena)
+{
+	if (Arena)
+	{
+		PreviousArena = CurrentArena;
+		CurrentArena = Arena;
+		bActive = true;
+	}
+}
+
+FMergeArena::FScope::~FScope()
+{
+	if (bActive)
+	{
+		CurrentArena = PreviousArena;
+	}
+}
+
+void FMergeArenaAllocator::ForAnyElementType::ResizeAllocation(SizeType CurrentNum, SizeType NewMax, SIZE_T NumBytesPerElement, uint32 AlignmentOfElement)
+{
+	// 確保先は最初の確保の時点で決める
+	if (!Data)
+	{
+		Arena = FMergeArena::GetCurrent();
+	}
+
+	const SIZE_T NewBytes = SIZE_T(NewMax) * NumBytesPerElement;
+	if (!Arena)
+	{
+		if (Data || NewMax > 0)
+		{
+			Data = static_cast<FScriptContainerElement*>(FMemory::Realloc(Data, NewBytes, AlignmentOfElement));
+		}
+		AllocatedBytes = NewBytes;
+		return;
+	}
+
+	if (NewMax == 0)
+	{
+		// アリーナの領域は個別に解放しない
+		Data = nullptr;
+		Arena = nullptr;
+		AllocatedBytes = 0;
+		return;
+	}
+
+	Data = static_cast<FScriptContainerElement*>(Arena->Reallocate(Data, AllocatedBytes, SIZE_T(CurrentNum) * NumBytesPerElement, NewBytes, AlignmentOfElement));
+	AllocatedBytes = NewBytes;
+}
@@ -0,0 +1,218 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// マージごとの線形アロケータ
+// 一時的なマップや配列の確保を先頭から詰めて行い、個別には解放しない
+// 破棄 (または Reset) でブロックをまとめて解放する
+// 1 つのスレッドからだけ使うこと
+class FMergeArena
+{
+public:
+	explicit FMergeArena(SIZE_T InBlockSize = 64 * 1024);
+	~FMergeArena();
+
+	FMergeArena(const FMergeArena&) = delete;
+	FMergeArena& operator=(const FMergeArena&) = delete;
+
+	void* Allocate(SIZE_T Size, uint32 Alignment);
+
+	// 最後に確保した領域はその場で伸縮し、それ以外は新しい領域に CopySize バイトをコピーする
+	void* Reallocate(void* Old, SIZE_T OldSize, SIZE_T CopySize, SIZE_T NewSize, uint32 Alignment);
+
+	// 全てのブロックを解放する (確保した領域を使っているコンテナがないこと)
+	void Reset();
+
+	// 確保したバイト数
+	SIZE_T GetUsedBytes() const
+	{
+		return UsedBytes;
+	}
+
+	// 確保したバイト数の最大値 (Reset をまたいで保持する)
+	SIZE_T GetHighWaterMark() const
+	{
+		return FMath::Max(HighWaterMark, UsedBytes);
+	}
+
+	// ブロックとして確保したバイト数
+	SIZE_T GetReservedBytes() const
+	{
+		return ReservedBytes;
+	}
+
+	// 全てのアリーナの、Reset (破棄) までの確保したバイト数とブロックの最大値
+	// 解析ごとのアリーナは外から見えないので、ベンチマークはこちらを読む
+	static SIZE_T GetPeakHighWaterMark();
+	static SIZE_T GetPeakReservedBytes();
+	static void ResetPeak();
+
+	// 現在のスレッドのアリーナ (なければ nullptr)
+	static FMergeArena* GetCurrent();
+
+	// スコープの間、現在のスレッドのアリーナを切り替える
+	// nullptr を指定した場合は何もしない
+	class FScope
+	{
+	public:
+		explicit FScope(FMergeArena* Arena);
+		~FScope();
+
+		FScope(const FScope&) = delete;
+		FScope& operator=(const FScope&) = delete;
+
+	private:
+		FMergeArena* PreviousArena = nullptr;
+		bool bActive = false;
+	};
+
+private:
+	uint8* AllocateBlock(SIZE_T Size, uint32 Alignment);
+
+	SIZE_T BlockSize = 0;
+	TArray<void*> Blocks;
+
+	// 現在のブロックの範囲と、次に確保する位置
+	uint8* BlockBegin = nullptr;
+	uint8* BlockEnd = nullptr;
+	uint8* Cursor = nullptr;
+
+	SIZE_T UsedBytes = 0;
+	SIZE_T HighWaterMark = 0;
+	SIZE_T ReservedBytes = 0;
+};
+
+// FMergeArena から確保するコンテナのアロケータ
+// 最初の確保で現在のアリーナを使い、アリーナがなければヒープから確保する
+// アリーナから確保したコンテナは、アリーナより先に破棄すること
+class FMergeArenaAllocator
+{
+public:
+	using SizeType = int32;
+
+	enum { NeedsElementType = false };
+	enum { RequireRangeCheck = true };
+
+	class ForAnyElementType
+	{
+	public:
+		ForAnyElementType() = default;
+
+		ForAnyElementType(const ForAnyElementType&) = delete;
+		ForAnyElementType& operator=(const ForAnyElementType&) = delete;
+
+		~ForAnyElementType()
+		{
+			if (Data && !Arena)
+			{
+				FMemory::Free(Data);
+			}
+		}
+
+		void MoveToEmpty(ForAnyElementType& Other)
+		{
+			checkSlow(this != &Other);
+
+			if (Data && !Arena)
+			{
+				FMemory::Free(Data);
+			}
+
+			Data = Other.Data;
+			Arena = Other.Arena;
+			AllocatedBytes = Other.AllocatedBytes;
+			Other.Data = nullptr;
+			Other.Arena = nullptr;
+			Other.AllocatedBytes = 0;
+		}
+
+		FScriptContainerElement* GetAllocation() const
+		{
+			return Data;
+		}
+
+		void ResizeAllocation(SizeType CurrentNum, SizeType NewMax, SIZE_T NumBytesPerElement)
+		{
+			ResizeAllocation(CurrentNum, NewMax, NumBytesPerElement, DEFAULT_ALIGNMENT);
+		}
+
+		void ResizeAllocation(SizeType CurrentNum, SizeType NewMax, SIZE_T NumBytesPerElement, uint32 AlignmentOfElement);
+
+		SizeType CalculateSlackReserve(SizeType NewMax, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackReserve(NewMax, NumBytesPerElement, false);
+		}
+
+		SizeType CalculateSlackReserve(SizeType NewMax, SIZE_T NumBytesPerElement, uint32 AlignmentOfElement) const
+		{
+			return DefaultCalculateSlackReserve(NewMax, NumBytesPerElement, false, AlignmentOfElement);
+		}
+
+		SizeType CalculateSlackShrink(SizeType NewMax, SizeType CurrentMax, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackShrink(NewMax, CurrentMax, NumBytesPerElement, false);
+		}
+
+		SizeType CalculateSlackShrink(SizeType NewMax, SizeType CurrentMax, SIZE_T NumBytesPerElement, uint32 AlignmentOfElement) const
+		{
+			return DefaultCalculateSlackShrink(NewMax, CurrentMax, NumBytesPerElement, false, AlignmentOfElement);
+		}
+
+		SizeType CalculateSlackGrow(SizeType NewMax, SizeType CurrentMax, SIZE_T NumBytesPerElement) const
+		{
+			return DefaultCalculateSlackGrow(NewMax, CurrentMax, NumBytesPerElement, false);
+		}
+
+		SizeType CalculateSlackGrow(SizeType NewMax, SizeType CurrentMax, SIZE_T NumBytesPerElement, uint32 AlignmentOfElement) const
+		{
+			return DefaultCalculateSlackGrow(NewMax, CurrentMax, NumBytesPerElement, false, AlignmentOfElement);
+		}
+
+		SIZE_T GetAllocatedSize(SizeType CurrentMax, SIZE_T NumBytesPerElement) const
+		{
+			return CurrentMax * NumBytesPerElement;
+		}
+
+		bool HasAllocation() const
+		{
+			return !!Data;
+		}
+
+		SizeType GetInitialCapacity() const
+		{
+			return 0;
+		}
+
+	private:
+		FScriptContainerElement* Data = nullptr;
+
+		// 確保に使ったアリーナ (ヒープから確保した場合は nullptr)
+		FMergeArena* Arena = nullptr;
+		SIZE_T AllocatedBytes = 0;
+	};
+
+	template<typename ElementType>
+	class ForElementType : public ForAnyElementType
+	{
+	public:
+		ForElementType() = default;
+
+		ElementType* GetAllocation() const
+		{
+			return (ElementType*)ForAnyElementType::GetAllocation();
+		}
+	};
+};
+
+template<>
+struct TAllocatorTraits<FMergeArenaAllocator> : TAllocatorTraitsBase<FMergeArenaAllocator>
+{
+	enum { SupportsMove = true };
+	enum { IsZeroConstruct = false };
+	enum { SupportsElementAlignment = true };
+};
+
+// FMergeArena から確保する TSet / TMap のアロケータ
+using FMergeArenaSetAllocator = TSetAllocator<TSparseArrayAllocator<FMergeArenaAllocator, FMergeArenaAllocator>, FMergeArenaAllocator>;
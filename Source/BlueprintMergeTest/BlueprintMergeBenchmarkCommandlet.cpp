@@ -0,0 +1,402 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeBenchmarkCommandlet.h"
+#include "BlueprintMergeLibrary.h"
+#include "BlueprintMergeArena.h"
+#include "BlueprintMergeStats.h"
+#include "BlueprintPropertySchema.h"
+#include "BlueprintGraphHash.h"
+#include "Misc/FileHelper.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "HAL/PlatformMemory.h"
+#include "GameFramework/Actor.h"
+#include "Components/SceneComponent.h"
+#include "Engine/Blueprint.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "Engine/SCS_Node.h"
+#include "EdGraph/EdGraph.h"
+#include "EdGraphSchema_K2.h"
+#include "K2Node_CallFunction.h"
+#include "Kismet/KismetMathLibrary.h"
+#include "Kismet2/BlueprintEditorUtils.h"
+#include "Kismet2/KismetEditorUtilities.h"
+
+
+UBlueprintMergeBenchmarkCommandlet::UBlueprintMergeBenchmarkCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = false;
+}
+
+int32 UBlueprintMergeBenchmarkCommandlet::Main(const FString& Params)
+{
+	FBenchmarkConfig BaseConfig;
+	FParse::Value(*Params, TEXT("Variables="), BaseConfig.NumVariables);
+	FParse::Value(*Params, TEXT("Components="), BaseConfig.NumComponents);
+	FParse::Value(*Params, TEXT("Depth="), BaseConfig.ComponentDepth);
+	FParse::Value(*Params, TEXT("Graphs="), BaseConfig.NumGraphs);
+	FParse::Value(*Params, TEXT("Nodes="), BaseConfig.NumNodesPerGraph);
+	FParse::Value(*Params, TEXT("OneSided="), BaseConfig.OneSidedRatio);
+	FParse::Value(*Params, TEXT("BothSided="), BaseConfig.BothSidedRatio);
+	FParse::Value(*Params, TEXT("Conflict="), BaseConfig.ConflictRatio);
+	FParse::Value(*Params, TEXT("Seed="), BaseConfig.Seed);
+	BaseConfig.ComponentDepth = FMath::Max(BaseConfig.ComponentDepth, 1);
+
+	TArray<int32> Scales;
+	FString ScalesString;
+	if (FParse::Value(*Params, TEXT("Scales="), ScalesString, false))
+	{
+		TArray<FString> Tokens;
+		ScalesString.ParseIntoArray(Tokens, TEXT(","));
+		for (const FString& Token : Tokens)
+		{
+			const int32 Scale = FCString::Atoi(*Token);
+			if (Scale > 0)
+			{
+				Scales.Add(Scale);
+			}
+		}
+	}
+
+	if (Scales.IsEmpty())
+	{
+		Scales = { 1, 2, 4, 8 };
+	}
+
+	FString OutputFilename = FPaths::ProjectSavedDir() / TEXT("BlueprintMergeBenchmark.csv");
+	FParse::Value(*Params, TEXT("Output="), OutputFilename);
+
+	FString Csv = MakeCsvHeader();
+	for (int32 Scale : Scales)
+	{
+		// 深さと割合はそのままで、数だけを増やす
+		FBenchmarkConfig Config = BaseConfig;
+		Config.NumVariables *= Scale;
+		Config.NumComponents *= Scale;
+		Config.NumGraphs *= Scale;
+		Config.NumNodesPerGraph *= Scale;
+
+		const FBenchmarkResult Result = RunBenchmark(Config);
+		UE_LOG(LogTemp, Display, TEXT("Scale[%d] Plan[%.2fms] Merge[%.2fms] Changes[%d/%d] Conflicts[%d/%d]"), Scale, Result.PlanTime, Result.TotalTime, Result.NumChanges, Result.ExpectedChanges, Result.NumConflicts, Result.ExpectedConflicts);
+		Csv += MakeCsvRow(Scale, Config, Result);
+
+		// 規模ごとに生成したアセットとキャッシュを破棄して、次の計測に影響させない
+		FBlueprintPropertySchemaCache::Get().InvalidateAll();
+		FBlueprintGraphHashCache::Get().Empty();
+		CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+	}
+
+	if (!FFileHelper::SaveStringToFile(Csv, *OutputFilename))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write benchmark result. Filename[%s]"), *OutputFilename);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Benchmark result: %s"), *OutputFilename);
+	return 0;
+}
+
+UBlueprintMergeBenchmarkCommandlet::FBenchmarkResult UBlueprintMergeBenchmarkCommandlet::RunBenchmark(const FBenchmarkConfig& Config)
+{
+	FBenchmarkResult Result;
+
+	UBlueprint* Base = CreateBaseBlueprint(Config, TEXT("BP_BenchmarkBase"));
+	UBlueprint* Left = DuplicateBlueprint(Base, TEXT("BP_BenchmarkLeft"));
+	UBlueprint* Right = DuplicateBlueprint(Base, TEXT("BP_BenchmarkRight"));
+	const FEditCounts EditCounts = ApplyEdits(Config, Left, Right);
+	Result.ExpectedChanges = EditCounts.NumChanges;
+	Result.ExpectedConflicts = EditCounts.NumConflicts;
+	Result.NumUnchangedEdits = EditCounts.NumUnchangedEdits;
+
+	// 計画の作成 (アセットを変更しない解析)
+	const double PlanStartTime = FPlatformTime::Seconds();
+	const FBlueprintMergePlan Plan = UBlueprintMergeLibrary::PlanBlueprintMerge(Base, Left, Right);
+	Result.PlanTime = (FPlatformTime::Seconds() - PlanStartTime) * 1000.0;
+	Result.NumChanges = Plan.Entries.Num();
+	Result.NumConflicts = Plan.NumConflicts;
+
+	// マージは Base と同じディレクトリに出力されるので、前の規模の出力と衝突しない名前にする
+	const FString OutputDirectory = FPackageName::GetLongPackagePath(Base->GetPackage()->GetName());
+	const FName OutputPackageName = MakeUniqueObjectName(nullptr, UPackage::StaticClass(), FName(*(OutputDirectory / TEXT("BP_BenchmarkMerged"))));
+	const FString OutputName = FPackageName::GetShortName(OutputPackageName);
+
+	// フェーズごとの時間とアリーナの使用量は、マージの間だけを集計する
+	FBlueprintMergePhaseTimes::Reset();
+	FMergeArena::ResetPeak();
+	const uint64 UsedPhysicalBefore = FPlatformMemory::GetStats().UsedPhysical;
+	const double MergeStartTime = FPlatformTime::Seconds();
+
+	UBlueprintMergeLibrary::MergeBlueprint(nullptr, Base, Left, Right, OutputName);
+
+	Result.TotalTime = (FPlatformTime::Seconds() - MergeStartTime) * 1000.0;
+	const uint64 UsedPhysicalAfter = FPlatformMemory::GetStats().UsedPhysical;
+	Result.UsedPhysicalDelta = UsedPhysicalAfter > UsedPhysicalBefore ? UsedPhysicalAfter - UsedPhysicalBefore : 0;
+	Result.ArenaHighWaterMark = FMergeArena::GetPeakHighWaterMark();
+	Result.ArenaReservedBytes = FMergeArena::GetPeakReservedBytes();
+
+	Result.AnalyzeTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::Analyze);
+	Result.DiffPropertiesTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::DiffProperties);
+	Result.DiffComponentsTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::DiffComponents);
+	Result.DiffGraphsTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::DiffGraphs);
+	Result.DuplicateTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::Duplicate);
+	Result.MergeVariablesTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::MergeVariables);
+	Result.MergeComponentsTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::MergeComponents);
+	for (EBlueprintMergePhase Phase : { EBlueprintMergePhase::MergeFunctionGraphs, EBlueprintMergePhase::MergeEventGraphs, EBlueprintMergePhase::MergeMacroGraphs, EBlueprintMergePhase::MergeDelegateGraphs, EBlueprintMergePhase::MergeUbergraphs })
+	{
+		Result.MergeGraphsTime += FBlueprintMergePhaseTimes::GetMilliseconds(Phase);
+	}
+	Result.CompileTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::Compile);
+	Result.ApplyDefaultValuesTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::ApplyDefaultValues);
+	Result.CommitTime = FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase::Commit);
+
+	UBlueprint* Merged = FindObject<UBlueprint>(nullptr, *(OutputPackageName.ToString() + TEXT(".") + OutputName));
+	for (UBlueprint* Blueprint : { Base, Left, Right, Merged })
+	{
+		if (Blueprint)
+		{
+			DiscardBlueprint(Blueprint);
+		}
+	}
+	return Result;
+}
+
+UBlueprint* UBlueprintMergeBenchmarkCommandlet::CreateBaseBlueprint(const FBenchmarkConfig& Config, const FString& Name)
+{
+	UPackage* Package = CreatePackage(*MakeUniqueObjectName(nullptr, UPackage::StaticClass(), FName(*(FString(TEXT("/Temp/BlueprintMergeBenchmark/")) + Name))).ToString());
+	Package->SetFlags(RF_Transient);
+
+	UBlueprint* Blueprint = FKismetEditorUtilities::CreateBlueprint(AActor::StaticClass(), Package, FName(*Name), BPTYPE_Normal, UBlueprint::StaticClass(), UBlueprintGeneratedClass::StaticClass());
+
+	// メンバー変数
+	const FEdGraphPinType IntPinType(UEdGraphSchema_K2::PC_Int, NAME_None, nullptr, EPinContainerType::None, false, FEdGraphTerminalType());
+	for (int32 Index = 0; Index < Config.NumVariables; ++Index)
+	{
+		FBlueprintEditorUtils::AddMemberVariable(Blueprint, *FString::Printf(TEXT("Var%d"), Index), IntPinType, TEXT("0"));
+	}
+
+	// コンポーネント (Depth 個ずつ親子につなげる)
+	USimpleConstructionScript* SCS = Blueprint->SimpleConstructionScript;
+	USCS_Node* ParentNode = nullptr;
+	for (int32 Index = 0; Index < Config.NumComponents; ++Index)
+	{
+		USCS_Node* Node = SCS->CreateNode(USceneComponent::StaticClass(), *FString::Printf(TEXT("Component%d"), Index));
+		if (Index % Config.ComponentDepth == 0)
+		{
+			SCS->AddNode(Node);
+		}
+		else
+		{
+			ParentNode->AddChildNode(Node);
+		}
+		ParentNode = Node;
+	}
+
+	// 関数グラフ (加算ノードを直列につなげる)
+	UFunction* AddFunction = UKismetMathLibrary::StaticClass()->FindFunctionByName(GET_FUNCTION_NAME_CHECKED(UKismetMathLibrary, Add_IntInt));
+	for (int32 GraphIndex = 0; GraphIndex < Config.NumGraphs; ++GraphIndex)
+	{
+		UEdGraph* Graph = FBlueprintEditorUtils::CreateNewGraph(Blueprint, *FString::Printf(TEXT("Function%d"), GraphIndex), UEdGraph::StaticClass(), UEdGraphSchema_K2::StaticClass());
+		FBlueprintEditorUtils::AddFunctionGraph<UClass>(Blueprint, Graph, true, nullptr);
+
+		UEdGraphPin* PreviousOutput = nullptr;
+		for (int32 NodeIndex = 0; NodeIndex < Config.NumNodesPerGraph; ++NodeIndex)
+		{
+			FGraphNodeCreator<UK2Node_CallFunction> NodeCreator(*Graph);
+			UK2Node_CallFunction* Node = NodeCreator.CreateNode();
+			Node->SetFromFunction(AddFunction);
+			Node->NodePosX = NodeIndex * 200;
+			NodeCreator.Finalize();
+
+			if (PreviousOutput)
+			{
+				PreviousOutput->MakeLinkTo(Node->FindPinChecked(TEXT("A")));
+			}
+			PreviousOutput = Node->GetReturnValuePin();
+		}
+	}
+
+	FKismetEditorUtilities::CompileBlueprint(Blueprint);
+	return Blueprint;
+}
+
+UBlueprint* UBlueprintMergeBenchmarkCommandlet::DuplicateBlueprint(UBlueprint* Source, const FString& Name)
+{
+	UPackage* Package = CreatePackage(*MakeUniqueObjectName(nullptr, UPackage::StaticClass(), FName(*(FString(TEXT("/Temp/BlueprintMergeBenchmark/")) + Name))).ToString());
+	Package->SetFlags(RF_Transient);
+	return DuplicateObject(Source, Package, FName(*Name));
+}
+
+void UBlueprintMergeBenchmarkCommandlet::DiscardBlueprint(UBlueprint* Blueprint)
+{
+	UPackage* Package = Blueprint->GetPackage();
+	Blueprint->ClearFlags(RF_Public | RF_Standalone);
+	Blueprint->MarkAsGarbage();
+	Package->MarkAsGarbage();
+}
+
+UBlueprintMergeBenchmarkCommandlet::FEditCounts UBlueprintMergeBenchmarkCommandlet::ApplyEdits(const FBenchmarkConfig& Config, UBlueprint* Left, UBlueprint* Right)
+{
+	FRandomStream Random(Config.Seed);
+	FEditCounts Counts;
+
+	// 片側だけの変更は Left と Right に交互に加える
+	// 変更した項目ごとに計画の項目が 1 つでき、両側で変更した項目はコンフリクトになる
+	// bSameChangeConflicts は、両側の同じ変更もコンフリクトとして扱う項目 (CDO のデフォルト値) か
+	// 書く値は、どの項目の Base の値 (変数は 0、加算ノードのピン B は 1) とも、互いとも異なるものにする
+	// Edit は、Base の値から変わったかを返す
+	constexpr int32 LeftValue = 2;
+	constexpr int32 RightValue = 3;
+	int32 OneSidedCount = 0;
+	auto ForEachEdit = [&Config, &Random, &OneSidedCount, &Counts](int32 Num, bool bSameChangeConflicts, TFunctionRef<bool(int32 Index, UBlueprint* Blueprint, int32 Value)> Edit, UBlueprint* Left, UBlueprint* Right)
+	{
+		auto ApplyEdit = [&Edit, &Counts](int32 Index, UBlueprint* Blueprint, int32 Value)
+		{
+			if (!ensureMsgf(Edit(Index, Blueprint, Value), TEXT("Benchmark edit does not change the base value. Blueprint[%s] Index[%d]"), *Blueprint->GetName(), Index))
+			{
+				++Counts.NumUnchangedEdits;
+			}
+		};
+
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			switch (ChooseEdit(Config, Random))
+			{
+			case EEditKind::OneSided:
+				ApplyEdit(Index, (OneSidedCount++ % 2 == 0) ? Left : Right, LeftValue);
+				++Counts.NumChanges;
+				break;
+			case EEditKind::BothSided:
+				ApplyEdit(Index, Left, LeftValue);
+				ApplyEdit(Index, Right, LeftValue);
+				++Counts.NumChanges;
+				Counts.NumConflicts += bSameChangeConflicts ? 1 : 0;
+				break;
+			case EEditKind::Conflict:
+				ApplyEdit(Index, Left, LeftValue);
+				ApplyEdit(Index, Right, RightValue);
+				++Counts.NumChanges;
+				++Counts.NumConflicts;
+				break;
+			default:
+				break;
+			}
+		}
+	};
+
+	// 変数のデフォルト値
+	ForEachEdit(Config.NumVariables, true, [](int32 Index, UBlueprint* Blueprint, int32 Value)
+	{
+		FIntProperty* Property = FindFProperty<FIntProperty>(Blueprint->GeneratedClass, *FString::Printf(TEXT("Var%d"), Index));
+		if (!Property)
+		{
+			return false;
+		}
+
+		UObject* DefaultObject = Blueprint->GeneratedClass->GetDefaultObject();
+		const bool bChanged = Property->GetPropertyValue_InContainer(DefaultObject) != Value;
+		Property->SetPropertyValue_InContainer(DefaultObject, Value);
+		return bChanged;
+	}, Left, Right);
+
+	// コンポーネントのテンプレート
+	ForEachEdit(Config.NumComponents, false, [](int32 Index, UBlueprint* Blueprint, int32 Value)
+	{
+		USCS_Node* Node = Blueprint->SimpleConstructionScript->FindSCSNode(*FString::Printf(TEXT("Component%d"), Index));
+		USceneComponent* Template = Node ? Cast<USceneComponent>(Node->ComponentTemplate) : nullptr;
+		if (!Template)
+		{
+			return false;
+		}
+
+		const FVector Location(Value * 100.0, 0.0, 0.0);
+		const bool bChanged = !Template->GetRelativeLocation().Equals(Location, 0.0);
+		Template->SetRelativeLocation_Direct(Location);
+		return bChanged;
+	}, Left, Right);
+
+	// 関数グラフ (先頭のノードのデフォルト値)
+	ForEachEdit(Config.NumGraphs, false, [](int32 Index, UBlueprint* Blueprint, int32 Value)
+	{
+		const FName GraphName(*FString::Printf(TEXT("Function%d"), Index));
+		for (UEdGraph* Graph : Blueprint->FunctionGraphs)
+		{
+			if (Graph->GetFName() != GraphName)
+			{
+				continue;
+			}
+
+			for (UEdGraphNode* Node : Graph->Nodes)
+			{
+				if (UK2Node_CallFunction* CallNode = Cast<UK2Node_CallFunction>(Node))
+				{
+					UEdGraphPin* Pin = CallNode->FindPinChecked(TEXT("B"));
+					const FString NewValue = LexToString(Value);
+					const bool bChanged = Pin->DefaultValue != NewValue;
+					Pin->DefaultValue = NewValue;
+					return bChanged;
+				}
+			}
+		}
+		return false;
+	}, Left, Right);
+
+	return Counts;
+}
+
+UBlueprintMergeBenchmarkCommandlet::EEditKind UBlueprintMergeBenchmarkCommandlet::ChooseEdit(const FBenchmarkConfig& Config, FRandomStream& Random)
+{
+	const float Value = Random.GetFraction();
+	if (Value < Config.ConflictRatio)
+	{
+		return EEditKind::Conflict;
+	}
+	if (Value < Config.ConflictRatio + Config.BothSidedRatio)
+	{
+		return EEditKind::BothSided;
+	}
+	if (Value < Config.ConflictRatio + Config.BothSidedRatio + Config.OneSidedRatio)
+	{
+		return EEditKind::OneSided;
+	}
+	return EEditKind::None;
+}
+
+FString UBlueprintMergeBenchmarkCommandlet::MakeCsvHeader()
+{
+	return TEXT("Scale,Variables,Components,Depth,Graphs,NodesPerGraph,PlanMs,AnalyzeMs,DiffPropertiesMs,DiffComponentsMs,DiffGraphsMs,DuplicateMs,MergeVariablesMs,MergeComponentsMs,MergeGraphsMs,CompileMs,ApplyDefaultValuesMs,CommitMs,TotalMs,Changes,Conflicts,UsedPhysicalDeltaMB,ArenaHighWaterMB,ArenaReservedMB\n");
+}
+
+FString UBlueprintMergeBenchmarkCommandlet::MakeCsvRow(int32 Scale, const FBenchmarkConfig& Config, const FBenchmarkResult& Result)
+{
+	return FString::Printf(TEXT("%d,%d,%d,%d,%d,%d,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%.3f,%d,%d,%.1f,%.2f,%.2f\n"),
+		Scale,
+		Config.NumVariables,
+		Config.NumComponents,
+		Config.ComponentDepth,
+		Config.NumGraphs,
+		Config.NumNodesPerGraph,
+		Result.PlanTime,
+		Result.AnalyzeTime,
+		Result.DiffPropertiesTime,
+		Result.DiffComponentsTime,
+		Result.DiffGraphsTime,
+		Result.DuplicateTime,
+		Result.MergeVariablesTime,
+		Result.MergeComponentsTime,
+		Result.MergeGraphsTime,
+		Result.CompileTime,
+		Result.ApplyDefaultValuesTime,
+		Result.CommitTime,
+		Result.TotalTime,
+		Result.NumChanges,
+		Result.NumConflicts,
+		Result.UsedPhysicalDelta / (1024.0 * 1024.0),
+		Result.ArenaHighWaterMark / (1024.0 * 1024.0),
+		Result.ArenaReservedBytes / (1024.0 * 1024.0));
+}
@@ -0,0 +1,125 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BlueprintMergeBenchmarkCommandlet.generated.h"
+
+class UBlueprint;
+
+/**
+ * 合成したブループリントでマージの処理時間を計測する
+ * 規模を変えて計測し、フェーズごとの時間とメモリ使用量を CSV に書き出す
+ *
+ * UnrealEditor-Cmd <Project>.uproject -run=BlueprintMergeBenchmark [options] -nullrhi -unattended
+ *
+ * -Variables=<N>   メンバー変数の数
+ * -Components=<M>  コンポーネントの数
+ * -Depth=<K>       コンポーネントツリーの深さ
+ * -Graphs=<G>      関数グラフの数
+ * -Nodes=<P>       グラフごとのノード数
+ * -Scales=1,2,4    上の数に掛ける倍率 (倍率ごとに 1 行出力する)
+ * -OneSided=0.2    片側だけ変更する割合
+ * -BothSided=0.05  両側で同じ変更をする割合
+ * -Conflict=0.05   両側で異なる変更をする割合
+ * -Seed=<seed>     変更する項目を選ぶ乱数のシード
+ * -Output=<path>   CSV の出力先 (既定は Saved/BlueprintMergeBenchmark.csv)
+ */
+UCLASS()
+class BLUEPRINTMERGETEST_API UBlueprintMergeBenchmarkCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBlueprintMergeBenchmarkCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	// 合成するブループリントの規模と変更の割合
+	struct FBenchmarkConfig
+	{
+		int32 NumVariables = 100;
+		int32 NumComponents = 20;
+		int32 ComponentDepth = 4;
+		int32 NumGraphs = 10;
+		int32 NumNodesPerGraph = 20;
+		float OneSidedRatio = 0.2f;
+		float BothSidedRatio = 0.05f;
+		float ConflictRatio = 0.05f;
+		int32 Seed = 0;
+	};
+
+	// 1 回の計測結果 (時間はミリ秒)
+	// マージのフェーズの時間は BLUEPRINT_MERGE_SCOPE で計ったもの
+	struct FBenchmarkResult
+	{
+		double PlanTime = 0.0;
+		double AnalyzeTime = 0.0;
+		double DiffPropertiesTime = 0.0;
+		double DiffComponentsTime = 0.0;
+		double DiffGraphsTime = 0.0;
+		double DuplicateTime = 0.0;
+		double MergeVariablesTime = 0.0;
+		double MergeComponentsTime = 0.0;
+		double MergeGraphsTime = 0.0;
+		double CompileTime = 0.0;
+		double ApplyDefaultValuesTime = 0.0;
+		double CommitTime = 0.0;
+		double TotalTime = 0.0;
+		int32 NumChanges = 0;
+		int32 NumConflicts = 0;
+
+		// 加えた変更から求めた、計画の項目数とコンフリクト数
+		int32 ExpectedChanges = 0;
+		int32 ExpectedConflicts = 0;
+
+		// Base と同じ値を書いてしまった変更の数 (0 でなければ期待値が正しくない)
+		int32 NumUnchangedEdits = 0;
+
+		// マージの前後の物理メモリの使用量の差
+		uint64 UsedPhysicalDelta = 0;
+
+		// マージで使ったアリーナの最大使用量と、確保したブロックの最大値
+		uint64 ArenaHighWaterMark = 0;
+		uint64 ArenaReservedBytes = 0;
+	};
+
+	// Base / Left / Right を合成して、公開されているエントリポイントで計画の作成とマージを行う
+	static FBenchmarkResult RunBenchmark(const FBenchmarkConfig& Config);
+
+private:
+	// 項目に加える変更
+	enum class EEditKind : uint8
+	{
+		None,
+		OneSided,
+		BothSided,
+		Conflict,
+	};
+
+	// 加えた変更の数
+	struct FEditCounts
+	{
+		int32 NumChanges = 0;
+		int32 NumConflicts = 0;
+		int32 NumUnchangedEdits = 0;
+	};
+
+	// Base を生成してコンパイルする
+	static UBlueprint* CreateBaseBlueprint(const FBenchmarkConfig& Config, const FString& Name);
+
+	// 一時パッケージに複製する
+	static UBlueprint* DuplicateBlueprint(UBlueprint* Source, const FString& Name);
+
+	// 計測に使ったブループリントを破棄する
+	static void DiscardBlueprint(UBlueprint* Blueprint);
+
+	// Base を複製した Left / Right に変更を加える
+	static FEditCounts ApplyEdits(const FBenchmarkConfig& Config, UBlueprint* Left, UBlueprint* Right);
+
+	static EEditKind ChooseEdit(const FBenchmarkConfig& Config, FRandomStream& Random);
+
+	static FString MakeCsvHeader();
+	static FString MakeCsvRow(int32 Scale, const FBenchmarkConfig& Config, const FBenchmarkResult& Result);
+};
\ No newline at end of file
@@ -0,0 +1,38 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeBenchmarkCommandlet.h"
+#include "Misc/AutomationTest.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// ベンチマークを小さい規模で実行し、加えた変更どおりの計画ができるか確かめる
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlueprintMergeBenchmarkSmallScaleTest, "BlueprintMerge.Benchmark.SmallScale", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBlueprintMergeBenchmarkSmallScaleTest::RunTest(const FString& Parameters)
+{
+	UBlueprintMergeBenchmarkCommandlet::FBenchmarkConfig Config;
+	Config.NumVariables = 10;
+	Config.NumComponents = 4;
+	Config.ComponentDepth = 2;
+	Config.NumGraphs = 3;
+	Config.NumNodesPerGraph = 3;
+	Config.OneSidedRatio = 0.4f;
+	Config.BothSidedRatio = 0.2f;
+	Config.ConflictRatio = 0.2f;
+	Config.Seed = 1;
+
+	const UBlueprintMergeBenchmarkCommandlet::FBenchmarkResult Result = UBlueprintMergeBenchmarkCommandlet::RunBenchmark(Config);
+
+	TestTrue(TEXT("Edits were applied"), Result.ExpectedChanges > 0);
+	TestEqual(TEXT("Every edit differs from the base value"), Result.NumUnchangedEdits, 0);
+	TestEqual(TEXT("Changes"), Result.NumChanges, Result.ExpectedChanges);
+	TestEqual(TEXT("Conflicts"), Result.NumConflicts, Result.ExpectedConflicts);
+
+	// フェーズの時間とアリーナの使用量は、マージのエントリポイントから集計される
+	TestTrue(TEXT("Analyze phase was measured"), Result.AnalyzeTime > 0.0);
+	TestTrue(TEXT("Arena was used"), Result.ArenaHighWaterMark > 0);
+	return true;
+}
+
+#endif
@@ -0,0 +1,102 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeCommandlet.h"
+#include "BlueprintMergeLibrary.h"
+#include "BlueprintMergeReport.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+
+
+UBlueprintMergeCommandlet::UBlueprintMergeCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = false;
+}
+
+int32 UBlueprintMergeCommandlet::Main(const FString& Params)
+{
+	FArguments Arguments;
+	if (!ParseArguments(Params, Arguments))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Usage: -run=BlueprintMerge -Base=<path> -Left=<path> -Right=<path> -Output=<path> [-Package=/Game/...]"));
+		return ExitCode_Error;
+	}
+
+	// 差分とコンフリクトのレポート
+	FBlueprintMergeReport Report;
+	if (!Arguments.ReportFilename.IsEmpty() && Report.Open(Arguments.ReportFilename, Arguments.bReportValues))
+	{
+		FBlueprintMergeReport::SetActive(&Report);
+	}
+
+	const FString& OutputFilename = Arguments.OutputFilename;
+	FBlueprintMergePlan Plan;
+	const EBlueprintMergeResult Result = UBlueprintMergeLibrary::MergeBlueprintFiles(Arguments.BaseFilename, Arguments.LeftFilename, Arguments.RightFilename, OutputFilename, Arguments.PackageName, Plan);
+
+	Report.Close();
+
+	switch (Result)
+	{
+	case EBlueprintMergeResult::Clean:
+		UE_LOG(LogTemp, Display, TEXT("Merged. Changes[%d] Output[%s]"), Plan.Entries.Num(), *OutputFilename);
+		return ExitCode_Clean;
+
+	case EBlueprintMergeResult::Conflict:
+		for (const FBlueprintMergePlanEntry& Entry : Plan.Entries)
+		{
+			if (Entry.Action == EBlueprintMergePlanAction::Conflict)
+			{
+				UE_LOG(LogTemp, Display, TEXT("Conflict!! %s[%s]"), *UEnum::GetDisplayValueAsText(Entry.Category).ToString(), *Entry.Path);
+			}
+		}
+		UE_LOG(LogTemp, Display, TEXT("Conflicts[%d]"), Plan.NumConflicts);
+		return ExitCode_Conflict;
+
+	default:
+		return ExitCode_Error;
+	}
+}
+
+bool UBlueprintMergeCommandlet::ParseArguments(const FString& Params, FArguments& OutArguments)
+{
+	TArray<FString> Tokens;
+	TArray<FString> Switches;
+	TMap<FString, FString> ParamValues;
+	ParseCommandLine(*Params, Tokens, Switches, ParamValues);
+
+	OutArguments.BaseFilename = ResolveArgumentPath(ParamValues.FindRef(TEXT("Base")));
+	OutArguments.LeftFilename = ResolveArgumentPath(ParamValues.FindRef(TEXT("Left")));
+	OutArguments.RightFilename = ResolveArgumentPath(ParamValues.FindRef(TEXT("Right")));
+	OutArguments.OutputFilename = ResolveArgumentPath(ParamValues.FindRef(TEXT("Output")));
+	OutArguments.AssetFilename = ResolveArgumentPath(ParamValues.FindRef(TEXT("Path")));
+	OutArguments.ReportFilename = ResolveArgumentPath(ParamValues.FindRef(TEXT("Report")));
+	OutArguments.bReportValues = Switches.Contains(TEXT("ReportValues"));
+
+	// 元のアセットのパッケージ名 (指定がなければ、アセットのパスか出力先から求める)
+	OutArguments.PackageName = ParamValues.FindRef(TEXT("Package"));
+	if (OutArguments.PackageName.IsEmpty())
+	{
+		const FString& Filename = OutArguments.AssetFilename.IsEmpty() ? OutArguments.OutputFilename : OutArguments.AssetFilename;
+		if (!FPackageName::TryConvertFilenameToLongPackageName(Filename, OutArguments.PackageName))
+		{
+			OutArguments.PackageName.Reset();
+		}
+	}
+
+	return !OutArguments.BaseFilename.IsEmpty() && !OutArguments.LeftFilename.IsEmpty() && !OutArguments.RightFilename.IsEmpty() && !OutArguments.OutputFilename.IsEmpty();
+}
+
+FString UBlueprintMergeCommandlet::ResolveArgumentPath(const FString& Path)
+{
+	if (Path.IsEmpty())
+	{
+		return Path;
+	}
+
+	// 作業ディレクトリ (エンジンが移したもの) ではなく、起動したディレクトリから解決する
+	return FPaths::ConvertRelativePathToFull(FPaths::LaunchDir(), Path);
+}
@@ -0,0 +1,59 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BlueprintMergeCommandlet.generated.h"
+
+/**
+ * ブループリントの .uasset をエディタを起動せずにマージする
+ * git のマージドライバとして使う
+ *
+ * UnrealEditor-Cmd <Project>.uproject -run=BlueprintMerge -Base=<path> -Left=<path> -Right=<path> -Output=<path> [-Package=/Game/... | -Path=<asset path>] [-Report=<path> [-ReportValues]] -nullrhi -unattended
+ *
+ * git の設定例:
+ *   driver = UnrealEditor-Cmd <Project>.uproject -run=BlueprintMerge -Base=%O -Left=%A -Right=%B -Output=%A -Path=%P -nullrhi -unattended -nosplash -nosound
+ *
+ * -Report を指定すると、差分とコンフリクトを JSON Lines で書き出す (-ReportValues でプロパティの値も含める)
+ *
+ * エンジンは起動時に作業ディレクトリを移すので、相対パスは起動したディレクトリ (git のマージドライバならリポジトリのルート) から解決する
+ *
+ * 終了コード: 0 = マージ成功, 1 = コンフリクト, 2 = エラー
+ */
+UCLASS()
+class BLUEPRINTMERGETEST_API UBlueprintMergeCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBlueprintMergeCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+	enum EExitCode : int32
+	{
+		ExitCode_Clean = 0,
+		ExitCode_Conflict = 1,
+		ExitCode_Error = 2,
+	};
+
+	// コマンドラインの引数 (ファイルのパスは全て絶対パスにしたもの)
+	struct FArguments
+	{
+		FString BaseFilename;
+		FString LeftFilename;
+		FString RightFilename;
+		FString OutputFilename;
+		FString AssetFilename;
+		FString PackageName;
+		FString ReportFilename;
+		bool bReportValues = false;
+	};
+
+	// 引数を読み、相対パスを起動したディレクトリから解決する (必須の引数がなければ false を返す)
+	static bool ParseArguments(const FString& Params, FArguments& OutArguments);
+
+	// 相対パスを起動したディレクトリから解決する (空の場合は空のまま)
+	static FString ResolveArgumentPath(const FString& Path);
+};
@@ -0,0 +1,43 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeCommandlet.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/Paths.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+// git のマージドライバは相対パスを渡すので、起動したディレクトリから解決されるか確かめる
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlueprintMergeCommandletRelativeArgumentsTest, "BlueprintMerge.Commandlet.RelativeArguments", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBlueprintMergeCommandletRelativeArgumentsTest::RunTest(const FString& Parameters)
+{
+	const FString Params = TEXT("-Base=.merge_file_O -Left=.merge_file_A -Right=.merge_file_B -Output=.merge_file_A -Path=Content/Blueprints/BP_Test.uasset -Report=Saved/Merge.jsonl -ReportValues");
+
+	UBlueprintMergeCommandlet::FArguments Arguments;
+	TestTrue(TEXT("Arguments are complete"), UBlueprintMergeCommandlet::ParseArguments(Params, Arguments));
+
+	auto Expected = [](const TCHAR* Path)
+	{
+		return FPaths::ConvertRelativePathToFull(FPaths::LaunchDir(), Path);
+	};
+	TestEqual(TEXT("Base"), Arguments.BaseFilename, Expected(TEXT(".merge_file_O")));
+	TestEqual(TEXT("Left"), Arguments.LeftFilename, Expected(TEXT(".merge_file_A")));
+	TestEqual(TEXT("Right"), Arguments.RightFilename, Expected(TEXT(".merge_file_B")));
+	TestEqual(TEXT("Output"), Arguments.OutputFilename, Expected(TEXT(".merge_file_A")));
+	TestEqual(TEXT("Path"), Arguments.AssetFilename, Expected(TEXT("Content/Blueprints/BP_Test.uasset")));
+	TestEqual(TEXT("Report"), Arguments.ReportFilename, Expected(TEXT("Saved/Merge.jsonl")));
+	TestTrue(TEXT("ReportValues"), Arguments.bReportValues);
+	TestFalse(TEXT("Resolved paths are absolute"), FPaths::IsRelative(Arguments.BaseFilename));
+
+	// 絶対パスはそのまま使う
+	const FString AbsoluteBase = FPaths::ConvertRelativePathToFull(FPaths::ProjectDir(), TEXT("Base.uasset"));
+	TestEqual(TEXT("Absolute path"), UBlueprintMergeCommandlet::ResolveArgumentPath(AbsoluteBase), AbsoluteBase);
+
+	// 必須の引数がなければ失敗する
+	UBlueprintMergeCommandlet::FArguments MissingArguments;
+	TestFalse(TEXT("Missing output"), UBlueprintMergeCommandlet::ParseArguments(TEXT("-Base=a -Left=b -Right=c"), MissingArguments));
+	return true;
+}
+
+#endif
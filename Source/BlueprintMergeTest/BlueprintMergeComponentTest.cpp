@@ -0,0 +1,82 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeLibrary.h"
+#include "Misc/AutomationTest.h"
+#include "Misc/PackageName.h"
+#include "GameFramework/Actor.h"
+#include "Components/SceneComponent.h"
+#include "Engine/Blueprint.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "Engine/SimpleConstructionScript.h"
+#include "Engine/SCS_Node.h"
+#include "Kismet2/KismetEditorUtilities.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const TCHAR* ComponentTestPath = TEXT("/Temp/BlueprintMergeComponentTest/");
+
+	UPackage* CreateComponentTestPackage(const FString& Name)
+	{
+		UPackage* Package = CreatePackage(*MakeUniqueObjectName(nullptr, UPackage::StaticClass(), FName(*(FString(ComponentTestPath) + Name))).ToString());
+		Package->SetFlags(RF_Transient);
+		return Package;
+	}
+
+	void DiscardComponentTestBlueprint(UBlueprint* Blueprint)
+	{
+		if (!Blueprint)
+		{
+			return;
+		}
+
+		UPackage* Package = Blueprint->GetPackage();
+		Blueprint->ClearFlags(RF_Public | RF_Standalone);
+		Blueprint->MarkAsGarbage();
+		Package->MarkAsGarbage();
+	}
+}
+
+// 片側で追加した最上位のコンポーネントが、マージ結果の SCS に追加されるか確かめる
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlueprintMergeComponentAddRootTest, "BlueprintMerge.Component.AddRoot", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBlueprintMergeComponentAddRootTest::RunTest(const FString& Parameters)
+{
+	static const FName RootName(TEXT("Root"));
+	static const FName AddedName(TEXT("Added"));
+
+	UBlueprint* Base = FKismetEditorUtilities::CreateBlueprint(AActor::StaticClass(), CreateComponentTestPackage(TEXT("BP_Base")), TEXT("BP_Base"), BPTYPE_Normal, UBlueprint::StaticClass(), UBlueprintGeneratedClass::StaticClass());
+	Base->SimpleConstructionScript->AddNode(Base->SimpleConstructionScript->CreateNode(USceneComponent::StaticClass(), RootName));
+	FKismetEditorUtilities::CompileBlueprint(Base);
+
+	UBlueprint* Left = DuplicateObject(Base, CreateComponentTestPackage(TEXT("BP_Left")), TEXT("BP_Left"));
+	UBlueprint* Right = DuplicateObject(Base, CreateComponentTestPackage(TEXT("BP_Right")), TEXT("BP_Right"));
+	Left->SimpleConstructionScript->AddNode(Left->SimpleConstructionScript->CreateNode(USceneComponent::StaticClass(), AddedName));
+	FKismetEditorUtilities::CompileBlueprint(Left);
+
+	const FString OutputName = MakeUniqueObjectName(nullptr, UPackage::StaticClass(), TEXT("BP_Merged")).ToString();
+	UBlueprintMergeLibrary::MergeBlueprint(nullptr, Base, Left, Right, OutputName);
+
+	const FString OutputPackageName = FPackageName::GetLongPackagePath(Base->GetPackage()->GetName()) / OutputName;
+	UBlueprint* Merged = FindObject<UBlueprint>(nullptr, *(OutputPackageName + TEXT(".") + OutputName));
+	if (TestNotNull(TEXT("Merged blueprint"), Merged))
+	{
+		USimpleConstructionScript* SCS = Merged->SimpleConstructionScript;
+		USCS_Node* AddedNode = SCS->FindSCSNode(AddedName);
+		if (TestNotNull(TEXT("Added component"), AddedNode))
+		{
+			TestTrue(TEXT("Added component is a root node"), SCS->GetRootNodes().Contains(AddedNode));
+		}
+		TestNotNull(TEXT("Base component is kept"), SCS->FindSCSNode(RootName));
+	}
+
+	for (UBlueprint* Blueprint : { Base, Left, Right, Merged })
+	{
+		DiscardComponentTestBlueprint(Blueprint);
+	}
+	return true;
+}
+
+#endif
@@ -0,0 +1,103 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// 3-way マージの判定
+// エンジンに依存しない C++ だけで書き、エディタを起動せずにビルド・計測できるようにする
+// UObject との変換は UBlueprintMergeLibrary 側で行う
+
+#include <cstdint>
+
+namespace BlueprintMerge
+{
+	namespace Core
+	{
+		enum class EChange : std::uint8_t
+		{
+			None,
+			Add,
+			Remove,
+			Modify,
+		};
+
+		// 1 つの項目の判定結果
+		// bLeftChanged / bRightChanged は変更した側を表す (削除した側も含む)
+		struct FDecision
+		{
+			EChange Change = EChange::None;
+			bool bLeftChanged = false;
+			bool bRightChanged = false;
+
+			bool HasChange() const
+			{
+				return bLeftChanged || bRightChanged;
+			}
+
+			bool IsConflict() const
+			{
+				return bLeftChanged && bRightChanged;
+			}
+		};
+
+		// 判定の方針
+		struct FClassifyOptions
+		{
+			// 片側の削除と、もう片側の変更をコンフリクトにする
+			// false の場合は削除を優先し、もう片側の変更は見ない
+			bool bRemoveConflictsWithModify = true;
+		};
+
+		/**
+		 * Base / Left / Right に項目があるかと、内容の比較から変更を判定する
+		 *
+		 * IsLeftModified / IsRightModified: Base と内容が異なるか (Base とその側に項目がある場合だけ呼ぶ)
+		 * IsSameChange: Left と Right の内容が等しいか (両側が同じ種類の変更をした場合だけ呼ぶ)
+		 *
+		 * 比較は重いことがあるので、必要になるまで呼ばない
+		 */
+		template<typename LeftModifiedFunc, typename RightModifiedFunc, typename SameChangeFunc>
+		FDecision ClassifyThreeWay(bool bInBase, bool bInLeft, bool bInRight, LeftModifiedFunc&& IsLeftModified, RightModifiedFunc&& IsRightModified, SameChangeFunc&& IsSameChange, const FClassifyOptions& Options = FClassifyOptions())
+		{
+			FDecision Decision;
+			if (bInBase)
+			{
+				if (bInLeft && bInRight)
+				{
+					Decision.bLeftChanged = IsLeftModified();
+					Decision.bRightChanged = IsRightModified();
+					Decision.Change = Decision.HasChange() ? EChange::Modify : EChange::None;
+				}
+				else
+				{
+					// 残っている側の変更は、削除とコンフリクトさせる場合だけ調べる
+					Decision.Change = EChange::Remove;
+					Decision.bLeftChanged = !bInLeft || (Options.bRemoveConflictsWithModify && IsLeftModified());
+					Decision.bRightChanged = !bInRight || (Options.bRemoveConflictsWithModify && IsRightModified());
+				}
+			}
+			else if (bInLeft || bInRight)
+			{
+				Decision.Change = EChange::Add;
+				Decision.bLeftChanged = bInLeft;
+				Decision.bRightChanged = bInRight;
+			}
+
+			// 両方の変更が等しい場合、片方の変更を反映すればいいので、片方のフラグを下す
+			// 両方で削除した場合は内容を比べるまでもなく等しい
+			if (Decision.IsConflict() && bInLeft == bInRight && (!bInLeft || IsSameChange()))
+			{
+				Decision.bRightChanged = false;
+			}
+			return Decision;
+		}
+
+		// 比較しない場合に使う
+		struct FNever
+		{
+			bool operator()() const
+			{
+				return false;
+			}
+		};
+	}
+}
@@ -0,0 +1,201 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Algo/StableSort.h"
+#include "BlueprintMergeArena.h"
+#include <type_traits>
+
+// キーでソートされたフラットな配列
+// TMap の代わりに使い、Base / Left / Right を先頭から同時に走査して結合する
+// 現在のスレッドにアリーナがあれば、アリーナから確保する
+template<typename ValueType>
+using TSortedKeyArray = TArray<TPair<FName, ValueType>, FMergeArenaAllocator>;
+
+namespace BlueprintMerge
+{
+	// キーの並び順
+	// 文字列ではなく FName のインデックスで比較するので、同一プロセス内でのみ意味を持つ
+	struct FKeyLess
+	{
+		bool operator()(const FName& A, const FName& B) const
+		{
+			return A.FastLess(B);
+		}
+	};
+
+	// キーでソートし、重複したキーは後から追加した要素を残す (TMap::Emplace と同じ挙動)
+	template<typename ValueType>
+	void SortByKey(TSortedKeyArray<ValueType>& Array)
+	{
+		Algo::StableSort(Array, [](const TPair<FName, ValueType>& A, const TPair<FName, ValueType>& B)
+		{
+			return FKeyLess()(A.Key, B.Key);
+		});
+
+		int32 WriteIndex = 0;
+		for (int32 ReadIndex = 0; ReadIndex < Array.Num(); ++ReadIndex)
+		{
+			if (WriteIndex > 0 && Array[WriteIndex - 1].Key == Array[ReadIndex].Key)
+			{
+				Array[WriteIndex - 1] = MoveTemp(Array[ReadIndex]);
+				continue;
+			}
+
+			if (WriteIndex != ReadIndex)
+			{
+				Array[WriteIndex] = MoveTemp(Array[ReadIndex]);
+			}
+			++WriteIndex;
+		}
+		Array.SetNum(WriteIndex, EAllowShrinking::No);
+	}
+
+	// 二分探索でキーを探す
+	template<typename ValueType>
+	const ValueType* FindByKey(const TSortedKeyArray<ValueType>& Array, const FName& Key)
+	{
+		int32 Min = 0;
+		int32 Max = Array.Num();
+		while (Min < Max)
+		{
+			const int32 Mid = Min + (Max - Min) / 2;
+			if (FKeyLess()(Array[Mid].Key, Key))
+			{
+				Min = Mid + 1;
+			}
+			else
+			{
+				Max = Mid;
+			}
+		}
+		return (Min < Array.Num() && Array[Min].Key == Key) ? &Array[Min].Value : nullptr;
+	}
+
+	// ソート済みのキーを昇順に探すためのカーソル
+	// 差分のキーのように、ソート済みの部分集合で順番に引く場合はハッシュを使わずに線形時間で探せる
+	template<typename ValueType>
+	class TKeyCursor
+	{
+	public:
+		explicit TKeyCursor(const TSortedKeyArray<ValueType>& InArray)
+			: Array(InArray)
+		{
+		}
+
+		// Key 以上の位置まで進めて、一致した要素を返す
+		const ValueType* Seek(const FName& Key)
+		{
+			while (Index < Array.Num() && FKeyLess()(Array[Index].Key, Key))
+			{
+				++Index;
+			}
+			return (Index < Array.Num() && Array[Index].Key == Key) ? &Array[Index].Value : nullptr;
+		}
+
+		// 見つからない場合は既定値を返す (TMap::FindRef と同じ)
+		ValueType SeekRef(const FName& Key)
+		{
+			const ValueType* Value = Seek(Key);
+			return Value ? *Value : ValueType();
+		}
+
+	private:
+		const TSortedKeyArray<ValueType>& Array;
+		int32 Index = 0;
+	};
+
+	namespace Private
+	{
+		// コールバックが bool を返す場合は false で走査を中断する
+		template<typename FuncType, typename... ArgTypes>
+		bool InvokeJoinFunc(FuncType& Func, ArgTypes&&... Args)
+		{
+			if constexpr (std::is_void_v<decltype(Func(Forward<ArgTypes>(Args)...))>)
+			{
+				Func(Forward<ArgTypes>(Args)...);
+				return true;
+			}
+			else
+			{
+				return !!Func(Forward<ArgTypes>(Args)...);
+			}
+		}
+
+		template<typename ValueType>
+		const ValueType* TakeIfMatch(const TSortedKeyArray<ValueType>& Array, int32& Index, const FName& Key)
+		{
+			if (Index < Array.Num() && Array[Index].Key == Key)
+			{
+				return &Array[Index++].Value;
+			}
+			return nullptr;
+		}
+
+		template<typename ValueType>
+		void SelectMinKey(const TSortedKeyArray<ValueType>& Array, int32 Index, const FName*& InOutKey)
+		{
+			if (Index < Array.Num() && (!InOutKey || FKeyLess()(Array[Index].Key, *InOutKey)))
+			{
+				InOutKey = &Array[Index].Key;
+			}
+		}
+	}
+
+	// 3 つのソート済み配列を同時に走査し、キーごとに (Base, Left, Right) を渡す
+	// 存在しない側は nullptr になる
+	// Func(const FName& Key, const BaseType* Base, const LeftType* Left, const RightType* Right)
+	// Func が false を返した場合は中断して false を返す
+	template<typename BaseType, typename LeftType, typename RightType, typename FuncType>
+	bool ThreeWayJoin(const TSortedKeyArray<BaseType>& Base, const TSortedKeyArray<LeftType>& Left, const TSortedKeyArray<RightType>& Right, FuncType&& Func)
+	{
+		int32 BaseIndex = 0;
+		int32 LeftIndex = 0;
+		int32 RightIndex = 0;
+		while (BaseIndex < Base.Num() || LeftIndex < Left.Num() || RightIndex < Right.Num())
+		{
+			// 最も小さいキーを選ぶ
+			const FName* MinKey = nullptr;
+			Private::SelectMinKey(Base, BaseIndex, MinKey);
+			Private::SelectMinKey(Left, LeftIndex, MinKey);
+			Private::SelectMinKey(Right, RightIndex, MinKey);
+
+			const FName Key = *MinKey;
+			const BaseType* BaseValue = Private::TakeIfMatch(Base, BaseIndex, Key);
+			const LeftType* LeftValue = Private::TakeIfMatch(Left, LeftIndex, Key);
+			const RightType* RightValue = Private::TakeIfMatch(Right, RightIndex, Key);
+
+			if (!Private::InvokeJoinFunc(Func, Key, BaseValue, LeftValue, RightValue))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+
+	// 2 つのソート済み配列を同時に走査し、キーごとに (Left, Right) を渡す
+	// Func(const FName& Key, const LeftType* Left, const RightType* Right)
+	template<typename LeftType, typename RightType, typename FuncType>
+	bool TwoWayJoin(const TSortedKeyArray<LeftType>& Left, const TSortedKeyArray<RightType>& Right, FuncType&& Func)
+	{
+		int32 LeftIndex = 0;
+		int32 RightIndex = 0;
+		while (LeftIndex < Left.Num() || RightIndex < Right.Num())
+		{
+			const FName* MinKey = nullptr;
+			Private::SelectMinKey(Left, LeftIndex, MinKey);
+			Private::SelectMinKey(Right, RightIndex, MinKey);
+
+			const FName Key = *MinKey;
+			const LeftType* LeftValue = Private::TakeIfMatch(Left, LeftIndex, Key);
+			const RightType* RightValue = Private::TakeIfMatch(Right, RightIndex, Key);
+
+			if (!Private::InvokeJoinFunc(Func, Key, LeftValue, RightValue))
+			{
+				return false;
+			}
+		}
+		return true;
+	}
+}
@@ -0,0 +1,135 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeLibrary.h"
+#include "Misc/AutomationTest.h"
+#include "GameFramework/Actor.h"
+#include "Engine/Blueprint.h"
+#include "Engine/BlueprintGeneratedClass.h"
+#include "EdGraphSchema_K2.h"
+#include "Kismet2/BlueprintEditorUtils.h"
+#include "Kismet2/KismetEditorUtilities.h"
+
+#if WITH_DEV_AUTOMATION_TESTS
+
+namespace
+{
+	const TCHAR* ScoresName = TEXT("Scores");
+
+	UBlueprint* CreateScoresBlueprint(const FString& Name)
+	{
+		UPackage* Package = CreatePackage(*MakeUniqueObjectName(nullptr, UPackage::StaticClass(), FName(*(FString(TEXT("/Temp/BlueprintMergeKeyedContainerTest/")) + Name))).ToString());
+		Package->SetFlags(RF_Transient);
+
+		UBlueprint* Blueprint = FKismetEditorUtilities::CreateBlueprint(AActor::StaticClass(), Package, FName(*Name), BPTYPE_Normal, UBlueprint::StaticClass(), UBlueprintGeneratedClass::StaticClass());
+
+		// TMap<FName, int32>
+		FEdGraphTerminalType ValueType;
+		ValueType.TerminalCategory = UEdGraphSchema_K2::PC_Int;
+		const FEdGraphPinType MapPinType(UEdGraphSchema_K2::PC_Name, NAME_None, nullptr, EPinContainerType::Map, false, ValueType);
+		FBlueprintEditorUtils::AddMemberVariable(Blueprint, ScoresName, MapPinType);
+
+		FKismetEditorUtilities::CompileBlueprint(Blueprint);
+		return Blueprint;
+	}
+
+	UBlueprint* DuplicateScoresBlueprint(UBlueprint* Source, const FString& Name)
+	{
+		UPackage* Package = CreatePackage(*MakeUniqueObjectName(nullptr, UPackage::StaticClass(), FName(*(FString(TEXT("/Temp/BlueprintMergeKeyedContainerTest/")) + Name))).ToString());
+		Package->SetFlags(RF_Transient);
+		return DuplicateObject(Source, Package, FName(*Name));
+	}
+
+	void DiscardScoresBlueprint(UBlueprint* Blueprint)
+	{
+		UPackage* Package = Blueprint->GetPackage();
+		Blueprint->ClearFlags(RF_Public | RF_Standalone);
+		Blueprint->MarkAsGarbage();
+		Package->MarkAsGarbage();
+	}
+
+	TMap<FName, int32>& GetScores(UBlueprint* Blueprint)
+	{
+		const FMapProperty* Property = FindFProperty<FMapProperty>(Blueprint->GeneratedClass, ScoresName);
+		check(Property);
+		return *Property->ContainerPtrToValuePtr<TMap<FName, int32>>(Blueprint->GeneratedClass->GetDefaultObject());
+	}
+
+	const FBlueprintMergePlanEntry* FindEntry(const FBlueprintMergePlan& Plan, const FString& PathSuffix)
+	{
+		return Plan.Entries.FindByPredicate([&PathSuffix](const FBlueprintMergePlanEntry& Entry)
+		{
+			return Entry.Path.EndsWith(PathSuffix);
+		});
+	}
+
+	// Base の Scores を { A: 1, B: 2, C: 3 } にして、Left と Right を編集してから計画を作る
+	FBlueprintMergePlan PlanScoresMerge(TFunctionRef<void(TMap<FName, int32>&)> EditLeft, TFunctionRef<void(TMap<FName, int32>&)> EditRight)
+	{
+		UBlueprint* Base = CreateScoresBlueprint(TEXT("BP_Base"));
+		UBlueprint* Left = DuplicateScoresBlueprint(Base, TEXT("BP_Left"));
+		UBlueprint* Right = DuplicateScoresBlueprint(Base, TEXT("BP_Right"));
+		for (UBlueprint* Blueprint : { Base, Left, Right })
+		{
+			GetScores(Blueprint) = { { TEXT("A"), 1 }, { TEXT("B"), 2 }, { TEXT("C"), 3 } };
+		}
+		EditLeft(GetScores(Left));
+		EditRight(GetScores(Right));
+
+		const FBlueprintMergePlan Plan = UBlueprintMergeLibrary::PlanBlueprintMerge(Base, Left, Right);
+
+		DiscardScoresBlueprint(Base);
+		DiscardScoresBlueprint(Left);
+		DiscardScoresBlueprint(Right);
+		return Plan;
+	}
+}
+
+// 片側でキーを削除し、もう片側で同じキーの値を変えた場合は、そのキーだけのコンフリクトになるか確かめる
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlueprintMergeKeyedContainerRemoveModifyTest, "BlueprintMerge.KeyedContainer.RemoveVersusModify", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBlueprintMergeKeyedContainerRemoveModifyTest::RunTest(const FString& Parameters)
+{
+	const FBlueprintMergePlan Plan = PlanScoresMerge(
+		[](TMap<FName, int32>& Scores) { Scores.Remove(TEXT("A")); },
+		[](TMap<FName, int32>& Scores) { Scores.Add(TEXT("A"), 10); });
+
+	TestTrue(TEXT("Plan is valid"), Plan.bIsValid);
+	TestEqual(TEXT("Conflicts"), Plan.NumConflicts, 1);
+
+	const FBlueprintMergePlanEntry* KeyEntry = FindEntry(Plan, TEXT("Scores[A]"));
+	if (TestNotNull(TEXT("Conflicting key is reported by its own path"), KeyEntry))
+	{
+		TestTrue(TEXT("Key is a conflict"), KeyEntry->Action == EBlueprintMergePlanAction::Conflict);
+	}
+	TestNull(TEXT("The map itself is not a conflict"), FindEntry(Plan, TEXT("Scores")));
+	return true;
+}
+
+// 1 つのキーがコンフリクトしても、他のキーの変更は両側からマージされるか確かめる
+IMPLEMENT_SIMPLE_AUTOMATION_TEST(FBlueprintMergeKeyedContainerPartialConflictTest, "BlueprintMerge.KeyedContainer.PartialConflict", EAutomationTestFlags::EditorContext | EAutomationTestFlags::EngineFilter)
+
+bool FBlueprintMergeKeyedContainerPartialConflictTest::RunTest(const FString& Parameters)
+{
+	const FBlueprintMergePlan Plan = PlanScoresMerge(
+		[](TMap<FName, int32>& Scores) { Scores.Add(TEXT("A"), 10); Scores.Add(TEXT("B"), 20); },
+		[](TMap<FName, int32>& Scores) { Scores.Add(TEXT("B"), 30); Scores.Remove(TEXT("C")); });
+
+	TestTrue(TEXT("Plan is valid"), Plan.bIsValid);
+	TestEqual(TEXT("Conflicts"), Plan.NumConflicts, 1);
+
+	const FBlueprintMergePlanEntry* KeyEntry = FindEntry(Plan, TEXT("Scores[B]"));
+	if (TestNotNull(TEXT("Conflicting key is reported by its own path"), KeyEntry))
+	{
+		TestTrue(TEXT("Key is a conflict"), KeyEntry->Action == EBlueprintMergePlanAction::Conflict);
+	}
+
+	const FBlueprintMergePlanEntry* MapEntry = FindEntry(Plan, TEXT("Scores"));
+	if (TestNotNull(TEXT("Other keys are merged"), MapEntry))
+	{
+		TestTrue(TEXT("Map merges both sides"), MapEntry->Action == EBlueprintMergePlanAction::Modify && MapEntry->Side == EBlueprintMergePlanSide::Both);
+	}
+	return true;
+}
+
+#endif
@@ -2,909 +2,3036 @@
 
 
 #include "BlueprintMergeLibrary.h"
-#include <regex>
+#include "BlueprintPropertySchema.h"
+#include "BlueprintGraphHash.h"
+#include "BlueprintMergePath.h"
+#include "BlueprintMergeReport.h"
+#include "BlueprintMergeStats.h"
+#include "BlueprintReferenceResolveRules.h"
 #include "AssetRegistry/AssetRegistryModule.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "UObject/SavePackage.h"
+#include "DiffUtils.h"
+#include "ObjectTools.h"
+#include "Serialization/ArchiveReplaceObjectRef.h"
 #include "Kismet2/BlueprintEditorUtils.h"
 #include "Kismet/KismetSystemLibrary.h"
-#include "AssetToolsModule.h"
-#include "Subsystems/EditorAssetSubsystem.h"
 #include "Kismet2/KismetEditorUtilities.h"
 #include "Engine/InheritableComponentHandler.h"
 #include "Engine/SimpleConstructionScript.h"
 #include "Engine/SCS_Node.h"
+#include "EdGraph/EdGraph.h"
+#include "EdGraph/EdGraphNode.h"
 #include "EdGraph/EdGraphPin.h"
+#include "Async/ParallelFor.h"
+#include "HAL/IConsoleManager.h"
 
 
-UE_DISABLE_OPTIMIZATION
+namespace
+{
+	// BeginMergeReport で開いたレポート
+	FBlueprintMergeReport LibraryReport;
+
+	TAutoConsoleVariable<bool> CVarLazyPropertyDiff(
+		TEXT("BlueprintMerge.LazyPropertyDiff"),
+		true,
+		TEXT("Compare properties from the top level and expand only the subtrees that differ."));
+
+	TAutoConsoleVariable<bool> CVarArraySequenceDiff(
+		TEXT("BlueprintMerge.ArraySequenceDiff"),
+		true,
+		TEXT("Diff array properties as element sequences (insertions, deletions and moves) instead of by index."));
+
+	TAutoConsoleVariable<bool> CVarKeyedContainerDiff(
+		TEXT("BlueprintMerge.KeyedContainerDiff"),
+		true,
+		TEXT("Merge map and set properties by joining their elements on the key hash instead of by hash layout order."));
+
+	TAutoConsoleVariable<bool> CVarResolveReferences(
+		TEXT("BlueprintMerge.ResolveReferences"),
+		false,
+		TEXT("Apply the asset reference resolve rules (DT_ReferenceResolveRules.csv) to the merged class default object. Only members changed by the merge or holding a broken reference are rewritten."));
+
+	TAutoConsoleVariable<bool> CVarParallelGraphDiff(
+		TEXT("BlueprintMerge.ParallelGraphDiff"),
+		true,
+		TEXT("Collect the graph triples of all graph types first and compare them in parallel before recording the results in order."));
+
+	// Set / Map の有効な要素のインデックスを並び順に集める
+	template<typename HelperType>
+	void CollectValidIndices(const HelperType& Helper, TArray<int32, FMergeArenaAllocator>& OutIndices)
+	{
+		OutIndices.Reserve(Helper.Num());
+		for (int32 Index = 0; OutIndices.Num() < Helper.Num(); ++Index)
+		{
+			if (Helper.IsValidIndex(Index))
+			{
+				OutIndices.Add(Index);
+			}
+		}
+	}
+}
 
 void UBlueprintMergeLibrary::MergeBlueprint(UObject* WorldContextObject, UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, const FString& OutputName)
 {
-	if (!Base || !Left || !Right)
+	FMergeAnalysis Analysis;
+	if (!InitializeMergeAnalysis(Base, Left, Right, OutputName, Analysis))
 	{
 		return;
 	}
 
-	// ブループリントをマージ
-	UBlueprint* OutputBlueprint = DuplicateObject(Base, WorldContextObject, FName(*OutputName));
+	AnalyzeMerge(Analysis);
+	ApplyMerge(Analysis);
+}
 
-	TMap<FName, FPropertyData> BasePropertyMap = BuildPropertyMap(Base->GeneratedClass->GetDefaultObject());
-	TMap<FName, FPropertyData> LeftPropertyMap = BuildPropertyMap(Left->GeneratedClass->GetDefaultObject());
-	TMap<FName, FPropertyData> RightPropertyMap = BuildPropertyMap(Right->GeneratedClass->GetDefaultObject());
+void UBlueprintMergeLibrary::MergeBlueprintBatch(UObject* WorldContextObject, const TArray<FBlueprintMergeRequest>& Requests)
+{
+	TArray<FMergeAnalysis> Analyses;
+	Analyses.Reserve(Requests.Num());
+	for (const FBlueprintMergeRequest& Request : Requests)
+	{
+		FMergeAnalysis Analysis;
+		if (InitializeMergeAnalysis(Request.Base, Request.Left, Request.Right, Request.OutputName, Analysis))
+		{
+			Analyses.Add(MoveTemp(Analysis));
+		}
+		else
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Skip merge request. OutputName[%s]"), *Request.OutputName);
+		}
+	}
 
-	// プロパティ名をログ出力
-	//for (const TPair<FName, FPropertyData>& Pair : BasePropertyMap)
-	//{
-	//	UE_LOG(LogTemp, Log, TEXT("Base: %s"), *Pair.Key.ToString());
-	//}
-	//for (const TPair<FName, FPropertyData>& Pair : LeftPropertyMap)
-	//{
-	//	UE_LOG(LogTemp, Log, TEXT("Left: %s"), *Pair.Key.ToString());
-	//}
-	//for (const TPair<FName, FPropertyData>& Pair : RightPropertyMap)
-	//{
-	//	UE_LOG(LogTemp, Log, TEXT("Right: %s"), *Pair.Key.ToString());
-	//}
+	// 読み取りのみの解析は並列に行う
+	ParallelFor(Analyses.Num(), [&Analyses](int32 Index)
+	{
+		AnalyzeMerge(Analyses[Index]);
+	});
 
-	TMap<FName, FDiffData> DiffPropertyMap;
+	// アセットの変更とコンパイルはゲームスレッドで順番に行う
+	for (const FMergeAnalysis& Analysis : Analyses)
+	{
+		if (IsMergeAnalysisCurrent(Analysis))
+		{
+			ApplyMerge(Analysis);
+			continue;
+		}
 
-	// マップの要素を結合する
+		// 先に反映したマージのコンパイルで入力が再インスタンス化されたり、入力が出力で置き換えられたりすると、
+		// 解析結果のオブジェクトへのポインタが古くなるので、今のアセットで解析し直す
+		FMergeAnalysis Reanalysis;
+		if (!ReinitializeMergeAnalysis(Analysis, Reanalysis))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Skip merge request whose inputs were replaced. OutputName[%s]"), *Analysis.OutputName);
+			continue;
+		}
 
-	// キーを統合する
-	TSet<FName> UnionPropertyKeys;
-	{
-		TSet<FName> Keys;
-		BasePropertyMap.GetKeys(Keys);
-		UnionPropertyKeys = UnionPropertyKeys.Union(Keys);
-	
-		LeftPropertyMap.GetKeys(Keys);
-		UnionPropertyKeys = UnionPropertyKeys.Union(Keys);
-		
-		RightPropertyMap.GetKeys(Keys);
-		UnionPropertyKeys = UnionPropertyKeys.Union(Keys);
+		UE_LOG(LogTemp, Display, TEXT("Reanalyze merge request whose inputs were changed by an earlier merge. OutputName[%s]"), *Analysis.OutputName);
+		AnalyzeMerge(Reanalysis);
+		ApplyMerge(Reanalysis);
 	}
+}
 
+FBlueprintMergePlan UBlueprintMergeLibrary::PlanBlueprintMerge(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right)
+{
+	FBlueprintMergePlan Plan;
 
-	for (const FName& PropertyPath : UnionPropertyKeys)
+	FMergeAnalysis Analysis;
+	if (!InitializeMergeAnalysis(Base, Left, Right, FString(), Analysis))
 	{
-		const FPropertyData* BasePropertyData = BasePropertyMap.Find(PropertyPath);
-		const FPropertyData* LeftPropertyData = LeftPropertyMap.Find(PropertyPath);
-		const FPropertyData* RightPropertyData = RightPropertyMap.Find(PropertyPath);
+		return Plan;
+	}
+
+	AnalyzeMerge(Analysis);
+	BuildMergePlanWithReport(Analysis, Plan);
+	return Plan;
+}
+
+TArray<FBlueprintMergePlan> UBlueprintMergeLibrary::PlanBlueprintMergeBatch(const TArray<FBlueprintMergeRequest>& Requests)
+{
+	TArray<FBlueprintMergePlan> Plans;
+	Plans.SetNum(Requests.Num());
 
-		EDiffType DiffType = EDiffType::None;
-		bool bIsLeftUpdate = false;
-		bool bIsRightUpdate = false;
+	TArray<FMergeAnalysis> Analyses;
+	Analyses.SetNum(Requests.Num());
 
-		if (BasePropertyData)
+	TArray<int32> ValidIndices;
+	ValidIndices.Reserve(Requests.Num());
+	for (int32 Index = 0; Index < Requests.Num(); ++Index)
+	{
+		const FBlueprintMergeRequest& Request = Requests[Index];
+		Plans[Index].OutputName = Request.OutputName;
+		if (InitializeMergeAnalysis(Request.Base, Request.Left, Request.Right, Request.OutputName, Analyses[Index]))
 		{
-			if (LeftPropertyData && RightPropertyData)
-			{
-				// 差分があるかチェック
-				if (!BasePropertyData->Property->Identical(BasePropertyData->Container, LeftPropertyData->Container))
-				{
-					DiffType = EDiffType::Modify;
-					bIsLeftUpdate = true;
-				}
-				if (!BasePropertyData->Property->Identical(BasePropertyData->Container, RightPropertyData->Container))
-				{
-					DiffType = EDiffType::Modify;
-					bIsRightUpdate = true;
-				}
-			}
-			
-			if (!LeftPropertyData || !RightPropertyData)
-			{
-				DiffType = EDiffType::Remove;
-				bIsLeftUpdate = !!LeftPropertyData;
-				bIsRightUpdate = !!RightPropertyData;
-			}
+			ValidIndices.Add(Index);
 		}
 		else
 		{
-			if (LeftPropertyData || RightPropertyData)
-			{
-				DiffType = EDiffType::Add;
-				bIsLeftUpdate = !!LeftPropertyData;
-				bIsRightUpdate = !!RightPropertyData;
-			}
+			UE_LOG(LogTemp, Warning, TEXT("Skip merge request. OutputName[%s]"), *Request.OutputName);
 		}
+	}
+
+	// レポートに書き出す情報は、計画と一緒に集めておく
+	FBlueprintMergeReport* Report = FBlueprintMergeReport::GetActive();
+	TArray<TArray<FMergePlanRecordSource>> RecordSources;
+	RecordSources.SetNum(Report ? Requests.Num() : 0);
 
-		if (!bIsLeftUpdate && !bIsRightUpdate)
+	// アセットを変更しないので、計画の作成まで並列に行える
+	ParallelFor(ValidIndices.Num(), [&Analyses, &Plans, &ValidIndices, &RecordSources](int32 Index)
+	{
+		const int32 RequestIndex = ValidIndices[Index];
+		AnalyzeMerge(Analyses[RequestIndex]);
+		BuildMergePlan(Analyses[RequestIndex], Plans[RequestIndex], RecordSources.IsValidIndex(RequestIndex) ? &RecordSources[RequestIndex] : nullptr);
+	});
+
+	// レポートへの書き出しはゲームスレッドで順番に行う
+	if (Report)
+	{
+		for (int32 RequestIndex : ValidIndices)
 		{
-			// 差分がない場合はスキップ
-			continue;
+			WriteMergeReport(*Report, Analyses[RequestIndex], Plans[RequestIndex], RecordSources[RequestIndex]);
 		}
-
-		DiffPropertyMap.Emplace(PropertyPath, FDiffData(PropertyPath, DiffType, bIsLeftUpdate, bIsRightUpdate));
 	}
+	return Plans;
+}
+
+EBlueprintMergeResult UBlueprintMergeLibrary::MergeBlueprintFiles(const FString& BaseFilename, const FString& LeftFilename, const FString& RightFilename, const FString& OutputFilename, const FString& OutputPackageName, FBlueprintMergePlan& OutPlan)
+{
+	check(IsInGameThread());
 
-	IAssetTools& AssetTool = FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools").Get();
-	FAssetRegistryModule& AssetRegistryModule = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry"));
-	IAssetRegistry& AssetRegistry = AssetRegistryModule.Get();
-	FAssetData AssetData(Base);
+	// 出力先が入力と同じファイルの場合もあるので、先に全て読み込む
+	UBlueprint* Base = LoadBlueprintFile(BaseFilename, OutputPackageName, TEXT("Base"));
+	UBlueprint* Left = LoadBlueprintFile(LeftFilename, OutputPackageName, TEXT("Left"));
+	UBlueprint* Right = LoadBlueprintFile(RightFilename, OutputPackageName, TEXT("Right"));
 
-	FString OutputPath = AssetData.PackagePath.ToString() / OutputName;
-	UEditorAssetSubsystem* EditorAssetSubsystem = GEditor->GetEditorSubsystem<UEditorAssetSubsystem>();
-	if (EditorAssetSubsystem->DoesAssetExist(*OutputPath))
+	const EBlueprintMergeResult Result = [&]()
 	{
-		// すでにアセットが存在する場合は削除
-		EditorAssetSubsystem->DeleteAsset(*OutputPath);
-	}
+		if (!Base || !Left || !Right)
+		{
+			return EBlueprintMergeResult::Error;
+		}
 
-	if (UBlueprint* MergedBlueprint =  Cast<UBlueprint>(AssetTool.DuplicateAsset(OutputName, AssetData.PackagePath.ToString(), Base)))
-	{
-		// プロパティを更新
-		TMap<FName, FPropertyData> MergedAssetPropertyMap = BuildPropertyMap(MergedBlueprint->GeneratedClass->GetDefaultObject());
+		FMergeAnalysis Analysis;
+		if (!InitializeMergeAnalysis(Base, Left, Right, Base->GetName(), Analysis))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Failed to analyze blueprints. Base[%s] Left[%s] Right[%s]"), *BaseFilename, *LeftFilename, *RightFilename);
+			return EBlueprintMergeResult::Error;
+		}
 
-		MergeBlueprintMemberVariables(Base, BasePropertyMap, Left, LeftPropertyMap, Right, RightPropertyMap, DiffPropertyMap, UnionPropertyKeys, MergedAssetPropertyMap, MergedBlueprint);
-		
-		// ブループリントをコンパイルして、デフォルトオブジェクトを再生成してから、再度プロパティマップを構築する
-		FKismetEditorUtilities::CompileBlueprint(MergedBlueprint);
-		MergedAssetPropertyMap = BuildPropertyMap(MergedBlueprint->GeneratedClass->GetDefaultObject());
+		AnalyzeMerge(Analysis);
+		BuildMergePlanWithReport(Analysis, OutPlan);
+		if (!OutPlan.IsClean())
+		{
+			return EBlueprintMergeResult::Conflict;
+		}
 
-		for (TPair<FName, FDiffData>& Pair : DiffPropertyMap)
+		UBlueprint* MergedBlueprint = BuildMergedBlueprint(Analysis);
+		if (!MergedBlueprint || !SaveBlueprintFile(MergedBlueprint, OutputFilename, OutputPackageName))
 		{
-			FName PropertyPath = Pair.Key;
-			const FDiffData& DiffPropertyData = Pair.Value;
+			return EBlueprintMergeResult::Error;
+		}
+		return EBlueprintMergeResult::Clean;
+	}();
 
-			const FPropertyData* LeftPropertyData = LeftPropertyMap.Find(PropertyPath);
-			const FPropertyData* RightPropertyData = RightPropertyMap.Find(PropertyPath);
-			const FPropertyData* MergedPropertyData = MergedAssetPropertyMap.Find(PropertyPath);
+	// 読み込んだパッケージは、次の GC で破棄されるようにする
+	// 同じアセットを繰り返しマージしても、パッケージが残り続けないようにする
+	for (UBlueprint* Blueprint : { Base, Left, Right })
+	{
+		if (Blueprint)
+		{
+			UnloadPackage(Blueprint->GetPackage());
+		}
+	}
+	return Result;
+}
 
-			if (DiffPropertyData.IsNoDifference())
-			{
-				// 差分がない場合はスキップ
-				continue;
-			}
+bool UBlueprintMergeLibrary::BeginMergeReport(const FString& Filename, bool bIncludeValues)
+{
+	if (!LibraryReport.Open(Filename, bIncludeValues))
+	{
+		return false;
+	}
 
-			if (DiffPropertyData.IsLeftUpdate() && DiffPropertyData.IsRightUpdate())
-			{
-				// コンフリクト
-				continue;
-			}
+	FBlueprintMergeReport::SetActive(&LibraryReport);
+	return true;
+}
 
-			if (MergedPropertyData)
-			{
-				if (DiffPropertyData.IsLeftUpdate())
-				{
-					MergedPropertyData->Property->CopyCompleteValue(const_cast<void*>(MergedPropertyData->Container), LeftPropertyData->Container);
-				}
-				else if (DiffPropertyData.IsRightUpdate())
-				{
-					MergedPropertyData->Property->CopyCompleteValue(const_cast<void*>(MergedPropertyData->Container), RightPropertyData->Container);
-				}
-			}
-		}
+void UBlueprintMergeLibrary::EndMergeReport()
+{
+	LibraryReport.Close();
+}
 
-		// コンポーネントをマージ
-		MergeBlueprintComponents(Base, Left, Right, MergedBlueprint);
+bool UBlueprintMergeLibrary::InitializeMergeAnalysis(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, const FString& OutputName, FMergeAnalysis& OutAnalysis)
+{
+	check(IsInGameThread());
 
-		// 各種グラフをマージ
-		MergeFunctionGraphs(Base, Left, Right, MergedBlueprint, EGraphType::Function);
-		//MergeFunctionGraphs(Base, Left, Right, MergedBlueprint, EGraphType::Event);
-		MergeFunctionGraphs(Base, Left, Right, MergedBlueprint, EGraphType::Macro);
-		MergeFunctionGraphs(Base, Left, Right, MergedBlueprint, EGraphType::Delegate);
-		MergeFunctionGraphs(Base, Left, Right, MergedBlueprint, EGraphType::Ubergraph);
+	if (!Base || !Left || !Right)
+	{
+		return false;
 	}
-	else
+
+	if (!Base->GeneratedClass || !Left->GeneratedClass || !Right->GeneratedClass)
 	{
-		UE_LOG(LogTemp, Error, TEXT("Failed to create a new blueprint."));
+		return false;
 	}
-}
 
+	OutAnalysis.Base = Base;
+	OutAnalysis.Left = Left;
+	OutAnalysis.Right = Right;
+	OutAnalysis.OutputName = OutputName;
 
-TMap<FName, UBlueprintMergeLibrary::FPropertyData> UBlueprintMergeLibrary::BuildPropertyMap(UObject* Target, EBuildPropertyMapOption Option)
-{
-	TMap<FName, FPropertyData> PropertyMap;
+	// CDO の生成はスレッドセーフではないので、ここで取得しておく
+	OutAnalysis.BaseDefaultObject = Base->GeneratedClass->GetDefaultObject();
+	OutAnalysis.LeftDefaultObject = Left->GeneratedClass->GetDefaultObject();
+	OutAnalysis.RightDefaultObject = Right->GeneratedClass->GetDefaultObject();
 
-	for (TPropertyValueIterator<FProperty> PropertyIterator(Target->GetClass(), Target); PropertyIterator; ++PropertyIterator)
+	UBlueprint* const Blueprints[] = { Base, Left, Right };
+	UObject* const DefaultObjects[] = { OutAnalysis.BaseDefaultObject, OutAnalysis.LeftDefaultObject, OutAnalysis.RightDefaultObject };
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(Blueprints); ++Index)
 	{
-		// Transient プロパティはスキップ
-		if (PropertyIterator->Key->HasAnyPropertyFlags(CPF_Transient) ||
-			PropertyIterator->Key->HasAnyPropertyFlags(CPF_EditConst))
-		{
-			continue;
-		}
+		FMergeInputSnapshot& Input = OutAnalysis.Inputs[Index];
+		Input.Path = FSoftObjectPath(Blueprints[Index]);
+		Input.Blueprint = Blueprints[Index];
+		Input.GeneratedClass = Blueprints[Index]->GeneratedClass;
+		Input.DefaultObject = DefaultObjects[Index];
+	}
 
+	// キャッシュのデリゲート登録をゲームスレッドで済ませておく
+	FBlueprintPropertySchemaCache::Get();
+	return true;
+}
 
-		FString PropertyPath;
+bool UBlueprintMergeLibrary::IsMergeAnalysisCurrent(const FMergeAnalysis& Analysis)
+{
+	check(IsInGameThread());
 
-		bool bIsArrayElement = false;
-		if (PropertyIterator->Key->Owner.IsA<FArrayProperty>())
+	for (const FMergeInputSnapshot& Input : Analysis.Inputs)
+	{
+		UBlueprint* Blueprint = Input.Blueprint.Get();
+		if (!IsValid(Blueprint) || Input.Path.ResolveObject() != Blueprint)
 		{
-			bIsArrayElement = true;
+			// 破棄されたか、同じパスが別のブループリント (先のマージの出力) に置き換えられた
+			return false;
 		}
 
-		if ((Option != EBuildPropertyMapOption::IncludeCompositeType) &&
-			(	PropertyIterator->Key->IsA<FArrayProperty>() ||
-				PropertyIterator->Key->IsA<FMapProperty>() ||
-				PropertyIterator->Key->IsA<FSetProperty>() ||
-				PropertyIterator->Key->IsA<FStructProperty>()
-				))
+		UClass* GeneratedClass = Input.GeneratedClass.Get();
+		if (!IsValid(GeneratedClass) || Blueprint->GeneratedClass != GeneratedClass || GeneratedClass->GetDefaultObject(false) != Input.DefaultObject.Get())
 		{
-			continue;
+			// コンパイルで生成クラスか CDO が作り直された
+			return false;
 		}
+	}
+	return true;
+}
 
-		// PropertyA.PropertyB.PropertyC... という形式に変換する
-		TArray<const FProperty*> PropertyChain;
-		PropertyIterator.GetPropertyChain(PropertyChain);
-		Algo::Reverse(PropertyChain);
-		for (const FProperty* Property : PropertyChain)
+bool UBlueprintMergeLibrary::ReinitializeMergeAnalysis(const FMergeAnalysis& StaleAnalysis, FMergeAnalysis& OutAnalysis)
+{
+	UBlueprint* Blueprints[UE_ARRAY_COUNT(StaleAnalysis.Inputs)];
+	for (int32 Index = 0; Index < UE_ARRAY_COUNT(StaleAnalysis.Inputs); ++Index)
+	{
+		Blueprints[Index] = Cast<UBlueprint>(StaleAnalysis.Inputs[Index].Path.ResolveObject());
+		if (!IsValid(Blueprints[Index]))
 		{
-			FString AppendName = Property->GetName();
-			if (Property == PropertyIterator->Key)
-			{
-				if (bIsArrayElement)
-				{
-					AppendName = FString::Printf(TEXT("[%d]"), Property->GetIndexInOwner());
-				}
-			}
-			PropertyPath += ((PropertyPath.IsEmpty() || bIsArrayElement) ? "" : ".") + AppendName;
+			return false;
 		}
+	}
+	return InitializeMergeAnalysis(Blueprints[0], Blueprints[1], Blueprints[2], StaleAnalysis.OutputName, OutAnalysis);
+}
+
+void UBlueprintMergeLibrary::AnalyzeMerge(FMergeAnalysis& InOutAnalysis)
+{
+	BLUEPRINT_MERGE_SCOPE(Analyze);
 
-		PropertyMap.Emplace(FName(*PropertyPath), FPropertyData(PropertyIterator.Key(), PropertyIterator.Value()));
+	// 差分のパスは解析ごとのテーブルに登録し、マップは解析ごとのアリーナから確保する
+	FBlueprintMergePathTable::FScope PathScope(&InOutAnalysis.Paths.Get());
+	FMergeArena::FScope ArenaScope(&InOutAnalysis.Arena.Get());
+
+	// プロパティの差分
+	{
+		BLUEPRINT_MERGE_SCOPE(DiffProperties);
+		DiffObjectProperties(InOutAnalysis.BaseDefaultObject, InOutAnalysis.LeftDefaultObject, InOutAnalysis.RightDefaultObject, false, InOutAnalysis.Properties);
 	}
 
-	return PropertyMap;
+	// コンポーネントの差分
+	DiffBlueprintComponents(InOutAnalysis.Base, InOutAnalysis.Left, InOutAnalysis.Right, InOutAnalysis.Components);
+
+	// 各種グラフの差分
+	DiffBlueprintGraphs(InOutAnalysis.Base, InOutAnalysis.Left, InOutAnalysis.Right, InOutAnalysis.Graphs);
 }
 
-TMap<FName, USCS_Node*> UBlueprintMergeLibrary::BuildSCSNodeMap(UBlueprintGeneratedClass* BPGC)
+TConstArrayView<UBlueprintMergeLibrary::EGraphType> UBlueprintMergeLibrary::GetAnalyzedGraphTypes()
 {
-	TMap<FName, USCS_Node*> SCSNodeMap;
-	TArray<USCS_Node*> SCSNodes = BPGC->SimpleConstructionScript->GetRootNodes();
-	for (USCS_Node* Node : SCSNodes)
+	static const EGraphType GraphTypes[] =
 	{
-		if (Node->ComponentClass->IsChildOf(UActorComponent::StaticClass()))
-		{
-			FString Path = Node->GetVariableName().ToString();
-			SCSNodeMap.Emplace(FName(*Path), Node);
-			BuildSCSNodeMapRecursive(Node, Path, SCSNodeMap);
-		}
-	}
+		EGraphType::Function,
+		//EGraphType::Event,
+		EGraphType::Macro,
+		EGraphType::Delegate,
+		EGraphType::Ubergraph,
+	};
+	return GraphTypes;
+}
 
-	return SCSNodeMap;
+TConstArrayView<UBlueprintMergeLibrary::EGraphType> UBlueprintMergeLibrary::GetAllGraphTypes()
+{
+	static const EGraphType GraphTypes[] =
+	{
+		EGraphType::Function,
+		EGraphType::Event,
+		EGraphType::Macro,
+		EGraphType::Delegate,
+		EGraphType::Ubergraph,
+	};
+	return GraphTypes;
 }
 
-void UBlueprintMergeLibrary::BuildSCSNodeMapRecursive(USCS_Node* Node, const FString& Path, TMap<FName, USCS_Node*>& InOutMap)
+void UBlueprintMergeLibrary::ApplyMerge(const FMergeAnalysis& Analysis)
 {
-	for (USCS_Node* ChildNode : Node->GetChildNodes())
+	check(IsInGameThread());
+
+	if (FBlueprintMergeReport::GetActive())
+	{
+		FBlueprintMergePlan Plan;
+		BuildMergePlanWithReport(Analysis, Plan);
+	}
+
+	// マージは一時パッケージの複製で行い、出力先のパッケージには最後に一度だけ書き込む
+	UBlueprint* MergedBlueprint = BuildMergedBlueprint(Analysis);
+	if (!MergedBlueprint)
 	{
-		InOutMap.Emplace(FName(*(Path + TEXT('.') + ChildNode->GetVariableName().ToString())), ChildNode);
-		BuildSCSNodeMapRecursive(ChildNode, Path, InOutMap);
+		UE_LOG(LogTemp, Error, TEXT("Failed to create a new blueprint."));
+		return;
 	}
+
+	const FString OutputPackageName = FPackageName::GetLongPackagePath(Analysis.Base->GetPackage()->GetName()) / Analysis.OutputName;
+	CommitMergedBlueprint(MergedBlueprint, OutputPackageName);
 }
 
-TMap<FName, UEdGraph*> UBlueprintMergeLibrary::BuildGraphMap(UBlueprint* Blueprint, EGraphType Type)
+UBlueprint* UBlueprintMergeLibrary::BuildMergedBlueprint(const FMergeAnalysis& Analysis)
 {
-	TMap<FName, UEdGraph*> GraphNodeMap;
+	check(IsInGameThread());
+
+	// 解析結果のパスと照合するので、解析と同じテーブルを使う
+	// 一時的なマップは解析のアリーナから確保し、解析と一緒に解放する
+	FBlueprintMergePathTable::FScope PathScope(&Analysis.Paths.Get());
+	FMergeArena::FScope ArenaScope(&Analysis.Arena.Get());
 
-	TArray<UEdGraph*> RootGraphs;
-	if (Type == EGraphType::None)
+	UBlueprint* Base = Analysis.Base;
+	const FPropertyDiffResult& Properties = Analysis.Properties;
+
+	UBlueprint* MergedBlueprint = nullptr;
 	{
-		return GraphNodeMap;
+		BLUEPRINT_MERGE_SCOPE(Duplicate);
+		MergedBlueprint = DuplicateToTransientPackage(Base, Analysis.OutputName);
 	}
 
-	if (Type == EGraphType::Function)
+	if (!MergedBlueprint)
 	{
-		RootGraphs = Blueprint->FunctionGraphs;
+		return nullptr;
 	}
-	else if (Type == EGraphType::Event)
+
+	// 構造の変更 (変数・コンポーネント・グラフ) をまとめて反映し、コンパイルは最後に一度だけ行う
+	bool bStructureChanged = false;
 	{
-		RootGraphs = Blueprint->EventGraphs;
+		BLUEPRINT_MERGE_SCOPE(MergeVariables);
+		FPropertyMap MergedAssetPropertyMap = BuildPropertyMap(MergedBlueprint->GeneratedClass->GetDefaultObject());
+		bStructureChanged |= MergeBlueprintMemberVariables(Base, Properties.BasePropertyMap, Analysis.Left, Properties.LeftPropertyMap, Analysis.Right, Properties.RightPropertyMap, Properties.DiffPropertyMap, MergedAssetPropertyMap, MergedBlueprint);
 	}
-	else if (Type == EGraphType::Macro)
+
+	// コンポーネントをマージ
+	bStructureChanged |= MergeBlueprintComponents(Analysis.Components, MergedBlueprint);
+
+	// 各種グラフをマージ
+	for (const FGraphDiffResult& GraphDiff : Analysis.Graphs)
 	{
-		RootGraphs = Blueprint->MacroGraphs;
+		bStructureChanged |= MergeFunctionGraphs(GraphDiff, MergedBlueprint);
 	}
-	else if (Type == EGraphType::Delegate)
+
+	// デフォルト値だけの変更であれば、コンパイルせずに書き込む
+	if (bStructureChanged)
 	{
-		RootGraphs = Blueprint->DelegateSignatureGraphs;
+		BLUEPRINT_MERGE_SCOPE(Compile);
+		FKismetEditorUtilities::CompileBlueprint(MergedBlueprint);
 	}
-	else if (Type == EGraphType::Ubergraph)
+
+	// コンパイルで CDO が作り直されるので、デフォルト値はコンパイルの後に反映する
 	{
-		RootGraphs = Blueprint->UbergraphPages;
+		BLUEPRINT_MERGE_SCOPE(ApplyDefaultValues);
+		ApplyObjectPropertyDiff(Properties, MergedBlueprint->GeneratedClass->GetDefaultObject());
+		ApplyComponentTemplateDiffs(Analysis.Components, MergedBlueprint);
 	}
 
-	for (UEdGraph* Graph : RootGraphs)
+	// マージで変えたメンバー変数の、ルールのパターンに一致しないアセットへの参照を付け替える
+	if (CVarResolveReferences.GetValueOnGameThread())
 	{
-		FString Path = Graph->GetName();
-		GraphNodeMap.Emplace(FName(*Path), Graph);
-
-		TArray<UEdGraph*> ChildGraphs;
-		Graph->GetAllChildrenGraphs(ChildGraphs);
-		for (UEdGraph* ChildGraph : ChildGraphs)
+		TSet<FName> AppliedMembers;
+		for (const TPair<FName, FDiffData>& Pair : Properties.DiffPropertyMap)
 		{
-			BuildGraphMapRecursive(ChildGraph, Path, GraphNodeMap);
+			// 片側の変更と、両側を合わせたコンテナだけが反映される (コンフリクトは Base の値が残る)
+			const FDiffData& DiffData = Pair.Value;
+			if (DiffData.GetDiffType() == EDiffType::Merge || DiffData.IsLeftUpdate() != DiffData.IsRightUpdate())
+			{
+				AppliedMembers.Add(FBlueprintMergePathTable::GetRootName(Pair.Key));
+			}
 		}
+		FBlueprintReferenceResolveRules::Get().ResolveMemberReferences(MergedBlueprint->GeneratedClass->GetDefaultObject(), AppliedMembers);
 	}
-	return GraphNodeMap;
+	return MergedBlueprint;
 }
 
-void UBlueprintMergeLibrary::BuildGraphMapRecursive(UEdGraph* Graph, const FString& Path, TMap<FName, UEdGraph*>& InOutMap)
+UBlueprint* UBlueprintMergeLibrary::LoadBlueprintFile(const FString& Filename, const FString& OriginalPackageName, const TCHAR* Label)
 {
-	InOutMap.Emplace(FName(*(Path + TEXT('.') + Graph->GetName())), Graph);
+	// 拡張子のないファイル (git の一時ファイルなど) も読めるように、差分用のディレクトリにコピーする
+	const FString TempFilename = FPaths::CreateTempFilename(*FPaths::DiffDir(), *(FString(Label) + TEXT("-")), *FPackageName::GetAssetPackageExtension());
+	if (IFileManager::Get().Copy(*TempFilename, *Filename) != COPY_OK)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to copy %s file. Filename[%s]"), Label, *Filename);
+		return nullptr;
+	}
+
+	// 元のパッケージ名がわかる場合は、パッケージ内の参照を読み込んだパッケージに付け替える
+	const FPackagePath TempPackagePath = FPackagePath::FromLocalPath(TempFilename);
+	FPackagePath OriginalPackagePath = TempPackagePath;
+	if (!OriginalPackageName.IsEmpty())
+	{
+		FPackagePath::TryFromPackageName(OriginalPackageName, OriginalPackagePath);
+	}
 
-	TArray<UEdGraph*> ChildGraphs;
-	Graph->GetAllChildrenGraphs(ChildGraphs);
-	for (UEdGraph* ChildGraph : ChildGraphs)
+	UPackage* Package = DiffUtils::LoadPackageForDiff(TempPackagePath, OriginalPackagePath);
+	UBlueprint* Blueprint = Package ? Cast<UBlueprint>(Package->FindAssetInPackage()) : nullptr;
+	if (!Blueprint)
 	{
-		BuildGraphMapRecursive(ChildGraph, Path, InOutMap);
+		UE_LOG(LogTemp, Error, TEXT("Failed to load %s blueprint. Filename[%s]"), Label, *Filename);
 	}
+	return Blueprint;
 }
 
-TMap<FName, UEdGraphNode*> UBlueprintMergeLibrary::BuildGraphNodesMap(UEdGraph* Graph)
+bool UBlueprintMergeLibrary::SaveBlueprintFile(UBlueprint* MergedBlueprint, const FString& Filename, const FString& PackageName)
 {
-	TMap<FName, UEdGraphNode*> GraphNodeMap;
-	for (UEdGraphNode* Node : Graph->Nodes)
+	const FString OutputPackageName = PackageName.IsEmpty() ? FString(TEXT("/Temp/BlueprintMerge/Output/")) + MergedBlueprint->GetName() : PackageName;
+	UPackage* OutputPackage = FindPackage(nullptr, *OutputPackageName);
+	const bool bNewPackage = !OutputPackage;
+	if (bNewPackage)
 	{
-		FString Path = Node->GetName();
-		GraphNodeMap.Emplace(FName(*Path), Node);
+		OutputPackage = CreatePackage(*OutputPackageName);
 	}
-	return GraphNodeMap;
+	else if (UBlueprint* ExistingBlueprint = FindObjectFast<UBlueprint>(OutputPackage, MergedBlueprint->GetFName()))
+	{
+		// 前のマージの出力が GC されずに残っている場合は、同じ名前を空ける
+		DiscardBlueprint(ExistingBlueprint);
+	}
+
+	// 生成クラスも一緒に移動する
+	UPackage* TempPackage = MergedBlueprint->GetPackage();
+	MergedBlueprint->Rename(nullptr, OutputPackage, REN_DontCreateRedirectors | REN_NonTransactional);
+	MergedBlueprint->SetFlags(RF_Public | RF_Standalone);
+	TempPackage->MarkAsGarbage();
+
+	// 出力先が入力と同じファイルでも壊さないように、別のファイルに保存してから置き換える
+	const FString TempFilename = FPaths::CreateTempFilename(*FPaths::DiffDir(), TEXT("Output-"), *FPackageName::GetAssetPackageExtension());
+
+	FSavePackageArgs SaveArgs;
+	SaveArgs.TopLevelFlags = RF_Public | RF_Standalone;
+	SaveArgs.Error = GWarn;
+	bool bSaved = UPackage::SavePackage(OutputPackage, MergedBlueprint, *TempFilename, SaveArgs);
+	if (!bSaved)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to save merged blueprint. Filename[%s]"), *TempFilename);
+	}
+	else if (!IFileManager::Get().Move(*Filename, *TempFilename, true))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write merged blueprint. Filename[%s]"), *Filename);
+		bSaved = false;
+	}
+
+	// 保存したブループリントはもう使わないので、次の GC で破棄されるようにする
+	// 出力先のパッケージを作った場合は、パッケージごと破棄する
+	if (bNewPackage)
+	{
+		UnloadPackage(OutputPackage);
+	}
+	else
+	{
+		DiscardBlueprint(MergedBlueprint);
+	}
+	return bSaved;
 }
 
-TMap<FName, UEdGraphPin*> UBlueprintMergeLibrary::BuildGraphPinsMap(UEdGraphNode* Node)
+void UBlueprintMergeLibrary::UnloadPackage(UPackage* Package)
 {
-	TMap<FName, UEdGraphPin*> GraphPinMap;
-	for (UEdGraphPin* Pin : Node->Pins)
+	// RF_Standalone が残っていると、参照がなくても GC で破棄されない
+	ForEachObjectWithPackage(Package, [](UObject* Object)
 	{
-		FString Path = Pin->GetName();
-		GraphPinMap.Emplace(FName(*Path), Pin);
-	}
-	return GraphPinMap;
+		Object->ClearFlags(RF_Public | RF_Standalone);
+		Object->MarkAsGarbage();
+		return true;
+	});
+	Package->ClearFlags(RF_Standalone);
+	Package->MarkAsGarbage();
 }
 
-FString UBlueprintMergeLibrary::GetObjectPath(UObject* Root, UObject* Object, bool bRequiredRootName)
+UBlueprint* UBlueprintMergeLibrary::DuplicateToTransientPackage(UBlueprint* Source, const FString& Name)
 {
-	if (!Root || !Object)
+	// 同じ出力名で繰り返しマージしても衝突しないように、パッケージ名は一意にする
+	const FName TempPackageName = MakeUniqueObjectName(nullptr, UPackage::StaticClass(), FName(*(FString(TEXT("/Temp/BlueprintMerge/")) + Name)));
+	UPackage* TempPackage = CreatePackage(*TempPackageName.ToString());
+	TempPackage->SetFlags(RF_Transient);
+
+	// 出力と同じ名前にしておくと、出力先に移すときに名前を変えなくてよい
+	BLUEPRINT_MERGE_COUNTER_ADD(ObjectsDuplicated, 1);
+	return DuplicateObject(Source, TempPackage, FName(*Name));
+}
+
+void UBlueprintMergeLibrary::CommitMergedBlueprint(UBlueprint* MergedBlueprint, const FString& OutputPackageName)
+{
+	BLUEPRINT_MERGE_SCOPE(Commit);
+
+	UPackage* TempPackage = MergedBlueprint->GetPackage();
+	const FName OutputName = MergedBlueprint->GetFName();
+
+	UPackage* OutputPackage = FindPackage(nullptr, *OutputPackageName);
+	if (!OutputPackage && FPackageName::DoesPackageExist(OutputPackageName))
 	{
-		return FString();
+		OutputPackage = LoadPackage(nullptr, *OutputPackageName, LOAD_NoWarn | LOAD_Quiet);
 	}
 
-	UObject* Current = Object;
-	FString Path = Current->GetName();
-	while (true)
+	UBlueprint* ExistingBlueprint = OutputPackage ? FindObjectFast<UBlueprint>(OutputPackage, OutputName) : nullptr;
+	if (ExistingBlueprint && IdenticalBlueprints(ExistingBlueprint, MergedBlueprint))
 	{
-		if (Current->GetOuter())
-		{
-			Current = Current->GetOuter();
-		}
-		else
-		{
-			return TEXT("");
-		}
+		// 既存の出力と同じなので書き込まない
+		DiscardBlueprint(MergedBlueprint);
+		TempPackage->MarkAsGarbage();
+		return;
+	}
 
-		if (Current == Root)
-		{
-			break;
-		}
-		Path = Current->GetName() + TEXT(".") + Path;	
+	if (ExistingBlueprint)
+	{
+		// 既存の出力を退避して、同じ名前を空ける
+		// 参照を付け替えるまでは破棄しない
+		RenameToTransientPackage(ExistingBlueprint);
 	}
 
-	if (bRequiredRootName)
+	const bool bNewPackage = !OutputPackage;
+	if (bNewPackage)
 	{
-		Path = Root->GetName() + TEXT(".") + Path;
+		OutputPackage = CreatePackage(*OutputPackageName);
 	}
-	return Path;
+
+	// 生成クラスも一緒に移動する
+	MergedBlueprint->Rename(nullptr, OutputPackage, REN_DontCreateRedirectors | REN_NonTransactional);
+	TempPackage->MarkAsGarbage();
+
+	if (ExistingBlueprint)
+	{
+		// 既存の出力を参照しているアセットやインスタンス (生成クラスを含む) を、マージ結果に付け替えてから破棄する
+		TArray<UObject*> ObjectsToConsolidate = { ExistingBlueprint };
+		TSet<UObject*> ObjectsToConsolidateWithin;
+		TSet<UObject*> ObjectsToNotConsolidateWithin;
+		ObjectTools::ConsolidateObjects(MergedBlueprint, ObjectsToConsolidate, ObjectsToConsolidateWithin, ObjectsToNotConsolidateWithin, false);
+		DiscardBlueprint(ExistingBlueprint);
+	}
+	else
+	{
+		FAssetRegistryModule::AssetCreated(MergedBlueprint);
+	}
+	OutputPackage->MarkPackageDirty();
 }
 
-void UBlueprintMergeLibrary::MergeBlueprintMemberVariables(UBlueprint* Base, const TMap<FName, FPropertyData>& BasePropertyMap, UBlueprint* Left, const TMap<FName, FPropertyData>& LeftPropertyMap, UBlueprint* Right, const TMap<FName, FPropertyData>& RightPropertyMap, const TMap<FName, FDiffData>& DiffPropertyMap, const TSet<FName>& UnionPropertyKeys, const TMap<FName, FPropertyData>& MergedPropertyMap, UBlueprint* InOutMergedBlueprint)
+void UBlueprintMergeLibrary::RenameToTransientPackage(UBlueprint* Blueprint)
 {
-	if (!Base || !Left || !Right || !InOutMergedBlueprint)
+	if (Blueprint->GetOuter() == GetTransientPackage())
 	{
 		return;
 	}
 
-	for (const TPair<FName, FDiffData>& Pair : DiffPropertyMap)
+	const FName DiscardedName = MakeUniqueObjectName(GetTransientPackage(), UBlueprint::StaticClass(), Blueprint->GetFName());
+	Blueprint->Rename(*DiscardedName.ToString(), GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional | REN_DoNotDirty);
+}
+
+void UBlueprintMergeLibrary::DiscardBlueprint(UBlueprint* Blueprint)
+{
+	RenameToTransientPackage(Blueprint);
+	Blueprint->ClearFlags(RF_Public | RF_Standalone);
+	Blueprint->MarkAsGarbage();
+}
+
+bool UBlueprintMergeLibrary::IdenticalBlueprints(UBlueprint* Left, UBlueprint* Right)
+{
+	if (!Left || !Right || !Left->GeneratedClass || !Right->GeneratedClass)
 	{
-		FName PropertyPath = Pair.Key;
-		const FDiffData& DiffPropertyData = Pair.Value;
+		return false;
+	}
 
-		const FPropertyData* LeftPropertyData = LeftPropertyMap.Find(PropertyPath);
-		const FPropertyData* RightPropertyData = RightPropertyMap.Find(PropertyPath);
-		const FPropertyData* MergedPropertyData = MergedPropertyMap.Find(PropertyPath);
+	FMergeArena Arena;
+	FMergeArena::FScope ArenaScope(&Arena);
+	FBlueprintMergePathTable Paths;
+	FBlueprintMergePathTable::FScope PathScope(&Paths);
 
-		if (DiffPropertyData.IsNoDifference())
-		{
-			// 差分がない場合はスキップ
-			continue;
-		}
+	UObject* LeftRoot = Left->GetOutermostObject();
+	UObject* RightRoot = Right->GetOutermostObject();
 
-		if (DiffPropertyData.GetDiffType() != EDiffType::Remove &&
-			(DiffPropertyData.IsLeftUpdate() && DiffPropertyData.IsRightUpdate()))
+	auto IdenticalObjects = [LeftRoot, RightRoot](UObject* LeftObject, UObject* RightObject)
+	{
+		if (!LeftObject || !RightObject)
 		{
-			// コンフリクト
-			continue;
+			return LeftObject == RightObject;
 		}
 
-		UBlueprint* UpdatedBlueprint = DiffPropertyData.IsLeftUpdate() ? Left : Right;
-		const FPropertyData* UpdatedPropertyData = DiffPropertyData.IsLeftUpdate() ? LeftPropertyData : RightPropertyData;
-
-		if (!MergedPropertyData)
+		FPropertyMap LeftPropertyMap = BuildPropertyMap(LeftObject);
+		FPropertyMap RightPropertyMap = BuildPropertyMap(RightObject);
+		return BlueprintMerge::TwoWayJoin(LeftPropertyMap, RightPropertyMap,
+			[LeftRoot, RightRoot](const FName& PropertyPath, const FPropertyData* LeftPropertyData, const FPropertyData* RightPropertyData)
 		{
-			if (DiffPropertyData.GetDiffType() == EDiffType::Add)
+			if (LeftPropertyData && RightPropertyData && FBlueprintMergePathTable::PathContains(PropertyPath, TEXT("GUID")))
 			{
-				int32 VariableIndex = FBlueprintEditorUtils::FindNewVariableIndex(UpdatedBlueprint, PropertyPath);
-				// プロパティが見つからない場合は何もしない
-				if (VariableIndex < 0)
-				{
-					continue;
-				}
-
-				FBPVariableDescription& VariableDesc = UpdatedBlueprint->NewVariables[VariableIndex];
-				FBlueprintEditorUtils::AddMemberVariable(InOutMergedBlueprint, PropertyPath, VariableDesc.VarType, TEXT(""));
+				// GUIDは複製で作り直されることがあるため比較しない
+				return true;
 			}
+			return LeftPropertyData && RightPropertyData && IdenticalProperties(LeftRoot, *LeftPropertyData, RightRoot, *RightPropertyData);
+		});
+	};
+
+	// ブループリント自身のプロパティ (メンバー変数の定義・メタデータ・レプリケーションの設定を含む)
+	if (!IdenticalObjects(Left, Right))
+	{
+		return false;
+	}
+
+	// デフォルト値
+	if (!IdenticalObjects(Left->GeneratedClass->GetDefaultObject(), Right->GeneratedClass->GetDefaultObject()))
+	{
+		return false;
+	}
+
+	// コンポーネントの階層 (最上位のノードの並び)
+	if (!IdenticalObjects(Left->SimpleConstructionScript, Right->SimpleConstructionScript))
+	{
+		return false;
+	}
+
+	// コンポーネント
+	FSCSNodeMap LeftSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Left->GeneratedClass));
+	FSCSNodeMap RightSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Right->GeneratedClass));
+	const bool bIdenticalComponents = BlueprintMerge::TwoWayJoin(LeftSCSNodeMap, RightSCSNodeMap,
+		[&IdenticalObjects](const FName& Path, USCS_Node* const* LeftNode, USCS_Node* const* RightNode)
+	{
+		// ノード自身のプロパティは、子ノードの並びやアタッチ先のソケットを含む
+		return LeftNode && RightNode && IdenticalObjects(*LeftNode, *RightNode) && IdenticalObjects((*LeftNode)->ComponentTemplate, (*RightNode)->ComponentTemplate);
+	});
+
+	if (!bIdenticalComponents)
+	{
+		return false;
+	}
+
+	// グラフ
+	FGraphHierarchy LeftGraphs;
+	FGraphHierarchy RightGraphs;
+	BuildGraphHierarchy(Left, LeftGraphs);
+	BuildGraphHierarchy(Right, RightGraphs);
+
+	for (EGraphType Type : GetAllGraphTypes())
+	{
+		const bool bIdenticalGraphs = BlueprintMerge::TwoWayJoin(LeftGraphs[Type], RightGraphs[Type],
+			[](const FName& Path, UEdGraph* const* LeftGraph, UEdGraph* const* RightGraph)
+		{
+			return LeftGraph && RightGraph && FBlueprintGraphHash::HashGraph(*LeftGraph) == FBlueprintGraphHash::HashGraph(*RightGraph);
+		});
+
+		if (!bIdenticalGraphs)
+		{
+			return false;
+		}
+	}
+	return true;
+}
+
+void UBlueprintMergeLibrary::BuildMergePlan(const FMergeAnalysis& Analysis, FBlueprintMergePlan& OutPlan, TArray<FMergePlanRecordSource>* OutRecordSources)
+{
+	OutPlan.bIsValid = true;
+	OutPlan.OutputName = Analysis.OutputName;
+	OutPlan.Entries.Reset();
+	OutPlan.NumConflicts = 0;
+	if (OutRecordSources)
+	{
+		OutRecordSources->Reset();
+	}
+
+	// パスの文字列は解析のテーブルから作る
+	FBlueprintMergePathTable::FScope PathScope(&Analysis.Paths.Get());
+
+	auto AddEntry = [&OutPlan, OutRecordSources](EBlueprintMergePlanCategory Category, const FString& Path, const FDiffData& DiffData, bool bIsLeftUpdate, bool bIsRightUpdate, const FMergePlanRecordSource& RecordSource)
+	{
+		const FBlueprintMergePlanEntry* Entry = AddMergePlanEntry(OutPlan, Category, Path, DiffData.GetDiffType(), bIsLeftUpdate, bIsRightUpdate);
+		if (Entry && OutRecordSources)
+		{
+			OutRecordSources->Add(RecordSource);
+		}
+	};
+
+	// プロパティとコンポーネントの削除は、フラグが残っている側を表すので反転する
+	auto AddPresenceDiff = [&AddEntry](EBlueprintMergePlanCategory Category, const FString& Path, const FName& Key, const FDiffData& DiffData, const FPropertyDiffResult* Values)
+	{
+		const bool bIsRemove = DiffData.GetDiffType() == EDiffType::Remove;
+		const bool bIsLeftUpdate = bIsRemove ? !DiffData.IsLeftUpdate() : DiffData.IsLeftUpdate();
+		const bool bIsRightUpdate = bIsRemove ? !DiffData.IsRightUpdate() : DiffData.IsRightUpdate();
+		AddEntry(Category, Path, DiffData, bIsLeftUpdate, bIsRightUpdate, FMergePlanRecordSource{ Values, Key });
+	};
+
+	// 変数とデフォルト値
+	for (const TPair<FName, FDiffData>& Pair : Analysis.Properties.DiffPropertyMap)
+	{
+		AddPresenceDiff(EBlueprintMergePlanCategory::Property, FBlueprintMergePathTable::PathToString(Pair.Key), Pair.Key, Pair.Value, &Analysis.Properties);
+	}
+
+	// コンポーネント
+	for (const TPair<FName, FDiffData>& Pair : Analysis.Components.DiffMap)
+	{
+		AddPresenceDiff(EBlueprintMergePlanCategory::Component, FBlueprintMergePathTable::PathToString(Pair.Key), Pair.Key, Pair.Value, nullptr);
+	}
+
+	for (const TPair<FName, FPropertyDiffResult>& TemplateDiff : Analysis.Components.TemplateDiffs)
+	{
+		const FString ComponentPath = FBlueprintMergePathTable::PathToString(TemplateDiff.Key);
+		for (const TPair<FName, FDiffData>& Pair : TemplateDiff.Value.DiffPropertyMap)
+		{
+			AddPresenceDiff(EBlueprintMergePlanCategory::ComponentProperty, ComponentPath + TEXT(".") + FBlueprintMergePathTable::PathToString(Pair.Key), Pair.Key, Pair.Value, &TemplateDiff.Value);
+		}
+	}
+
+	// グラフ
+	for (const FGraphDiffResult& GraphDiff : Analysis.Graphs)
+	{
+		BlueprintMerge::TKeyCursor<FGraphNodeDiffResult> NodeDiffCursor(GraphDiff.NodeDiffs);
+		BlueprintMerge::TKeyCursor<TArray<FName>> ConflictDetailCursor(GraphDiff.ConflictDetails);
+		for (const TPair<FName, FDiffData>& Pair : GraphDiff.DiffMap)
+		{
+			const FString GraphPath = FBlueprintMergePathTable::PathToString(Pair.Key);
+			const FDiffData& DiffData = Pair.Value;
+
+			const FGraphNodeDiffResult* NodeDiff = NodeDiffCursor.Seek(Pair.Key);
+			const TArray<FName>* ConflictDetail = ConflictDetailCursor.Seek(Pair.Key);
+			if (!NodeDiff)
+			{
+				FMergePlanRecordSource RecordSource;
+				RecordSource.ConflictDetail = ConflictDetail;
+				AddEntry(EBlueprintMergePlanCategory::Graph, GraphPath, DiffData, DiffData.IsLeftUpdate(), DiffData.IsRightUpdate(), RecordSource);
+				continue;
+			}
+
+			// ノード単位でマージするグラフは、ノードごとに列挙する
+			for (const TPair<int32, FDiffData>& NodePair : NodeDiff->NodeDiffs)
+			{
+				const FGraphNodeMatch& Match = NodeDiff->Nodes[NodePair.Key];
+				const FDiffData& NodeDiffData = NodePair.Value;
+				const UEdGraphNode* Node = Match.BaseNode ? Match.BaseNode : (NodeDiffData.IsLeftUpdate() ? Match.LeftNode : Match.RightNode);
+				AddEntry(EBlueprintMergePlanCategory::GraphNode, GraphPath + TEXT(".") + Node->GetName(), NodeDiffData, NodeDiffData.IsLeftUpdate(), NodeDiffData.IsRightUpdate(), FMergePlanRecordSource());
+			}
+		}
+	}
+}
+
+void UBlueprintMergeLibrary::WriteMergeReport(FBlueprintMergeReport& Report, const FMergeAnalysis& Analysis, const FBlueprintMergePlan& Plan, TConstArrayView<FMergePlanRecordSource> RecordSources)
+{
+	check(IsInGameThread());
+	check(RecordSources.Num() == Plan.Entries.Num());
+
+	// コンフリクトの詳細のパスは解析のテーブルから作る
+	FBlueprintMergePathTable::FScope PathScope(&Analysis.Paths.Get());
+
+	for (int32 Index = 0; Index < Plan.Entries.Num(); ++Index)
+	{
+		const FBlueprintMergePlanEntry& Entry = Plan.Entries[Index];
+		const FMergePlanRecordSource& RecordSource = RecordSources[Index];
+		WriteMergeReportRecord(Report, Plan, Entry, RecordSource.Values, RecordSource.Key);
+
+		// コンフリクトの原因になったプロパティ・ノード・リンクはレポートにだけ書き出す
+		if (Entry.Action != EBlueprintMergePlanAction::Conflict || !RecordSource.ConflictDetail)
+		{
+			continue;
+		}
+
+		for (const FName& Detail : *RecordSource.ConflictDetail)
+		{
+			FBlueprintMergeReportRecord Record;
+			Record.Merge = Plan.OutputName;
+			Record.Category = TEXT("GraphProperty");
+			const FString DetailPath = Entry.Path + TEXT(".") + FBlueprintMergePathTable::PathToString(Detail);
+			Record.Path = DetailPath;
+			Record.Action = TEXT("Conflict");
+			Record.bIsLeftUpdate = true;
+			Record.bIsRightUpdate = true;
+			Report.Write(Record);
+		}
+	}
+}
+
+void UBlueprintMergeLibrary::BuildMergePlanWithReport(const FMergeAnalysis& Analysis, FBlueprintMergePlan& OutPlan)
+{
+	check(IsInGameThread());
+
+	FBlueprintMergeReport* Report = FBlueprintMergeReport::GetActive();
+	if (!Report)
+	{
+		BuildMergePlan(Analysis, OutPlan);
+		return;
+	}
+
+	TArray<FMergePlanRecordSource> RecordSources;
+	BuildMergePlan(Analysis, OutPlan, &RecordSources);
+	WriteMergeReport(*Report, Analysis, OutPlan, RecordSources);
+}
+
+const FBlueprintMergePlanEntry* UBlueprintMergeLibrary::AddMergePlanEntry(FBlueprintMergePlan& OutPlan, EBlueprintMergePlanCategory Category, const FString& Path, EDiffType DiffType, bool bIsLeftUpdate, bool bIsRightUpdate)
+{
+	if (!bIsLeftUpdate && !bIsRightUpdate)
+	{
+		return nullptr;
+	}
+
+	FBlueprintMergePlanEntry& Entry = OutPlan.Entries.AddDefaulted_GetRef();
+	Entry.Category = Category;
+	Entry.Path = Path;
+
+	if (DiffType == EDiffType::Merge)
+	{
+		// 両側の変更を合わせたもので、コンフリクトではない
+		Entry.Action = EBlueprintMergePlanAction::Modify;
+		Entry.Side = EBlueprintMergePlanSide::Both;
+		return &Entry;
+	}
+
+	if (bIsLeftUpdate && bIsRightUpdate)
+	{
+		Entry.Action = EBlueprintMergePlanAction::Conflict;
+		Entry.Side = EBlueprintMergePlanSide::Both;
+		++OutPlan.NumConflicts;
+		return &Entry;
+	}
+
+	Entry.Side = bIsLeftUpdate ? EBlueprintMergePlanSide::Left : EBlueprintMergePlanSide::Right;
+	switch (DiffType)
+	{
+	case EDiffType::Add:
+		Entry.Action = EBlueprintMergePlanAction::Add;
+		break;
+	case EDiffType::Remove:
+		Entry.Action = EBlueprintMergePlanAction::Remove;
+		break;
+	default:
+		Entry.Action = EBlueprintMergePlanAction::Modify;
+		break;
+	}
+	return &Entry;
+}
+
+void UBlueprintMergeLibrary::WriteMergeReportRecord(FBlueprintMergeReport& Report, const FBlueprintMergePlan& Plan, const FBlueprintMergePlanEntry& Entry, const FPropertyDiffResult* Values, FName Key)
+{
+	const FString Category = StaticEnum<EBlueprintMergePlanCategory>()->GetNameStringByValue(static_cast<int64>(Entry.Category));
+	const FString Action = StaticEnum<EBlueprintMergePlanAction>()->GetNameStringByValue(static_cast<int64>(Entry.Action));
+
+	FBlueprintMergeReportRecord Record;
+	Record.Merge = Plan.OutputName;
+	Record.Category = Category;
+	Record.Path = Entry.Path;
+	Record.Action = Action;
+	Record.bIsLeftUpdate = Entry.Side != EBlueprintMergePlanSide::Right;
+	Record.bIsRightUpdate = Entry.Side != EBlueprintMergePlanSide::Left;
+
+	// 値の文字列化は重いので、レポートが値を含む場合だけ行う
+	FString LeftValue;
+	FString RightValue;
+	if (Values && Report.IncludesValues())
+	{
+		if (const FPropertyData* LeftPropertyData = BlueprintMerge::FindByKey(Values->LeftPropertyMap, Key))
+		{
+			LeftValue = ExportPropertyValue(*LeftPropertyData);
+			Record.LeftValue = &LeftValue;
+		}
+
+		if (const FPropertyData* RightPropertyData = BlueprintMerge::FindByKey(Values->RightPropertyMap, Key))
+		{
+			RightValue = ExportPropertyValue(*RightPropertyData);
+			Record.RightValue = &RightValue;
+		}
+	}
+
+	Report.Write(Record);
+}
+
+UBlueprintMergeLibrary::FPropertyMap UBlueprintMergeLibrary::BuildPropertyMap(UObject* Target, EBuildPropertyMapOption Option)
+{
+	BLUEPRINT_MERGE_SCOPE(BuildPropertyMap);
+	BLUEPRINT_MERGE_COUNTER_ADD(MapsBuilt, 1);
+
+	FPropertyMap PropertyMap;
+
+	// パスの構成はクラスごとにキャッシュしておき、インスタンスでは値のアドレスを解決するだけにする
+	TSharedRef<const FBlueprintPropertySchema> Schema = FBlueprintPropertySchemaCache::Get().FindOrAdd(Target->GetClass());
+	PropertyMap.Reserve(Schema->GetEntries().Num());
+
+	const bool bIncludeCompositeType = (Option == EBuildPropertyMapOption::IncludeCompositeType);
+	Schema->ForEachValue(Target, bIncludeCompositeType, [&PropertyMap](const FName& PropertyPath, const FProperty* Property, const void* Value, int32 EntryIndex)
+	{
+		PropertyMap.Emplace(PropertyPath, FPropertyData(Property, Value, EntryIndex));
+	});
+
+	BLUEPRINT_MERGE_COUNTER_ADD(PropertiesVisited, PropertyMap.Num());
+
+	BlueprintMerge::SortByKey(PropertyMap);
+	return PropertyMap;
+}
+
+UBlueprintMergeLibrary::FSCSNodeMap UBlueprintMergeLibrary::BuildSCSNodeMap(UBlueprintGeneratedClass* BPGC)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(MapsBuilt, 1);
+
+	FSCSNodeMap SCSNodeMap;
+	TArray<USCS_Node*> SCSNodes = BPGC->SimpleConstructionScript->GetRootNodes();
+	for (USCS_Node* Node : SCSNodes)
+	{
+		if (Node->ComponentClass->IsChildOf(UActorComponent::StaticClass()))
+		{
+			const FName Path = Node->GetVariableName();
+			SCSNodeMap.Emplace(Path, Node);
+			BuildSCSNodeMapRecursive(Node, Path, SCSNodeMap);
+		}
+	}
+
+	BlueprintMerge::SortByKey(SCSNodeMap);
+	return SCSNodeMap;
+}
+
+void UBlueprintMergeLibrary::BuildSCSNodeMapRecursive(USCS_Node* Node, const FName& Path, FSCSNodeMap& InOutMap)
+{
+	for (USCS_Node* ChildNode : Node->GetChildNodes())
+	{
+		// 子のパスは親のパスに続ける
+		const FName ChildPath = FBlueprintMergePathTable::MakePath(Path, ChildNode->GetVariableName());
+		InOutMap.Emplace(ChildPath, ChildNode);
+		BuildSCSNodeMapRecursive(ChildNode, ChildPath, InOutMap);
+	}
+}
+
+UBlueprintMergeLibrary::FGraphMap UBlueprintMergeLibrary::BuildGraphMap(UBlueprint* Blueprint, EGraphType Type)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(MapsBuilt, 1);
+
+	FGraphMap GraphMap;
+	if (const TArray<TObjectPtr<UEdGraph>>* RootGraphs = GetRootGraphs(Blueprint, Type))
+	{
+		for (UEdGraph* Graph : *RootGraphs)
+		{
+			AddGraphTree(Graph, GraphMap);
+		}
+	}
+
+	BlueprintMerge::SortByKey(GraphMap);
+	return GraphMap;
+}
+
+void UBlueprintMergeLibrary::BuildGraphHierarchy(UBlueprint* Blueprint, FGraphHierarchy& OutHierarchy)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(MapsBuilt, 1);
+
+	for (EGraphType Type : GetAllGraphTypes())
+	{
+		FGraphMap& GraphMap = OutHierarchy[Type];
+		GraphMap.Reset();
+		if (const TArray<TObjectPtr<UEdGraph>>* RootGraphs = GetRootGraphs(Blueprint, Type))
+		{
+			for (UEdGraph* Graph : *RootGraphs)
+			{
+				AddGraphTree(Graph, GraphMap);
+			}
+		}
+		BlueprintMerge::SortByKey(GraphMap);
+	}
+}
+
+void UBlueprintMergeLibrary::AddGraphTree(UEdGraph* RootGraph, FGraphMap& InOutMap)
+{
+	if (!RootGraph)
+	{
+		return;
+	}
+
+	// 親のパスを持ったまま SubGraphs をたどる (GetAllChildrenGraphs は子孫を全て返すので使わない)
+	TArray<TPair<UEdGraph*, FName>, TInlineAllocator<16>> Stack;
+	Stack.Emplace(RootGraph, RootGraph->GetFName());
+	while (!Stack.IsEmpty())
+	{
+		const TPair<UEdGraph*, FName> Entry = Stack.Pop(EAllowShrinking::No);
+		InOutMap.Emplace(Entry.Value, Entry.Key);
+
+		for (UEdGraph* SubGraph : Entry.Key->SubGraphs)
+		{
+			if (SubGraph)
+			{
+				Stack.Emplace(SubGraph, FBlueprintMergePathTable::MakePath(Entry.Value, SubGraph->GetFName()));
+			}
+		}
+	}
+}
+
+const TArray<TObjectPtr<UEdGraph>>* UBlueprintMergeLibrary::GetRootGraphs(UBlueprint* Blueprint, EGraphType Type)
+{
+	if (!Blueprint)
+	{
+		return nullptr;
+	}
+
+	switch (Type)
+	{
+	case EGraphType::Function:
+		return &Blueprint->FunctionGraphs;
+	case EGraphType::Event:
+		return &Blueprint->EventGraphs;
+	case EGraphType::Macro:
+		return &Blueprint->MacroGraphs;
+	case EGraphType::Delegate:
+		return &Blueprint->DelegateSignatureGraphs;
+	case EGraphType::Ubergraph:
+		return &Blueprint->UbergraphPages;
+	default:
+		return nullptr;
+	}
+}
+
+UBlueprintMergeLibrary::FGraphNodeMap UBlueprintMergeLibrary::BuildGraphNodesMap(UEdGraph* Graph)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(MapsBuilt, 1);
+
+	FGraphNodeMap GraphNodeMap;
+	GraphNodeMap.Reserve(Graph->Nodes.Num());
+	for (UEdGraphNode* Node : Graph->Nodes)
+	{
+		GraphNodeMap.Emplace(Node->GetFName(), Node);
+	}
+
+	BlueprintMerge::SortByKey(GraphNodeMap);
+	return GraphNodeMap;
+}
+
+UBlueprintMergeLibrary::FGraphPinMap UBlueprintMergeLibrary::BuildGraphPinsMap(UEdGraphNode* Node)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(MapsBuilt, 1);
+
+	FGraphPinMap GraphPinMap;
+	GraphPinMap.Reserve(Node->Pins.Num());
+	for (UEdGraphPin* Pin : Node->Pins)
+	{
+		GraphPinMap.Emplace(Pin->PinName, Pin);
+	}
+
+	BlueprintMerge::SortByKey(GraphPinMap);
+	return GraphPinMap;
+}
+
+FName UBlueprintMergeLibrary::GetObjectPath(UObject* Root, UObject* Object, bool bRequiredRootName)
+{
+	if (!Root || !Object)
+	{
+		return NAME_None;
+	}
+
+	// テーブルがあれば、Root ごとの索引を引く (索引は最初の呼び出しで一度だけ作る)
+	FBlueprintMergePathTable* Table = FBlueprintMergePathTable::GetCurrent();
+	if (Table && !bRequiredRootName)
+	{
+		return Table->FindOrAddObjectPath(Root, Object);
+	}
+
+	// Root までのアウターを集めてから、上から順にパスを登録する
+	TArray<UObject*, TInlineAllocator<8>> Outers;
+	for (UObject* Current = Object; Current != Root; Current = Current->GetOuter())
+	{
+		if (!Current)
+		{
+			return NAME_None;
+		}
+		Outers.Add(Current);
+	}
+
+	FName Path = bRequiredRootName ? Root->GetFName() : NAME_None;
+	for (int32 Index = Outers.Num() - 1; Index >= 0; --Index)
+	{
+		Path = FBlueprintMergePathTable::MakePath(Path, Outers[Index]->GetFName());
+	}
+	return Path;
+}
+
+bool UBlueprintMergeLibrary::MergeBlueprintMemberVariables(UBlueprint* Base, const FPropertyMap& BasePropertyMap, UBlueprint* Left, const FPropertyMap& LeftPropertyMap, UBlueprint* Right, const FPropertyMap& RightPropertyMap, const FDiffMap& DiffPropertyMap, const FPropertyMap& MergedPropertyMap, UBlueprint* InOutMergedBlueprint)
+{
+	if (!Base || !Left || !Right || !InOutMergedBlueprint)
+	{
+		return false;
+	}
+
+	bool bChanged = false;
+	BlueprintMerge::TKeyCursor<FPropertyData> LeftCursor(LeftPropertyMap);
+	BlueprintMerge::TKeyCursor<FPropertyData> RightCursor(RightPropertyMap);
+	BlueprintMerge::TKeyCursor<FPropertyData> MergedCursor(MergedPropertyMap);
+
+	for (const TPair<FName, FDiffData>& Pair : DiffPropertyMap)
+	{
+		FName PropertyPath = Pair.Key;
+		const FDiffData& DiffPropertyData = Pair.Value;
+
+		const FPropertyData* LeftPropertyData = LeftCursor.Seek(PropertyPath);
+		const FPropertyData* RightPropertyData = RightCursor.Seek(PropertyPath);
+		const FPropertyData* MergedPropertyData = MergedCursor.Seek(PropertyPath);
+
+		if (DiffPropertyData.IsNoDifference())
+		{
+			// 差分がない場合はスキップ
+			continue;
+		}
+
+		if (DiffPropertyData.GetDiffType() != EDiffType::Remove &&
+			(DiffPropertyData.IsLeftUpdate() && DiffPropertyData.IsRightUpdate()))
+		{
+			// コンフリクト
+			continue;
+		}
+
+		UBlueprint* UpdatedBlueprint = DiffPropertyData.IsLeftUpdate() ? Left : Right;
+		const FPropertyData* UpdatedPropertyData = DiffPropertyData.IsLeftUpdate() ? LeftPropertyData : RightPropertyData;
+
+		if (!MergedPropertyData)
+		{
+			if (DiffPropertyData.GetDiffType() == EDiffType::Add)
+			{
+				int32 VariableIndex = FBlueprintEditorUtils::FindNewVariableIndex(UpdatedBlueprint, PropertyPath);
+				// プロパティが見つからない場合は何もしない
+				if (VariableIndex < 0)
+				{
+					continue;
+				}
+
+				FBPVariableDescription& VariableDesc = UpdatedBlueprint->NewVariables[VariableIndex];
+				FBlueprintEditorUtils::AddMemberVariable(InOutMergedBlueprint, PropertyPath, VariableDesc.VarType, TEXT(""));
+				bChanged = true;
+			}
+		}
+		else if (DiffPropertyData.GetDiffType() == EDiffType::Remove)
+		{
+			FBlueprintEditorUtils::RemoveMemberVariable(InOutMergedBlueprint, PropertyPath);
+			bChanged = true;
+		}
+	}
+	return bChanged;
+}
+
+void UBlueprintMergeLibrary::MergeObjectProperties(UObject* Base, UObject* Left, UObject* Right, UObject* InOutMergedObject)
+{
+	FPropertyDiffResult DiffResult;
+	DiffObjectProperties(Base, Left, Right, true, DiffResult);
+	ApplyObjectPropertyDiff(DiffResult, InOutMergedObject);
+}
+
+void UBlueprintMergeLibrary::DiffObjectProperties(UObject* Base, UObject* Left, UObject* Right, bool bResolveSameChanges, FPropertyDiffResult& OutResult)
+{
+	if (CVarLazyPropertyDiff.GetValueOnAnyThread())
+	{
+		DiffObjectPropertiesLazy(Base, Left, Right, bResolveSameChanges, OutResult);
+		return;
+	}
+
+	OutResult.BasePropertyMap = BuildPropertyMap(Base);
+	OutResult.LeftPropertyMap = BuildPropertyMap(Left);
+	OutResult.RightPropertyMap = BuildPropertyMap(Right);
+
+	FDiffMap& DiffPropertyMap = OutResult.DiffPropertyMap;
+
+	// 数値などの POD プロパティは、連続する範囲をまとめてバイト比較しておく
+	// 一致が確定したプロパティは Identical の呼び出しを省略する
+	FBlueprintPropertySchemaCache& SchemaCache = FBlueprintPropertySchemaCache::Get();
+	TSharedRef<const FBlueprintPropertySchema> BaseSchema = SchemaCache.FindOrAdd(Base->GetClass());
+	TBitArray<> LeftIdenticalEntries;
+	TBitArray<> RightIdenticalEntries;
+	BaseSchema->FindIdenticalPodEntries(Base, *SchemaCache.FindOrAdd(Left->GetClass()), Left, LeftIdenticalEntries);
+	BaseSchema->FindIdenticalPodEntries(Base, *SchemaCache.FindOrAdd(Right->GetClass()), Right, RightIdenticalEntries);
+
+	// ソート済みのマップを同時に走査して、キーごとに差分を調べる
+	// 走査順はキー順なので、差分マップもソート済みになる
+	BlueprintMerge::ThreeWayJoin(OutResult.BasePropertyMap, OutResult.LeftPropertyMap, OutResult.RightPropertyMap,
+		[bResolveSameChanges, &DiffPropertyMap, &LeftIdenticalEntries, &RightIdenticalEntries](const FName& PropertyPath, const FPropertyData* BasePropertyData, const FPropertyData* LeftPropertyData, const FPropertyData* RightPropertyData)
+	{
+		ClassifyPropertyDiff(PropertyPath, BasePropertyData, LeftPropertyData, RightPropertyData, bResolveSameChanges, LeftIdenticalEntries, RightIdenticalEntries, DiffPropertyMap);
+	});
+}
+
+void UBlueprintMergeLibrary::ClassifyPropertyDiff(const FName& PropertyPath, const FPropertyData* BasePropertyData, const FPropertyData* LeftPropertyData, const FPropertyData* RightPropertyData,
+	bool bResolveSameChanges, const TBitArray<>& LeftIdenticalEntries, const TBitArray<>& RightIdenticalEntries, FDiffMap& OutDiffPropertyMap)
+{
+	auto IsIdenticalToBase = [BasePropertyData](const FPropertyData& OtherPropertyData, const TBitArray<>& IdenticalEntries)
+	{
+		if (BasePropertyData->SchemaIndex != INDEX_NONE && IdenticalEntries[BasePropertyData->SchemaIndex])
+		{
+			return true;
+		}
+		BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
+		return BasePropertyData->Property->Identical(BasePropertyData->Container, OtherPropertyData.Container);
+	};
+
+	// 削除は、もう片側の変更より優先する
+	BlueprintMerge::Core::FClassifyOptions Options;
+	Options.bRemoveConflictsWithModify = false;
+
+	const BlueprintMerge::Core::FDecision Decision = BlueprintMerge::Core::ClassifyThreeWay(!!BasePropertyData, !!LeftPropertyData, !!RightPropertyData,
+		[&]() { return !IsIdenticalToBase(*LeftPropertyData, LeftIdenticalEntries); },
+		[&]() { return !IsIdenticalToBase(*RightPropertyData, RightIdenticalEntries); },
+		[&]()
+		{
+			if (!bResolveSameChanges)
+			{
+				return false;
+			}
+			BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
+			return LeftPropertyData->Property->Identical(LeftPropertyData->Container, RightPropertyData->Container);
+		},
+		Options);
+
+	const FDiffData DiffData = MakeDiffData(PropertyPath, Decision, !!LeftPropertyData, !!RightPropertyData, true);
+	if (DiffData.IsNoDifference())
+	{
+		// 差分がない場合はスキップ
+		return;
+	}
+
+	OutDiffPropertyMap.Emplace(PropertyPath, DiffData);
+}
+
+void UBlueprintMergeLibrary::DiffObjectPropertiesLazy(UObject* Base, UObject* Left, UObject* Right, bool bResolveSameChanges, FPropertyDiffResult& OutResult)
+{
+	FBlueprintPropertySchemaCache& SchemaCache = FBlueprintPropertySchemaCache::Get();
+	TSharedRef<const FBlueprintPropertySchema> BaseSchema = SchemaCache.FindOrAdd(Base->GetClass());
+	TSharedRef<const FBlueprintPropertySchema> LeftSchema = SchemaCache.FindOrAdd(Left->GetClass());
+	TSharedRef<const FBlueprintPropertySchema> RightSchema = SchemaCache.FindOrAdd(Right->GetClass());
+
+	// 最上位の POD プロパティは、まとめたバイト比較で一致を確かめる
+	TBitArray<> LeftIdenticalEntries;
+	TBitArray<> RightIdenticalEntries;
+	BaseSchema->FindIdenticalPodEntries(Base, *LeftSchema, Left, LeftIdenticalEntries);
+	BaseSchema->FindIdenticalPodEntries(Base, *RightSchema, Right, RightIdenticalEntries);
+
+	FLazyPropertyDiffContext Context{ OutResult, bResolveSameChanges, Base->GetOutermostObject(), Left->GetOutermostObject(), Right->GetOutermostObject(), LeftIdenticalEntries, RightIdenticalEntries };
+
+	// 最上位のエントリをパスで対応付ける
+	auto CollectTopLevelEntries = [](const FBlueprintPropertySchema& Schema)
+	{
+		TSortedKeyArray<int32> TopLevelEntries;
+		const TArray<FBlueprintPropertySchemaEntry>& Entries = Schema.GetEntries();
+		for (int32 Index = 0; Index < Entries.Num(); Index = Entries[Index].SubtreeEnd)
+		{
+			TopLevelEntries.Emplace(Schema.MakeEntryPath(Index), Index);
+		}
+		BlueprintMerge::SortByKey(TopLevelEntries);
+		return TopLevelEntries;
+	};
+
+	auto MakeValue = [](const FBlueprintPropertySchema& Schema, const int32* EntryIndex, const UObject* Object)
+	{
+		FLazyPropertyValue Value;
+		if (EntryIndex)
+		{
+			const FBlueprintPropertySchemaEntry& Entry = Schema.GetEntries()[*EntryIndex];
+			Value.Schema = &Schema;
+			Value.EntryIndex = *EntryIndex;
+			Value.Value = Entry.Property->ContainerPtrToValuePtr<void>(Object, Entry.ArrayIndex);
+		}
+		return Value;
+	};
+
+	BlueprintMerge::ThreeWayJoin(CollectTopLevelEntries(*BaseSchema), CollectTopLevelEntries(*LeftSchema), CollectTopLevelEntries(*RightSchema),
+		[&](const FName& Path, const int32* BaseIndex, const int32* LeftIndex, const int32* RightIndex)
+	{
+		const FLazyPropertyValue BaseValue = MakeValue(*BaseSchema, BaseIndex, Base);
+		const FLazyPropertyValue LeftValue = MakeValue(*LeftSchema, LeftIndex, Left);
+		const FLazyPropertyValue RightValue = MakeValue(*RightSchema, RightIndex, Right);
+		if (BaseIndex && LeftIndex && RightIndex)
+		{
+			DiffEntryLazy(Context, nullptr, BaseValue, LeftValue, RightValue);
+		}
+		else
+		{
+			DiffExpandedEntries(Context, nullptr, BaseIndex ? &BaseValue : nullptr, LeftIndex ? &LeftValue : nullptr, RightIndex ? &RightValue : nullptr);
+		}
+	});
+
+	// 部分木ごとに追加したので、最後にキー順に並べる
+	BlueprintMerge::SortByKey(OutResult.BasePropertyMap);
+	BlueprintMerge::SortByKey(OutResult.LeftPropertyMap);
+	BlueprintMerge::SortByKey(OutResult.RightPropertyMap);
+	BlueprintMerge::SortByKey(OutResult.DiffPropertyMap);
+	BlueprintMerge::SortByKey(OutResult.ContainerMerges);
+}
+
+void UBlueprintMergeLibrary::DiffEntryLazy(FLazyPropertyDiffContext& Context, const FName* Prefix, const FLazyPropertyValue& Base, const FLazyPropertyValue& Left, const FLazyPropertyValue& Right)
+{
+	const TArray<FBlueprintPropertySchemaEntry>& BaseEntries = Base.Schema->GetEntries();
+	const TArray<FBlueprintPropertySchemaEntry>& LeftEntries = Left.Schema->GetEntries();
+	const TArray<FBlueprintPropertySchemaEntry>& RightEntries = Right.Schema->GetEntries();
+	const FBlueprintPropertySchemaEntry& BaseEntry = BaseEntries[Base.EntryIndex];
+	const FProperty* Property = BaseEntry.Property;
+
+	if (!Property->SameType(LeftEntries[Left.EntryIndex].Property) || !Property->SameType(RightEntries[Right.EntryIndex].Property))
+	{
+		// 型が変わった場合は、展開して比べる
+		DiffExpandedEntries(Context, Prefix, &Base, &Left, &Right);
+		return;
+	}
+
+	// POD の一致は Base のオブジェクトのスキーマのインデックスで記録している
+	auto IsIdenticalToBase = [Prefix, &Base, Property](const FLazyPropertyValue& Other, const TBitArray<>& IdenticalEntries)
+	{
+		if (!Prefix && IdenticalEntries[Base.EntryIndex])
+		{
+			return true;
+		}
+		BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
+		return Property->Identical(Base.Value, Other.Value);
+	};
+
+	// 3 つとも同じ値なら、子孫も全て同じなので降りない
+	if (IsIdenticalToBase(Left, Context.LeftIdenticalEntries) && IsIdenticalToBase(Right, Context.RightIdenticalEntries))
+	{
+		return;
+	}
+
+	if (BaseEntry.SubtreeEnd > Base.EntryIndex + 1)
+	{
+		// 構造体のメンバーは、同じ構造体なので 3 つとも同じ順に並ぶ
+		auto MakeChild = [](const FLazyPropertyValue& Parent, int32 Index)
+		{
+			const FBlueprintPropertySchemaEntry& Entry = Parent.Schema->GetEntries()[Index];
+			return FLazyPropertyValue{ Parent.Schema, Index, Entry.Property->ContainerPtrToValuePtr<void>(Parent.Value, Entry.ArrayIndex) };
+		};
+
+		int32 LeftIndex = Left.EntryIndex + 1;
+		int32 RightIndex = Right.EntryIndex + 1;
+		for (int32 BaseIndex = Base.EntryIndex + 1; BaseIndex < BaseEntry.SubtreeEnd; BaseIndex = BaseEntries[BaseIndex].SubtreeEnd)
+		{
+			DiffEntryLazy(Context, Prefix, MakeChild(Base, BaseIndex), MakeChild(Left, LeftIndex), MakeChild(Right, RightIndex));
+			LeftIndex = LeftEntries[LeftIndex].SubtreeEnd;
+			RightIndex = RightEntries[RightIndex].SubtreeEnd;
+		}
+		return;
+	}
+
+	if (BaseEntry.bDynamicContainer)
+	{
+		const FName Path = Base.Schema->MakeEntryPath(Base.EntryIndex, Prefix);
+		DiffContainerLazy(Context, Path, Property, Base.Value, Left.Value, Right.Value);
+		return;
+	}
+
+	DiffExpandedEntries(Context, Prefix, &Base, &Left, &Right);
+}
+
+void UBlueprintMergeLibrary::DiffElementLazy(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
+	if (Property->Identical(Base, Left))
+	{
+		BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
+		if (Property->Identical(Base, Right))
+		{
+			return;
+		}
+	}
+
+	if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+	{
+		// 構造体の中は、要素のパスをプレフィックスとしてスキーマを使う
+		TSharedRef<const FBlueprintPropertySchema> Schema = FBlueprintPropertySchemaCache::Get().FindOrAdd(StructProperty->Struct);
+		const TArray<FBlueprintPropertySchemaEntry>& Entries = Schema->GetEntries();
+		for (int32 Index = 0; Index < Entries.Num(); Index = Entries[Index].SubtreeEnd)
+		{
+			const FBlueprintPropertySchemaEntry& Entry = Entries[Index];
+			auto MakeValue = [&Schema, &Entry, Index](const void* Container)
+			{
+				return FLazyPropertyValue{ &Schema.Get(), Index, Entry.Property->ContainerPtrToValuePtr<void>(Container, Entry.ArrayIndex) };
+			};
+			DiffEntryLazy(Context, &Path, MakeValue(Base), MakeValue(Left), MakeValue(Right));
+		}
+		return;
+	}
+
+	if (Property->IsA<FArrayProperty>() || Property->IsA<FSetProperty>() || Property->IsA<FMapProperty>())
+	{
+		DiffContainerLazy(Context, Path, Property, Base, Left, Right);
+		return;
+	}
+
+	DiffExpandedElements(Context, Path, Property, Base, Left, Right);
+}
+
+void UBlueprintMergeLibrary::DiffContainerLazy(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right)
+{
+	// 要素は並び順 (Set / Map は有効な要素の順) のインデックスで対応付ける
+	auto DiffElement = [&Context](const FName& ElementPath, const FProperty* ElementProperty, const void* BaseElement, const void* LeftElement, const void* RightElement)
+	{
+		if (BaseElement && LeftElement && RightElement)
+		{
+			DiffElementLazy(Context, ElementPath, ElementProperty, BaseElement, LeftElement, RightElement);
+		}
+		else
+		{
+			DiffExpandedElements(Context, ElementPath, ElementProperty, BaseElement, LeftElement, RightElement);
+		}
+	};
+
+	if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+	{
+		if (CVarArraySequenceDiff.GetValueOnAnyThread() && DiffArraySequence(Context, Path, ArrayProperty, Base, Left, Right))
+		{
+			return;
+		}
+
+		FScriptArrayHelper BaseHelper(ArrayProperty, Base);
+		FScriptArrayHelper LeftHelper(ArrayProperty, Left);
+		FScriptArrayHelper RightHelper(ArrayProperty, Right);
+		const int32 Num = FMath::Max3(BaseHelper.Num(), LeftHelper.Num(), RightHelper.Num());
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			DiffElement(FBlueprintMergePathTable::MakePath(Path, NAME_None, Index), ArrayProperty->Inner,
+				BaseHelper.IsValidIndex(Index) ? BaseHelper.GetRawPtr(Index) : nullptr,
+				LeftHelper.IsValidIndex(Index) ? LeftHelper.GetRawPtr(Index) : nullptr,
+				RightHelper.IsValidIndex(Index) ? RightHelper.GetRawPtr(Index) : nullptr);
+		}
+	}
+	else if (CVarKeyedContainerDiff.GetValueOnAnyThread() && (Property->IsA<FSetProperty>() || Property->IsA<FMapProperty>()))
+	{
+		DiffKeyedContainer(Context, Path, Property, Base, Left, Right);
+	}
+	else if (const FSetProperty* SetProperty = CastField<FSetProperty>(Property))
+	{
+		FScriptSetHelper BaseHelper(SetProperty, Base);
+		FScriptSetHelper LeftHelper(SetProperty, Left);
+		FScriptSetHelper RightHelper(SetProperty, Right);
+		TArray<int32, FMergeArenaAllocator> BaseIndices;
+		TArray<int32, FMergeArenaAllocator> LeftIndices;
+		TArray<int32, FMergeArenaAllocator> RightIndices;
+		CollectValidIndices(BaseHelper, BaseIndices);
+		CollectValidIndices(LeftHelper, LeftIndices);
+		CollectValidIndices(RightHelper, RightIndices);
+
+		const int32 Num = FMath::Max3(BaseIndices.Num(), LeftIndices.Num(), RightIndices.Num());
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			DiffElement(FBlueprintMergePathTable::MakePath(Path, NAME_None, Index), SetProperty->ElementProp,
+				BaseIndices.IsValidIndex(Index) ? BaseHelper.GetElementPtr(BaseIndices[Index]) : nullptr,
+				LeftIndices.IsValidIndex(Index) ? LeftHelper.GetElementPtr(LeftIndices[Index]) : nullptr,
+				RightIndices.IsValidIndex(Index) ? RightHelper.GetElementPtr(RightIndices[Index]) : nullptr);
+		}
+	}
+	else if (const FMapProperty* MapProperty = CastField<FMapProperty>(Property))
+	{
+		static const FName KeyName(TEXT("Key"));
+		static const FName ValueName(TEXT("Value"));
+
+		FScriptMapHelper BaseHelper(MapProperty, Base);
+		FScriptMapHelper LeftHelper(MapProperty, Left);
+		FScriptMapHelper RightHelper(MapProperty, Right);
+		TArray<int32, FMergeArenaAllocator> BaseIndices;
+		TArray<int32, FMergeArenaAllocator> LeftIndices;
+		TArray<int32, FMergeArenaAllocator> RightIndices;
+		CollectValidIndices(BaseHelper, BaseIndices);
+		CollectValidIndices(LeftHelper, LeftIndices);
+		CollectValidIndices(RightHelper, RightIndices);
+
+		const int32 Num = FMath::Max3(BaseIndices.Num(), LeftIndices.Num(), RightIndices.Num());
+		for (int32 Index = 0; Index < Num; ++Index)
+		{
+			const FName EntryPath = FBlueprintMergePathTable::MakePath(Path, NAME_None, Index);
+			DiffElement(FBlueprintMergePathTable::MakePath(EntryPath, KeyName), MapProperty->KeyProp,
+				BaseIndices.IsValidIndex(Index) ? BaseHelper.GetKeyPtr(BaseIndices[Index]) : nullptr,
+				LeftIndices.IsValidIndex(Index) ? LeftHelper.GetKeyPtr(LeftIndices[Index]) : nullptr,
+				RightIndices.IsValidIndex(Index) ? RightHelper.GetKeyPtr(RightIndices[Index]) : nullptr);
+			DiffElement(FBlueprintMergePathTable::MakePath(EntryPath, ValueName), MapProperty->ValueProp,
+				BaseIndices.IsValidIndex(Index) ? BaseHelper.GetValuePtr(BaseIndices[Index]) : nullptr,
+				LeftIndices.IsValidIndex(Index) ? LeftHelper.GetValuePtr(LeftIndices[Index]) : nullptr,
+				RightIndices.IsValidIndex(Index) ? RightHelper.GetValuePtr(RightIndices[Index]) : nullptr);
+		}
+	}
+}
+
+bool UBlueprintMergeLibrary::DiffArraySequence(FLazyPropertyDiffContext& Context, const FName& Path, const FArrayProperty* ArrayProperty, const void* Base, const void* Left, const void* Right)
+{
+	using namespace BlueprintMerge::Core;
+
+	const FProperty* Inner = ArrayProperty->Inner;
+	FScriptArrayHelper BaseHelper(ArrayProperty, Base);
+	FScriptArrayHelper LeftHelper(ArrayProperty, Left);
+	FScriptArrayHelper RightHelper(ArrayProperty, Right);
+
+	auto HashElements = [Inner](FScriptArrayHelper& Helper, UObject* Root, TArray<uint32, FMergeArenaAllocator>& OutHashes)
+	{
+		OutHashes.SetNumUninitialized(Helper.Num());
+		for (int32 Index = 0; Index < Helper.Num(); ++Index)
+		{
+			if (!HashContainerElement(Inner, Helper.GetRawPtr(Index), Root, OutHashes[Index]))
+			{
+				return false;
+			}
+		}
+		return true;
+	};
+
+	TArray<uint32, FMergeArenaAllocator> BaseHashes;
+	TArray<uint32, FMergeArenaAllocator> LeftHashes;
+	TArray<uint32, FMergeArenaAllocator> RightHashes;
+	if (!HashElements(BaseHelper, Context.BaseRoot, BaseHashes) || !HashElements(LeftHelper, Context.LeftRoot, LeftHashes) || !HashElements(RightHelper, Context.RightRoot, RightHashes))
+	{
+		// ハッシュを持たない要素は全て同じハッシュになって対応付けが二乗の時間になるので、移動を調べずに要素ごとに比べる
+		return false;
+	}
+
+	auto IsSameElement = [Inner](UObject* Root, FScriptArrayHelper& Helper, int32 Index, UObject* OtherRoot, FScriptArrayHelper& OtherHelper, int32 OtherIndex)
+	{
+		return IdenticalProperties(Root, FPropertyData(Inner, Helper.GetRawPtr(Index)), OtherRoot, FPropertyData(Inner, OtherHelper.GetRawPtr(OtherIndex)));
+	};
+
+	FSequenceDiff LeftDiff;
+	FSequenceDiff RightDiff;
+	const bool bLeftDiffed = DiffSequences(BaseHashes.GetData(), BaseHashes.Num(), LeftHashes.GetData(), LeftHashes.Num(),
+		[&](int32 BaseIndex, int32 LeftIndex) { return IsSameElement(Context.BaseRoot, BaseHelper, BaseIndex, Context.LeftRoot, LeftHelper, LeftIndex); },
+		LeftDiff);
+	const bool bRightDiffed = bLeftDiffed && DiffSequences(BaseHashes.GetData(), BaseHashes.Num(), RightHashes.GetData(), RightHashes.Num(),
+		[&](int32 BaseIndex, int32 RightIndex) { return IsSameElement(Context.BaseRoot, BaseHelper, BaseIndex, Context.RightRoot, RightHelper, RightIndex); },
+		RightDiff);
+	if (!bRightDiffed)
+	{
+		// 編集が多すぎる場合は要素ごとに比べる
+		return false;
+	}
+
+	FSequenceMergeResult Merge;
+	MergeSequences(BaseHashes.Num(), LeftHashes.Num(), RightHashes.Num(), LeftDiff, RightDiff,
+		[&](int32 LeftIndex, int32 RightIndex)
+		{
+			return LeftHashes[LeftIndex] == RightHashes[RightIndex] && IsSameElement(Context.LeftRoot, LeftHelper, LeftIndex, Context.RightRoot, RightHelper, RightIndex);
+		},
+		Merge);
+
+	if (Merge.bConflict && BaseHelper.Num() == LeftHelper.Num() && BaseHelper.Num() == RightHelper.Num())
+	{
+		// 要素数が変わらない場合は、要素ごとに比べれば要素の中の別々の変更をマージできる
+		return false;
+	}
+
+	AddContainerDiff(Context, Path, ArrayProperty, Base, Left, Right, Merge.bLeftChanged, Merge.bRightChanged, Merge.bConflict, MakeArrayView(Merge.Items.data(), static_cast<int32>(Merge.Items.size())));
+	return true;
+}
+
+void UBlueprintMergeLibrary::DiffKeyedContainer(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right)
+{
+	using namespace BlueprintMerge::Core;
+
+	const FMapProperty* MapProperty = CastField<FMapProperty>(Property);
+	const FSetProperty* SetProperty = CastField<FSetProperty>(Property);
+	check(MapProperty || SetProperty);
+	const FProperty* KeyProperty = MapProperty ? MapProperty->KeyProp : SetProperty->ElementProp;
+	const FProperty* ValueProperty = MapProperty ? MapProperty->ValueProp : nullptr;
+
+	// Map と Set の要素を同じ形で並べる (Set は値を持たない)
+	struct FKeyedElements
+	{
+		UObject* Root = nullptr;
+		TArray<int32, FMergeArenaAllocator> Indices;
+		TArray<const void*, FMergeArenaAllocator> Keys;
+		TArray<const void*, FMergeArenaAllocator> Values;
+		TArray<uint32, FMergeArenaAllocator> Hashes;
+		TMultiMap<uint32, int32, FMergeArenaSetAllocator> ElementsByHash;
+	};
+
+	auto CollectElements = [MapProperty, SetProperty, KeyProperty](const void* Container, UObject* Root, FKeyedElements& Out)
+	{
+		Out.Root = Root;
+		if (MapProperty)
+		{
+			FScriptMapHelper Helper(MapProperty, Container);
+			CollectValidIndices(Helper, Out.Indices);
+			for (int32 Index : Out.Indices)
+			{
+				Out.Keys.Add(Helper.GetKeyPtr(Index));
+				Out.Values.Add(Helper.GetValuePtr(Index));
+			}
+		}
+		else
+		{
+			FScriptSetHelper Helper(SetProperty, Container);
+			CollectValidIndices(Helper, Out.Indices);
+			for (int32 Index : Out.Indices)
+			{
+				Out.Keys.Add(Helper.GetElementPtr(Index));
+			}
+		}
+
+		Out.Hashes.Reserve(Out.Keys.Num());
+		Out.ElementsByHash.Reserve(Out.Keys.Num());
+		for (int32 Index = 0; Index < Out.Keys.Num(); ++Index)
+		{
+			// Map と Set のキーは常にハッシュを持つが、持たない場合は同じハッシュにして内容の比較に任せる
+			uint32 Hash = 0;
+			HashContainerElement(KeyProperty, Out.Keys[Index], Root, Hash);
+			Out.Hashes.Add(Hash);
+			Out.ElementsByHash.Add(Out.Hashes[Index], Index);
+		}
+	};
+
+	FKeyedElements BaseElements;
+	FKeyedElements LeftElements;
+	FKeyedElements RightElements;
+	CollectElements(Base, Context.BaseRoot, BaseElements);
+	CollectElements(Left, Context.LeftRoot, LeftElements);
+	CollectElements(Right, Context.RightRoot, RightElements);
+
+	// 同じキーの要素を探す (対応付けた要素には印を付ける)
+	auto FindElement = [KeyProperty](const FKeyedElements& From, int32 FromIndex, const FKeyedElements& To, TBitArray<>& InOutMatched)
+	{
+		for (auto It = To.ElementsByHash.CreateConstKeyIterator(From.Hashes[FromIndex]); It; ++It)
+		{
+			const int32 ToIndex = It.Value();
+			if (!InOutMatched[ToIndex] && IdenticalProperties(From.Root, FPropertyData(KeyProperty, From.Keys[FromIndex]), To.Root, FPropertyData(KeyProperty, To.Keys[ToIndex])))
+			{
+				InOutMatched[ToIndex] = true;
+				return ToIndex;
+			}
+		}
+		return static_cast<int32>(INDEX_NONE);
+	};
+
+	struct FKeyedMatch
+	{
+		int32 Base = INDEX_NONE;
+		int32 Left = INDEX_NONE;
+		int32 Right = INDEX_NONE;
+	};
+
+	TArray<FKeyedMatch, FMergeArenaAllocator> Matches;
+	Matches.Reserve(BaseElements.Keys.Num() + LeftElements.Keys.Num() + RightElements.Keys.Num());
+	TBitArray<> LeftMatched(false, LeftElements.Keys.Num());
+	TBitArray<> RightMatched(false, RightElements.Keys.Num());
+	for (int32 Index = 0; Index < BaseElements.Keys.Num(); ++Index)
+	{
+		Matches.Add({ Index, FindElement(BaseElements, Index, LeftElements, LeftMatched), FindElement(BaseElements, Index, RightElements, RightMatched) });
+	}
+	for (int32 Index = 0; Index < LeftElements.Keys.Num(); ++Index)
+	{
+		if (!LeftMatched[Index])
+		{
+			Matches.Add({ INDEX_NONE, Index, FindElement(LeftElements, Index, RightElements, RightMatched) });
+		}
+	}
+	for (int32 Index = 0; Index < RightElements.Keys.Num(); ++Index)
+	{
+		if (!RightMatched[Index])
+		{
+			Matches.Add({ INDEX_NONE, INDEX_NONE, Index });
+		}
+	}
+
+	// Set は要素の有無だけ、Map は値も比べる
+	auto IsSameValue = [ValueProperty](const FKeyedElements& A, int32 AIndex, const FKeyedElements& B, int32 BIndex)
+	{
+		return !ValueProperty || IdenticalProperties(A.Root, FPropertyData(ValueProperty, A.Values[AIndex]), B.Root, FPropertyData(ValueProperty, B.Values[BIndex]));
+	};
+
+	// コンフリクトしたキーは "Container[Key]" のパスで報告する
+	// 値は Map なら値、Set なら要素を参照できるようにする
+	const FProperty* KeyValueProperty = ValueProperty ? ValueProperty : KeyProperty;
+	auto AddKeyConflict = [&](const FKeyedMatch& Match)
+	{
+		const FKeyedElements& KeyElements = Match.Base != INDEX_NONE ? BaseElements : (Match.Left != INDEX_NONE ? LeftElements : RightElements);
+		const int32 KeyIndex = Match.Base != INDEX_NONE ? Match.Base : (Match.Left != INDEX_NONE ? Match.Left : Match.Right);
+		FString KeyText;
+		KeyProperty->ExportTextItem_Direct(KeyText, KeyElements.Keys[KeyIndex], nullptr, nullptr, PPF_None);
+		const FName KeyPath = FBlueprintMergePathTable::MakeKeyPath(Path, KeyText);
+
+		auto EmplaceValue = [ValueProperty, KeyValueProperty, &KeyPath](const FKeyedElements& Elements, int32 Index, FPropertyMap& OutMap)
+		{
+			if (Index != INDEX_NONE)
+			{
+				OutMap.Emplace(KeyPath, FPropertyData(KeyValueProperty, ValueProperty ? Elements.Values[Index] : Elements.Keys[Index]));
+			}
+		};
+		EmplaceValue(BaseElements, Match.Base, Context.Result.BasePropertyMap);
+		EmplaceValue(LeftElements, Match.Left, Context.Result.LeftPropertyMap);
+		EmplaceValue(RightElements, Match.Right, Context.Result.RightPropertyMap);
+		Context.Result.DiffPropertyMap.Emplace(KeyPath, FDiffData(KeyPath, EDiffType::Modify, true, true));
+	};
+
+	// 片側の削除ともう片側の値の変更は、そのキーだけのコンフリクトにする
+	FClassifyOptions Options;
+	Options.bRemoveConflictsWithModify = true;
+
+	bool bLeftChanged = false;
+	bool bRightChanged = false;
+	bool bKeyConflict = false;
+	TArray<FSequenceItem, FMergeArenaAllocator> Items;
+	Items.Reserve(Matches.Num());
+	for (const FKeyedMatch& Match : Matches)
+	{
+		const FDecision Decision = ClassifyThreeWay(Match.Base != INDEX_NONE, Match.Left != INDEX_NONE, Match.Right != INDEX_NONE,
+			[&]() { return !IsSameValue(BaseElements, Match.Base, LeftElements, Match.Left); },
+			[&]() { return !IsSameValue(BaseElements, Match.Base, RightElements, Match.Right); },
+			[&]() { return IsSameValue(LeftElements, Match.Left, RightElements, Match.Right); },
+			Options);
+
+		if (Decision.IsConflict())
+		{
+			// コンフリクトしたキーは Base の要素を残し、他のキーの変更はマージする
+			bKeyConflict = true;
+			AddKeyConflict(Match);
+			if (Match.Base != INDEX_NONE)
+			{
+				Items.Add(FSequenceItem{ ESequenceSide::Base, BaseElements.Indices[Match.Base] });
+			}
+			continue;
+		}
+
+		bLeftChanged |= Decision.bLeftChanged;
+		bRightChanged |= Decision.bRightChanged;
+
+		if (Decision.Change == EChange::None)
+		{
+			Items.Add(FSequenceItem{ ESequenceSide::Base, BaseElements.Indices[Match.Base] });
+		}
+		else if (Decision.Change != EChange::Remove)
+		{
+			Items.Add(Decision.bLeftChanged ?
+				FSequenceItem{ ESequenceSide::Left, LeftElements.Indices[Match.Left] } :
+				FSequenceItem{ ESequenceSide::Right, RightElements.Indices[Match.Right] });
 		}
-		else if (DiffPropertyData.GetDiffType() == EDiffType::Remove)
-		{
-			FBlueprintEditorUtils::RemoveMemberVariable(InOutMergedBlueprint, PropertyPath);
-		}
 	}
+
+	if (bKeyConflict && (bLeftChanged || bRightChanged))
+	{
+		// 片側だけの変更でも、コンテナを丸ごと写すとコンフリクトしたキーまで上書きするので、要素の並びで反映する
+		Context.Result.BasePropertyMap.Emplace(Path, FPropertyData(Property, Base));
+		Context.Result.LeftPropertyMap.Emplace(Path, FPropertyData(Property, Left));
+		Context.Result.RightPropertyMap.Emplace(Path, FPropertyData(Property, Right));
+		Context.Result.ContainerMerges.Emplace(Path, TArray<FSequenceItem>(Items));
+		Context.Result.DiffPropertyMap.Emplace(Path, FDiffData(Path, EDiffType::Merge, bLeftChanged, bRightChanged));
+		return;
+	}
+
+	AddContainerDiff(Context, Path, Property, Base, Left, Right, bLeftChanged, bRightChanged, false, Items);
 }
 
-void UBlueprintMergeLibrary::MergeObjectProperties(UObject* Base, UObject* Left, UObject* Right, UObject* InOutMergedObject)
+void UBlueprintMergeLibrary::AddContainerDiff(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right,
+	bool bLeftChanged, bool bRightChanged, bool bConflict, TConstArrayView<BlueprintMerge::Core::FSequenceItem> Items)
 {
-	TMap<FName, FPropertyData> BasePropertyMap = BuildPropertyMap(Base);
-	TMap<FName, FPropertyData> LeftPropertyMap = BuildPropertyMap(Left);
-	TMap<FName, FPropertyData> RightPropertyMap = BuildPropertyMap(Right);
-	TMap<FName, FPropertyData> MergedPropertyMap = BuildPropertyMap(InOutMergedObject);
-
-	TMap<FName, FDiffData> DiffPropertyMap;
+	if (!bLeftChanged && !bRightChanged)
+	{
+		// 要素は相対パスで比べると等しい
+		return;
+	}
 
-	// マップの要素を結合する
+	// コンテナそのものを差分のキーにして、値を参照できるようにする
+	Context.Result.BasePropertyMap.Emplace(Path, FPropertyData(Property, Base));
+	Context.Result.LeftPropertyMap.Emplace(Path, FPropertyData(Property, Left));
+	Context.Result.RightPropertyMap.Emplace(Path, FPropertyData(Property, Right));
 
-	// キーを統合する
-	TSet<FName> UnionPropertyKeys;
+	bool bLeftUpdate = bLeftChanged;
+	bool bRightUpdate = bRightChanged;
+	EDiffType DiffType = EDiffType::Modify;
+	if (!bConflict && bLeftUpdate && bRightUpdate)
 	{
-		TSet<FName> Keys;
-		BasePropertyMap.GetKeys(Keys);
-		UnionPropertyKeys = UnionPropertyKeys.Union(Keys);
+		BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
+		if (Property->Identical(Left, Right))
+		{
+			// 両方の変更が等しい場合は、プロパティと同じく片方の変更として扱う
+			bRightUpdate = !Context.bResolveSameChanges;
+		}
+		else
+		{
+			DiffType = EDiffType::Merge;
+			Context.Result.ContainerMerges.Emplace(Path, TArray<BlueprintMerge::Core::FSequenceItem>(Items));
+		}
+	}
 
-		LeftPropertyMap.GetKeys(Keys);
-		UnionPropertyKeys = UnionPropertyKeys.Union(Keys);
+	Context.Result.DiffPropertyMap.Emplace(Path, FDiffData(Path, DiffType, bLeftUpdate, bRightUpdate));
+}
 
-		RightPropertyMap.GetKeys(Keys);
-		UnionPropertyKeys = UnionPropertyKeys.Union(Keys);
+bool UBlueprintMergeLibrary::HashContainerElement(const FProperty* Property, const void* Value, UObject* Root, uint32& OutHash)
+{
+	if (const FObjectProperty* ObjectProperty = CastField<FObjectProperty>(Property))
+	{
+		// IdenticalProperties と同じく、Root の中のオブジェクトは相対パスで比べる
+		UObject* Object = ObjectProperty->GetObjectPropertyValue(Value);
+		if (Object && Object->GetOutermostObject() == Root)
+		{
+			OutHash = GetTypeHash(GetObjectPath(Root, Object));
+		}
+		else
+		{
+			OutHash = GetTypeHash(Object);
+		}
+		return true;
 	}
 
-	for (const FName& PropertyPath : UnionPropertyKeys)
+	if (Property->HasAnyPropertyFlags(CPF_HasGetValueTypeHash))
 	{
-		const FPropertyData* BasePropertyData = BasePropertyMap.Find(PropertyPath);
-		const FPropertyData* LeftPropertyData = LeftPropertyMap.Find(PropertyPath);
-		const FPropertyData* RightPropertyData = RightPropertyMap.Find(PropertyPath);
+		OutHash = Property->GetValueTypeHash(Value);
+		return true;
+	}
 
-		EDiffType DiffType = EDiffType::None;
-		bool bIsLeftUpdate = false;
-		bool bIsRightUpdate = false;
+	if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+	{
+		// 独自の比較を持つ構造体は、メンバーのハッシュが比較の結果と合わないことがある
+		if (StructProperty->Struct->StructFlags & STRUCT_IdenticalNative)
+		{
+			return false;
+		}
 
-		if (BasePropertyData)
+		// 構造体の比較はメンバーごとの比較なので、メンバーのハッシュを合わせる
+		uint32 Hash = 0;
+		for (TFieldIterator<FProperty> It(StructProperty->Struct); It; ++It)
 		{
-			if (LeftPropertyData && RightPropertyData)
+			for (int32 ArrayIndex = 0; ArrayIndex < It->ArrayDim; ++ArrayIndex)
 			{
-				// 差分があるかチェック
-				if (!BasePropertyData->Property->Identical(BasePropertyData->Container, LeftPropertyData->Container))
-				{
-					DiffType = EDiffType::Modify;
-					bIsLeftUpdate = true;
-				}
-				if (!BasePropertyData->Property->Identical(BasePropertyData->Container, RightPropertyData->Container))
+				uint32 MemberHash = 0;
+				if (!HashContainerElement(*It, It->ContainerPtrToValuePtr<void>(Value, ArrayIndex), Root, MemberHash))
 				{
-					DiffType = EDiffType::Modify;
-					bIsRightUpdate = true;
+					return false;
 				}
+				Hash = HashCombine(Hash, MemberHash);
+			}
+		}
+		OutHash = Hash;
+		return true;
+	}
 
-				if (bIsLeftUpdate && bIsRightUpdate)
-				{
-					// 両方の変更が等しい場合、片方の変更を反映すればいいので、片方のフラグを下す
-					if (LeftPropertyData->Property->Identical(LeftPropertyData->Container, RightPropertyData->Container))
-					{
-						bIsRightUpdate = false;
-					}
-				}
+	if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+	{
+		FScriptArrayHelper Helper(ArrayProperty, Value);
+		uint32 Hash = ::GetTypeHash(Helper.Num());
+		for (int32 Index = 0; Index < Helper.Num(); ++Index)
+		{
+			uint32 ElementHash = 0;
+			if (!HashContainerElement(ArrayProperty->Inner, Helper.GetRawPtr(Index), Root, ElementHash))
+			{
+				return false;
 			}
+			Hash = HashCombine(Hash, ElementHash);
+		}
+		OutHash = Hash;
+		return true;
+	}
+
+	// ハッシュを持たない型
+	return false;
+}
+
+void UBlueprintMergeLibrary::DiffExpandedEntries(FLazyPropertyDiffContext& Context, const FName* Prefix, const FLazyPropertyValue* Base, const FLazyPropertyValue* Left, const FLazyPropertyValue* Right)
+{
+	auto Expand = [Prefix](const FLazyPropertyValue* Value, FPropertyMap& OutMap)
+	{
+		if (!Value)
+		{
+			return;
+		}
+
+		Value->Schema->ForEachSubtreeValue(Value->EntryIndex, Value->Value, false, [&OutMap](const FName& PropertyPath, const FProperty* Property, const void* PropertyValue, int32 EntryIndex)
+		{
+			OutMap.Emplace(PropertyPath, FPropertyData(Property, PropertyValue, EntryIndex));
+		}, Prefix);
+	};
+
+	FPropertyMap BaseMap;
+	FPropertyMap LeftMap;
+	FPropertyMap RightMap;
+	Expand(Base, BaseMap);
+	Expand(Left, LeftMap);
+	Expand(Right, RightMap);
+	DiffPropertyMaps(Context, BaseMap, LeftMap, RightMap);
+}
+
+void UBlueprintMergeLibrary::DiffExpandedElements(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right)
+{
+	auto Expand = [&Path, Property](const void* Value, FPropertyMap& OutMap)
+	{
+		if (!Value)
+		{
+			return;
+		}
+
+		FBlueprintPropertySchema::ForEachElementValue(Property, Value, Path, false, [&OutMap](const FName& PropertyPath, const FProperty* ElementProperty, const void* ElementValue, int32 EntryIndex)
+		{
+			OutMap.Emplace(PropertyPath, FPropertyData(ElementProperty, ElementValue, EntryIndex));
+		});
+	};
+
+	FPropertyMap BaseMap;
+	FPropertyMap LeftMap;
+	FPropertyMap RightMap;
+	Expand(Base, BaseMap);
+	Expand(Left, LeftMap);
+	Expand(Right, RightMap);
+	DiffPropertyMaps(Context, BaseMap, LeftMap, RightMap);
+}
+
+void UBlueprintMergeLibrary::DiffPropertyMaps(FLazyPropertyDiffContext& Context, FPropertyMap& BaseMap, FPropertyMap& LeftMap, FPropertyMap& RightMap)
+{
+	BLUEPRINT_MERGE_COUNTER_ADD(PropertiesVisited, BaseMap.Num() + LeftMap.Num() + RightMap.Num());
+
+	BlueprintMerge::SortByKey(BaseMap);
+	BlueprintMerge::SortByKey(LeftMap);
+	BlueprintMerge::SortByKey(RightMap);
+
+	BlueprintMerge::ThreeWayJoin(BaseMap, LeftMap, RightMap,
+		[&Context](const FName& PropertyPath, const FPropertyData* BasePropertyData, const FPropertyData* LeftPropertyData, const FPropertyData* RightPropertyData)
+	{
+		ClassifyPropertyDiff(PropertyPath, BasePropertyData, LeftPropertyData, RightPropertyData, Context.bResolveSameChanges, Context.LeftIdenticalEntries, Context.RightIdenticalEntries, Context.Result.DiffPropertyMap);
+	});
+
+	// 差分の値を参照できるように、展開したプロパティを結果のマップに移す
+	Context.Result.BasePropertyMap.Append(MoveTemp(BaseMap));
+	Context.Result.LeftPropertyMap.Append(MoveTemp(LeftMap));
+	Context.Result.RightPropertyMap.Append(MoveTemp(RightMap));
+}
+
+void UBlueprintMergeLibrary::ApplyObjectPropertyDiff(const FPropertyDiffResult& DiffResult, UObject* InOutMergedObject)
+{
+	if (!InOutMergedObject)
+	{
+		return;
+	}
+
+	// 配列そのものを差分のキーにすることがあるので、配列や構造体のパスも含める
+	FPropertyMap MergedPropertyMap = BuildPropertyMap(InOutMergedObject, EBuildPropertyMapOption::IncludeCompositeType);
+
+	BlueprintMerge::TKeyCursor<FPropertyData> BaseCursor(DiffResult.BasePropertyMap);
+	BlueprintMerge::TKeyCursor<FPropertyData> LeftCursor(DiffResult.LeftPropertyMap);
+	BlueprintMerge::TKeyCursor<FPropertyData> RightCursor(DiffResult.RightPropertyMap);
+	BlueprintMerge::TKeyCursor<FPropertyData> MergedCursor(MergedPropertyMap);
+	BlueprintMerge::TKeyCursor<TArray<BlueprintMerge::Core::FSequenceItem>> ContainerMergeCursor(DiffResult.ContainerMerges);
+
+	for (const TPair<FName, FDiffData>& Pair : DiffResult.DiffPropertyMap)
+	{
+		FName PropertyPath = Pair.Key;
+		const FDiffData& DiffPropertyData = Pair.Value;
+
+		const FPropertyData* LeftPropertyData = LeftCursor.Seek(PropertyPath);
+		const FPropertyData* RightPropertyData = RightCursor.Seek(PropertyPath);
+		const FPropertyData* MergedPropertyData = MergedCursor.Seek(PropertyPath);
+
+		if (DiffPropertyData.IsNoDifference())
+		{
+			// 差分がない場合はスキップ
+			continue;
+		}
 
-			if (!LeftPropertyData || !RightPropertyData)
+		if (DiffPropertyData.GetDiffType() == EDiffType::Merge)
+		{
+			// 両側の変更を合わせたコンテナ
+			const FPropertyData* BasePropertyData = BaseCursor.Seek(PropertyPath);
+			const TArray<BlueprintMerge::Core::FSequenceItem>* Items = ContainerMergeCursor.Seek(PropertyPath);
+			if (MergedPropertyData && BasePropertyData && LeftPropertyData && RightPropertyData && Items)
 			{
-				DiffType = EDiffType::Remove;
-				bIsLeftUpdate = !!LeftPropertyData;
-				bIsRightUpdate = !!RightPropertyData;
+				ApplyContainerMerge(*Items, *BasePropertyData, *LeftPropertyData, *RightPropertyData, *MergedPropertyData);
 			}
+			continue;
 		}
-		else
+
+		if (DiffPropertyData.IsLeftUpdate() && DiffPropertyData.IsRightUpdate())
+		{
+			// コンフリクト (マージ計画とレポートで報告する)
+			continue;
+		}
+
+		if (MergedPropertyData)
 		{
-			if (LeftPropertyData || RightPropertyData)
+			if (DiffPropertyData.IsLeftUpdate())
+			{
+				MergedPropertyData->Property->CopyCompleteValue(const_cast<void*>(MergedPropertyData->Container), LeftPropertyData->Container);
+			}
+			else if (DiffPropertyData.IsRightUpdate())
 			{
-				DiffType = EDiffType::Add;
-				bIsLeftUpdate = !!LeftPropertyData;
-				bIsRightUpdate = !!RightPropertyData;
+				MergedPropertyData->Property->CopyCompleteValue(const_cast<void*>(MergedPropertyData->Container), RightPropertyData->Container);
 			}
 		}
+	}
+}
+
+void UBlueprintMergeLibrary::ApplyContainerMerge(const TArray<BlueprintMerge::Core::FSequenceItem>& Items, const FPropertyData& Base, const FPropertyData& Left, const FPropertyData& Right, const FPropertyData& InOutMerged)
+{
+	using BlueprintMerge::Core::ESequenceSide;
+
+	if (!InOutMerged.Property->SameType(Left.Property))
+	{
+		return;
+	}
+
+	// 要素を取り出す側を選ぶ
+	auto SelectSide = [](ESequenceSide Side, auto& BaseHelper, auto& LeftHelper, auto& RightHelper) -> auto&
+	{
+		return (Side == ESequenceSide::Left) ? LeftHelper : (Side == ESequenceSide::Right) ? RightHelper : BaseHelper;
+	};
+
+	if (const FArrayProperty* MergedArrayProperty = CastField<FArrayProperty>(InOutMerged.Property))
+	{
+		FScriptArrayHelper BaseHelper(CastFieldChecked<FArrayProperty>(Base.Property), Base.Container);
+		FScriptArrayHelper LeftHelper(CastFieldChecked<FArrayProperty>(Left.Property), Left.Container);
+		FScriptArrayHelper RightHelper(CastFieldChecked<FArrayProperty>(Right.Property), Right.Container);
+		FScriptArrayHelper MergedHelper(MergedArrayProperty, const_cast<void*>(InOutMerged.Container));
+
+		MergedHelper.EmptyAndAddValues(Items.Num());
+		for (int32 Index = 0; Index < Items.Num(); ++Index)
+		{
+			FScriptArrayHelper& SourceHelper = SelectSide(Items[Index].Side, BaseHelper, LeftHelper, RightHelper);
+			MergedArrayProperty->Inner->CopyCompleteValue(MergedHelper.GetRawPtr(Index), SourceHelper.GetRawPtr(Items[Index].Index));
+		}
+	}
+	else if (const FMapProperty* MergedMapProperty = CastField<FMapProperty>(InOutMerged.Property))
+	{
+		FScriptMapHelper BaseHelper(CastFieldChecked<FMapProperty>(Base.Property), Base.Container);
+		FScriptMapHelper LeftHelper(CastFieldChecked<FMapProperty>(Left.Property), Left.Container);
+		FScriptMapHelper RightHelper(CastFieldChecked<FMapProperty>(Right.Property), Right.Container);
+		FScriptMapHelper MergedHelper(MergedMapProperty, const_cast<void*>(InOutMerged.Container));
+
+		// 追加のたびにハッシュを作り直さないよう、要素数を確保してから追加する
+		MergedHelper.EmptyValues(Items.Num());
+		for (const BlueprintMerge::Core::FSequenceItem& Item : Items)
+		{
+			FScriptMapHelper& SourceHelper = SelectSide(Item.Side, BaseHelper, LeftHelper, RightHelper);
+			MergedHelper.AddPair(SourceHelper.GetKeyPtr(Item.Index), SourceHelper.GetValuePtr(Item.Index));
+		}
+	}
+	else if (const FSetProperty* MergedSetProperty = CastField<FSetProperty>(InOutMerged.Property))
+	{
+		FScriptSetHelper BaseHelper(CastFieldChecked<FSetProperty>(Base.Property), Base.Container);
+		FScriptSetHelper LeftHelper(CastFieldChecked<FSetProperty>(Left.Property), Left.Container);
+		FScriptSetHelper RightHelper(CastFieldChecked<FSetProperty>(Right.Property), Right.Container);
+		FScriptSetHelper MergedHelper(MergedSetProperty, const_cast<void*>(InOutMerged.Container));
+
+		MergedHelper.EmptyElements(Items.Num());
+		for (const BlueprintMerge::Core::FSequenceItem& Item : Items)
+		{
+			FScriptSetHelper& SourceHelper = SelectSide(Item.Side, BaseHelper, LeftHelper, RightHelper);
+			MergedHelper.AddElement(SourceHelper.GetElementPtr(Item.Index));
+		}
+	}
+}
+
+void UBlueprintMergeLibrary::MergeComponentProperties(FPropertyData& BaseComponentProperty, FPropertyData& LeftComponentProperty, FPropertyData& RightComponentProperty, FPropertyData& InOutMergedComponentProperty)
+{
+	const FObjectProperty* BaseObjectProperty = CastField<FObjectProperty>(BaseComponentProperty.Property);
+	const FObjectProperty* LeftObjectProperty = CastField<FObjectProperty>(LeftComponentProperty.Property);
+	const FObjectProperty* RightObjectProperty = CastField<FObjectProperty>(RightComponentProperty.Property);
+	const FObjectProperty* MergedObjectProperty = CastField<FObjectProperty>(InOutMergedComponentProperty.Property);
+	if (!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(BaseObjectProperty)) ||
+		!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(LeftObjectProperty)) ||
+		!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(RightObjectProperty)) ||
+		!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(MergedObjectProperty)))
+	{
+		return;
+	}
+
+	UActorComponent* BaseComponent = Cast<UActorComponent>(BaseObjectProperty->GetObjectPropertyValue(BaseComponentProperty.Container));
+	UActorComponent* LeftComponent = Cast<UActorComponent>(LeftObjectProperty->GetObjectPropertyValue(LeftComponentProperty.Container));
+	UActorComponent* RightComponent = Cast<UActorComponent>(RightObjectProperty->GetObjectPropertyValue(RightComponentProperty.Container));
+	UActorComponent* MergedComponent = Cast<UActorComponent>(MergedObjectProperty->GetObjectPropertyValue(InOutMergedComponentProperty.Container));
+	
+	if (BaseComponent && LeftComponent && RightComponent && MergedComponent)
+	{
+		// プロパティをマージ
+		MergeObjectProperties(BaseComponent, LeftComponent, RightComponent, MergedComponent);
+	}
+}
+
+void UBlueprintMergeLibrary::DiffBlueprintComponents(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, FComponentDiffResult& OutResult)
+{
+	BLUEPRINT_MERGE_SCOPE(DiffComponents);
+
+	if (!Base || !Left || !Right)
+	{
+		return;
+	}
+
+	OutResult.BaseSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Base->GeneratedClass));
+	OutResult.LeftSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Left->GeneratedClass));
+	OutResult.RightSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Right->GeneratedClass));
+
+	BlueprintMerge::ThreeWayJoin(OutResult.BaseSCSNodeMap, OutResult.LeftSCSNodeMap, OutResult.RightSCSNodeMap,
+		[&OutResult](const FName& Path, USCS_Node* const* BaseNodePtr, USCS_Node* const* LeftNodePtr, USCS_Node* const* RightNodePtr)
+	{
+		const USCS_Node* BaseNode = BaseNodePtr ? *BaseNodePtr : nullptr;
+		const USCS_Node* LeftNode = LeftNodePtr ? *LeftNodePtr : nullptr;
+		const USCS_Node* RightNode = RightNodePtr ? *RightNodePtr : nullptr;
+
+		if (BaseNode && LeftNode && RightNode)
+		{
+			// テンプレートのプロパティ差分はここで解析し、反映はマージ時に行う
+			FPropertyDiffResult& TemplateDiff = OutResult.TemplateDiffs.Emplace_GetRef(Path, FPropertyDiffResult()).Value;
+			DiffObjectProperties(BaseNode->ComponentTemplate, LeftNode->ComponentTemplate, RightNode->ComponentTemplate, true, TemplateDiff);
+			return;
+		}
+
+		// コンポーネント自身は追加と削除だけを判定する
+		BlueprintMerge::Core::FClassifyOptions Options;
+		Options.bRemoveConflictsWithModify = false;
+
+		const BlueprintMerge::Core::FDecision Decision = BlueprintMerge::Core::ClassifyThreeWay(!!BaseNode, !!LeftNode, !!RightNode,
+			BlueprintMerge::Core::FNever(), BlueprintMerge::Core::FNever(), BlueprintMerge::Core::FNever(), Options);
+
+		const FDiffData DiffData = MakeDiffData(Path, Decision, !!LeftNode, !!RightNode, true);
+		if (DiffData.IsNoDifference())
+		{
+			// 差分がない場合はスキップ
+			return;
+		}
+
+		OutResult.DiffMap.Emplace(Path, DiffData);
+	});
+}
+
+void UBlueprintMergeLibrary::ApplyComponentTemplateDiffs(const FComponentDiffResult& DiffResult, UBlueprint* InOutMergedBlueprint)
+{
+	if (!InOutMergedBlueprint || DiffResult.TemplateDiffs.IsEmpty())
+	{
+		return;
+	}
 
-		if (!bIsLeftUpdate && !bIsRightUpdate)
+	FSCSNodeMap MergedSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(InOutMergedBlueprint->GeneratedClass));
+
+	// 全てに存在するコンポーネントのプロパティをマージ
+	BlueprintMerge::TKeyCursor<USCS_Node*> MergedCursor(MergedSCSNodeMap);
+	for (const TPair<FName, FPropertyDiffResult>& Pair : DiffResult.TemplateDiffs)
+	{
+		if (const USCS_Node* MergedNode = MergedCursor.SeekRef(Pair.Key))
 		{
-			// 差分がない場合はスキップ
-			continue;
+			ApplyObjectPropertyDiff(Pair.Value, MergedNode->ComponentTemplate);
 		}
+	}
+}
+
+bool UBlueprintMergeLibrary::MergeBlueprintComponents(const FComponentDiffResult& DiffResult, UBlueprint* InOutMergedBlueprint)
+{
+	BLUEPRINT_MERGE_SCOPE(MergeComponents);
 
-		DiffPropertyMap.Emplace(PropertyPath, FDiffData(PropertyPath, DiffType, bIsLeftUpdate, bIsRightUpdate));
+	if (!InOutMergedBlueprint || DiffResult.DiffMap.IsEmpty())
+	{
+		return false;
 	}
 
-	for (TPair<FName, FDiffData>& Pair : DiffPropertyMap)
+	bool bChanged = false;
+	FSCSNodeMap MergedSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(InOutMergedBlueprint->GeneratedClass));
+
+	BlueprintMerge::TKeyCursor<USCS_Node*> LeftCursor(DiffResult.LeftSCSNodeMap);
+	BlueprintMerge::TKeyCursor<USCS_Node*> RightCursor(DiffResult.RightSCSNodeMap);
+	BlueprintMerge::TKeyCursor<USCS_Node*> MergedCursor(MergedSCSNodeMap);
+
+	for (const TPair<FName, FDiffData>& Pair : DiffResult.DiffMap)
 	{
-		FName PropertyPath = Pair.Key;
-		const FDiffData& DiffPropertyData = Pair.Value;
+		FName Path = Pair.Key;
+		const FDiffData& DiffData = Pair.Value;
 
-		const FPropertyData* LeftPropertyData = LeftPropertyMap.Find(PropertyPath);
-		const FPropertyData* RightPropertyData = RightPropertyMap.Find(PropertyPath);
-		const FPropertyData* MergedPropertyData = MergedPropertyMap.Find(PropertyPath);
+		USCS_Node* LeftNode = LeftCursor.SeekRef(Path);
+		USCS_Node* RightNode = RightCursor.SeekRef(Path);
+		USCS_Node* MergedNode = MergedCursor.SeekRef(Path);
 
-		if (DiffPropertyData.IsNoDifference())
+		if (DiffData.IsNoDifference())
 		{
 			// 差分がない場合はスキップ
 			continue;
 		}
 
-		if (DiffPropertyData.IsLeftUpdate() && DiffPropertyData.IsRightUpdate())
+		if (DiffData.IsLeftUpdate() && DiffData.IsRightUpdate())
 		{
-			// コンフリクト
-			UE_LOG(LogTemp, Log, TEXT("Conflict!! PropertyName[%s]"), *PropertyPath.ToString());
+			// コンフリクト (マージ計画とレポートで報告する)
 			continue;
 		}
 
-		if (MergedPropertyData)
+		if (!MergedNode)
 		{
-			if (DiffPropertyData.IsLeftUpdate())
-			{
-				MergedPropertyData->Property->CopyCompleteValue(const_cast<void*>(MergedPropertyData->Container), LeftPropertyData->Container);
-			}
-			else if (DiffPropertyData.IsRightUpdate())
+			if (DiffData.GetDiffType() == EDiffType::Add)
 			{
-				MergedPropertyData->Property->CopyCompleteValue(const_cast<void*>(MergedPropertyData->Container), RightPropertyData->Container);
+				// ノードが見つからない場合は何もしない
+				if (!LeftNode && !RightNode)
+				{
+					continue;
+				}
+
+				USCS_Node* UpdateNode = LeftNode ? LeftNode : RightNode;
+				BLUEPRINT_MERGE_COUNTER_ADD(ObjectsDuplicated, 2);
+				USCS_Node* NewNode = DuplicateObject(UpdateNode, InOutMergedBlueprint->SimpleConstructionScript);
+				NewNode->ComponentTemplate = DuplicateObject(UpdateNode->ComponentTemplate, InOutMergedBlueprint->SimpleConstructionScript->GetOwnerClass());
+				NewNode->ChildNodes.Empty();
+
+				USimpleConstructionScript* MergedSCS = InOutMergedBlueprint->SimpleConstructionScript;
+				if (USCS_Node* ParentNode = UpdateNode->GetSCS()->FindParentNode(UpdateNode))
+				{
+					USCS_Node* MergedParentNode = MergedSCS->FindSCSNode(ParentNode->GetVariableName());
+					if (!MergedParentNode)
+					{
+						// 親がマージ結果にない場合は追加しない
+						UE_LOG(LogTemp, Warning, TEXT("Parent component is not found in the merged blueprint. Component[%s] Parent[%s]"), *NewNode->GetVariableName().ToString(), *ParentNode->GetVariableName().ToString());
+						continue;
+					}
+					MergedParentNode->AddChildNode(NewNode);
+				}
+				else
+				{
+					// 最上位のコンポーネント
+					MergedSCS->AddNode(NewNode);
+				}
+				bChanged = true;
 			}
 		}
+		else if (DiffData.GetDiffType() == EDiffType::Remove)
+		{
+			// Removeは処理しない
+		}
 	}
+	return bChanged;
 }
 
-void UBlueprintMergeLibrary::MergeComponentProperties(FPropertyData& BaseComponentProperty, FPropertyData& LeftComponentProperty, FPropertyData& RightComponentProperty, FPropertyData& InOutMergedComponentProperty)
+void UBlueprintMergeLibrary::DiffBlueprintGraphs(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, TArray<FGraphDiffResult>& OutResults)
 {
-	const FObjectProperty* BaseObjectProperty = CastField<FObjectProperty>(BaseComponentProperty.Property);
-	const FObjectProperty* LeftObjectProperty = CastField<FObjectProperty>(LeftComponentProperty.Property);
-	const FObjectProperty* RightObjectProperty = CastField<FObjectProperty>(RightComponentProperty.Property);
-	const FObjectProperty* MergedObjectProperty = CastField<FObjectProperty>(InOutMergedComponentProperty.Property);
-	if (!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(BaseObjectProperty)) ||
-		!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(LeftObjectProperty)) ||
-		!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(RightObjectProperty)) ||
-		!FBlueprintEditorUtils::IsSCSComponentProperty(const_cast<FObjectProperty*>(MergedObjectProperty)))
+	if (!Base || !Left || !Right)
 	{
 		return;
 	}
 
-	UActorComponent* BaseComponent = Cast<UActorComponent>(BaseObjectProperty->GetObjectPropertyValue(BaseComponentProperty.Container));
-	UActorComponent* LeftComponent = Cast<UActorComponent>(LeftObjectProperty->GetObjectPropertyValue(LeftComponentProperty.Container));
-	UActorComponent* RightComponent = Cast<UActorComponent>(RightObjectProperty->GetObjectPropertyValue(RightComponentProperty.Container));
-	UActorComponent* MergedComponent = Cast<UActorComponent>(MergedObjectProperty->GetObjectPropertyValue(InOutMergedComponentProperty.Container));
-	
-	if (BaseComponent && LeftComponent && RightComponent && MergedComponent)
+	FGraphHierarchy BaseGraphs;
+	FGraphHierarchy LeftGraphs;
+	FGraphHierarchy RightGraphs;
 	{
-		// プロパティをマージ
-		MergeObjectProperties(BaseComponent, LeftComponent, RightComponent, MergedComponent);
+		BLUEPRINT_MERGE_SCOPE(DiffGraphs);
+		BuildGraphHierarchy(Base, BaseGraphs);
+		BuildGraphHierarchy(Left, LeftGraphs);
+		BuildGraphHierarchy(Right, RightGraphs);
 	}
-}
 
-void UBlueprintMergeLibrary::MergeBlueprintComponents(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, UBlueprint* InOutMergedBlueprint)
-{
-	if (!Base || !Left || !Right || !InOutMergedBlueprint)
+	if (CVarParallelGraphDiff.GetValueOnAnyThread())
 	{
+		DiffBlueprintGraphsParallel(BaseGraphs, LeftGraphs, RightGraphs, OutResults);
 		return;
 	}
 
-	auto ExistSameComponent = [](const TArray<UActorComponent*>& Components, UActorComponent* Component) -> bool
+	for (EGraphType Type : GetAnalyzedGraphTypes())
+	{
+		DiffFunctionGraphs(BaseGraphs, LeftGraphs, RightGraphs, Type, OutResults.AddDefaulted_GetRef());
+	}
+}
+
+void UBlueprintMergeLibrary::DiffFunctionGraphs(FGraphHierarchy& BaseGraphs, FGraphHierarchy& LeftGraphs, FGraphHierarchy& RightGraphs, EGraphType Type, FGraphDiffResult& OutResult)
+{
+	BLUEPRINT_MERGE_SCOPE(DiffGraphs);
+
+	OutResult.Type = Type;
+	OutResult.BaseGraphMap = MoveTemp(BaseGraphs[Type]);
+	OutResult.LeftGraphMap = MoveTemp(LeftGraphs[Type]);
+	OutResult.RightGraphMap = MoveTemp(RightGraphs[Type]);
+
+	BlueprintMerge::ThreeWayJoin(OutResult.BaseGraphMap, OutResult.LeftGraphMap, OutResult.RightGraphMap,
+		[&OutResult](const FName& Path, UEdGraph* const* BaseGraphPtr, UEdGraph* const* LeftGraphPtr, UEdGraph* const* RightGraphPtr)
 	{
-		return Components.ContainsByPredicate([Component](UActorComponent* InComponent)
+		UEdGraph* BaseGraph = BaseGraphPtr ? *BaseGraphPtr : nullptr;
+		UEdGraph* LeftGraph = LeftGraphPtr ? *LeftGraphPtr : nullptr;
+		UEdGraph* RightGraph = RightGraphPtr ? *RightGraphPtr : nullptr;
+
+		TArray<FName> DiffProperties;
+		FGraphNodeDiffResult NodeDiff;
+		const BlueprintMerge::Core::FDecision Decision = ClassifyGraphs(BaseGraph, LeftGraph, RightGraph, DiffProperties);
+		const bool bNodeMerge = DiffGraphNodesIfSupported(OutResult.Type, Decision, BaseGraph, LeftGraph, RightGraph, NodeDiff);
+		AddGraphDiff(Path, LeftGraph, RightGraph, Decision, DiffProperties, bNodeMerge, NodeDiff, OutResult);
+	});
+}
+
+void UBlueprintMergeLibrary::DiffBlueprintGraphsParallel(FGraphHierarchy& BaseGraphs, FGraphHierarchy& LeftGraphs, FGraphHierarchy& RightGraphs, TArray<FGraphDiffResult>& OutResults)
+{
+	// 全ての種類のグラフの組を、種類とキーの順に集める
+	TArray<FGraphComparison> Comparisons;
+	for (EGraphType Type : GetAnalyzedGraphTypes())
+	{
+		const int32 ResultIndex = OutResults.Num();
+		FGraphDiffResult& Result = OutResults.AddDefaulted_GetRef();
+		Result.Type = Type;
+		Result.BaseGraphMap = MoveTemp(BaseGraphs[Type]);
+		Result.LeftGraphMap = MoveTemp(LeftGraphs[Type]);
+		Result.RightGraphMap = MoveTemp(RightGraphs[Type]);
+
+		BlueprintMerge::ThreeWayJoin(Result.BaseGraphMap, Result.LeftGraphMap, Result.RightGraphMap,
+			[&Comparisons, ResultIndex, Type](const FName& Path, UEdGraph* const* BaseGraphPtr, UEdGraph* const* LeftGraphPtr, UEdGraph* const* RightGraphPtr)
 		{
-			return InComponent->GetFName() == Component->GetFName();
+			FGraphComparison& Comparison = Comparisons.AddDefaulted_GetRef();
+			Comparison.ResultIndex = ResultIndex;
+			Comparison.Type = Type;
+			Comparison.Path = Path;
+			Comparison.BaseGraph = BaseGraphPtr ? *BaseGraphPtr : nullptr;
+			Comparison.LeftGraph = LeftGraphPtr ? *LeftGraphPtr : nullptr;
+			Comparison.RightGraph = RightGraphPtr ? *RightGraphPtr : nullptr;
 		});
-	};
+	}
 
-	auto GetComponents = [](UBlueprint* ComponentOwner) ->  TArray<UActorComponent*>
+	// 判定とノード単位の差分は読み取りのみなので並列に行う
+	// パスのテーブルは共有し、アリーナは 1 つのスレッドからしか使えないのでワーカーごとに用意する
+	// アリーナは作業用の一時的な確保だけに使い、組に残す結果はヒープから確保する
 	{
-		if (AActor* Actor = Cast<AActor>(ComponentOwner->GeneratedClass->GetDefaultObject()))
-		{
-			return Actor->BlueprintCreatedComponents;
-		}
-		return {};
-	};
-	TArray<UActorComponent*> BaseComponents = GetComponents(Base);
+		BLUEPRINT_MERGE_SCOPE(DiffGraphs);
+		FBlueprintMergePathTable* Paths = FBlueprintMergePathTable::GetCurrent();
+		TArray<TUniquePtr<FMergeArena>> WorkerArenas;
+		ParallelForWithTaskContext(TEXT("BlueprintMerge_DiffGraphs"), WorkerArenas, Comparisons.Num(),
+			[](int32 ContextIndex, int32 NumContexts)
+			{
+				return MakeUnique<FMergeArena>();
+			},
+			[&Comparisons, Paths](TUniquePtr<FMergeArena>& WorkerArena, int32 Index)
+			{
+				FBlueprintMergePathTable::FScope PathScope(Paths);
+				FMergeArena::FScope ArenaScope(WorkerArena.Get());
+
+				FGraphComparison& Comparison = Comparisons[Index];
+				Comparison.Decision = ClassifyGraphs(Comparison.BaseGraph, Comparison.LeftGraph, Comparison.RightGraph, Comparison.DiffProperties);
+				Comparison.bNodeMerge = DiffGraphNodesIfSupported(Comparison.Type, Comparison.Decision, Comparison.BaseGraph, Comparison.LeftGraph, Comparison.RightGraph, Comparison.NodeDiff);
+			});
+	}
 
-	auto GetNewComponents = [&ExistSameComponent](const TArray<UActorComponent*>& BaseComponents, const TArray<UActorComponent*>& OtherComponents) ->  TArray<UActorComponent*>
+	// 結果はキーの順に反映する
+	BLUEPRINT_MERGE_SCOPE(DiffGraphs);
+	for (FGraphComparison& Comparison : Comparisons)
 	{
-		TArray<UActorComponent*> NewComponents;
-		for (UActorComponent* Component : OtherComponents)
+		AddGraphDiff(Comparison.Path, Comparison.LeftGraph, Comparison.RightGraph, Comparison.Decision, Comparison.DiffProperties, Comparison.bNodeMerge, Comparison.NodeDiff, OutResults[Comparison.ResultIndex]);
+	}
+}
+
+BlueprintMerge::Core::FDecision UBlueprintMergeLibrary::ClassifyGraphs(UEdGraph* BaseGraph, UEdGraph* LeftGraph, UEdGraph* RightGraph, TArray<FName>& OutDiffProperties)
+{
+	return BlueprintMerge::Core::ClassifyThreeWay(!!BaseGraph, !!LeftGraph, !!RightGraph,
+		[&]()
 		{
-			if (!ExistSameComponent(BaseComponents, Component))
-			{
-				NewComponents.Add(Component);
-			}
-		}
-		return NewComponents;
-	};
+			TArray<FName> LeftDiffProperties;
+			return !IdenticalGraphs(BaseGraph, LeftGraph, LeftDiffProperties);
+		},
+		[&]()
+		{
+			TArray<FName> RightDiffProperties;
+			return !IdenticalGraphs(BaseGraph, RightGraph, RightDiffProperties);
+		},
+		[&]() { return IdenticalGraphs(LeftGraph, RightGraph, OutDiffProperties); });
+}
+
+bool UBlueprintMergeLibrary::DiffGraphNodesIfSupported(EGraphType Type, const BlueprintMerge::Core::FDecision& Decision, UEdGraph* BaseGraph, UEdGraph* LeftGraph, UEdGraph* RightGraph, FGraphNodeDiffResult& OutNodeDiff)
+{
+	// 変更されたノードだけを反映できる場合は、グラフを丸ごと置き換えない
+	if (Decision.Change != BlueprintMerge::Core::EChange::Modify || !IsNodeMergeSupported(Type))
+	{
+		return false;
+	}
+	return DiffGraphNodes(BaseGraph, LeftGraph, RightGraph, OutNodeDiff);
+}
+
+void UBlueprintMergeLibrary::AddGraphDiff(const FName& Path, UEdGraph* LeftGraph, UEdGraph* RightGraph, const BlueprintMerge::Core::FDecision& Decision, TArray<FName>& DiffProperties, bool bNodeMerge, FGraphNodeDiffResult& NodeDiff, FGraphDiffResult& OutResult)
+{
+	if (bNodeMerge)
+	{
+		OutResult.NodeDiffs.Emplace(Path, MoveTemp(NodeDiff));
+	}
+	else if (Decision.IsConflict())
+	{
+		// ノード単位の解析で見つかったコンフリクトの方が詳しい
+		OutResult.ConflictDetails.Emplace(Path, NodeDiff.Conflicts.IsEmpty() ? MoveTemp(DiffProperties) : MoveTemp(NodeDiff.Conflicts));
+	}
 
-	TArray<UActorComponent*> LeftComponents;
-	TArray<UActorComponent*> RightComponents;
-	LeftComponents = GetComponents(Left);
-	RightComponents = GetComponents(Right);
+	const FDiffData DiffData = MakeDiffData(Path, Decision, !!LeftGraph, !!RightGraph, false);
+	if (DiffData.IsNoDifference())
+	{
+		// 差分がない場合はスキップ
+		return;
+	}
 
-	TMap<FName, USCS_Node*> BaseSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Base->GeneratedClass));
-	TMap<FName, USCS_Node*> LeftSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Left->GeneratedClass));
-	TMap<FName, USCS_Node*> RightSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(Right->GeneratedClass));
-	TMap<FName, USCS_Node*> MergedSCSNodeMap = BuildSCSNodeMap(Cast<UBlueprintGeneratedClass>(InOutMergedBlueprint->GeneratedClass));
+	OutResult.DiffMap.Emplace(Path, DiffData);
+}
 
-	// キーを統合する
-	TSet<FName> UnionKeys;
+bool UBlueprintMergeLibrary::MergeFunctionGraphs(const FGraphDiffResult& DiffResult, UBlueprint* InOutMergedBlueprint)
+{
+	if (!InOutMergedBlueprint || DiffResult.DiffMap.IsEmpty())
 	{
-		TSet<FName> Keys;
-		BaseSCSNodeMap.GetKeys(Keys);
-		UnionKeys = UnionKeys.Union(Keys);
+		return false;
+	}
 
-		LeftSCSNodeMap.GetKeys(Keys);
-		UnionKeys = UnionKeys.Union(Keys);
+	bool bChanged = false;
+	const EGraphType Type = DiffResult.Type;
 
-		RightSCSNodeMap.GetKeys(Keys);
-		UnionKeys = UnionKeys.Union(Keys);
+	// グラフの種類ごとに計測する
+	TStatId StatId;
+	EBlueprintMergePhase Phase = EBlueprintMergePhase::Num;
+	const TCHAR* ScopeName = TEXT("BlueprintMerge_MergeGraphs");
+	switch (Type)
+	{
+	case EGraphType::Function:
+		StatId = GET_STATID(STAT_BlueprintMerge_MergeFunctionGraphs);
+		Phase = EBlueprintMergePhase::MergeFunctionGraphs;
+		ScopeName = TEXT("BlueprintMerge_MergeFunctionGraphs");
+		break;
+	case EGraphType::Event:
+		StatId = GET_STATID(STAT_BlueprintMerge_MergeEventGraphs);
+		Phase = EBlueprintMergePhase::MergeEventGraphs;
+		ScopeName = TEXT("BlueprintMerge_MergeEventGraphs");
+		break;
+	case EGraphType::Macro:
+		StatId = GET_STATID(STAT_BlueprintMerge_MergeMacroGraphs);
+		Phase = EBlueprintMergePhase::MergeMacroGraphs;
+		ScopeName = TEXT("BlueprintMerge_MergeMacroGraphs");
+		break;
+	case EGraphType::Delegate:
+		StatId = GET_STATID(STAT_BlueprintMerge_MergeDelegateGraphs);
+		Phase = EBlueprintMergePhase::MergeDelegateGraphs;
+		ScopeName = TEXT("BlueprintMerge_MergeDelegateGraphs");
+		break;
+	case EGraphType::Ubergraph:
+		StatId = GET_STATID(STAT_BlueprintMerge_MergeUbergraphs);
+		Phase = EBlueprintMergePhase::MergeUbergraphs;
+		ScopeName = TEXT("BlueprintMerge_MergeUbergraphs");
+		break;
+	default:
+		break;
+	}
+	FScopeCycleCounter CycleCounter(StatId);
+	FBlueprintMergePhaseTimes::FScope PhaseScope(Phase);
+	TRACE_CPUPROFILER_EVENT_SCOPE_TEXT_ON_CHANNEL(ScopeName, BlueprintMergeChannel);
+
+	// グラフごと複製し直すか削除するグラフ (ノード単位でマージするものとコンフリクトは除く)
+	// 入れ子のグラフは先祖と一緒に複製・削除されるので、先祖がここに含まれるグラフは反映しない
+	TMap<FName, const FDiffData*> ReplacedGraphs;
+	BlueprintMerge::TKeyCursor<FGraphNodeDiffResult> ReplacedNodeDiffCursor(DiffResult.NodeDiffs);
+	for (const TPair<FName, FDiffData>& Pair : DiffResult.DiffMap)
+	{
+		const FDiffData& DiffData = Pair.Value;
+		const bool bNodeMerge = ReplacedNodeDiffCursor.Seek(Pair.Key) != nullptr;
+		if (!DiffData.IsNoDifference() && !bNodeMerge && !(DiffData.IsLeftUpdate() && DiffData.IsRightUpdate()))
+		{
+			ReplacedGraphs.Add(Pair.Key, &DiffData);
+		}
 	}
 
-	TMap<FName, FDiffData> DiffMap;
-	for (const FName& Path : UnionKeys)
+	// 入れ子のグラフは、最上位のグラフを反映した後に浅いものから順に反映する
+	// 親のグラフのノードを複製し直すと入れ子のグラフも作り直されるので、深さごとにマージ後のグラフを引き直す
+	TArray<TPair<int32, const TPair<FName, FDiffData>*>> NestedDiffs;
+
+	auto FindGraph = [](const FGraphMap& GraphMap, const FName& Path) -> UEdGraph*
 	{
-		const USCS_Node* BaseNode = BaseSCSNodeMap.FindRef(Path);
-		const USCS_Node* LeftNode = LeftSCSNodeMap.FindRef(Path);
-		const USCS_Node* RightNode = RightSCSNodeMap.FindRef(Path);
-		const USCS_Node* MergedNode = MergedSCSNodeMap.FindRef(Path);
+		UEdGraph* const* Graph = BlueprintMerge::FindByKey(GraphMap, Path);
+		return Graph ? *Graph : nullptr;
+	};
 
-		EDiffType DiffType = EDiffType::None;
-		bool bIsLeftUpdate = false;
-		bool bIsRightUpdate = false;
+	auto ApplyGraphDiff = [&](const FName& Path, const FDiffData& DiffData, UEdGraph* MergedGraph, bool bNested)
+	{
+		UEdGraph* LeftGraph = FindGraph(DiffResult.LeftGraphMap, Path);
+		UEdGraph* RightGraph = FindGraph(DiffResult.RightGraphMap, Path);
 
-		if (BaseNode)
+		if (const FGraphNodeDiffResult* NodeDiff = BlueprintMerge::FindByKey(DiffResult.NodeDiffs, Path))
 		{
-			if (LeftNode && RightNode)
+			// 変更されたノードとリンクだけを反映する
+			if (MergedGraph)
 			{
-				MergeObjectProperties(BaseNode->ComponentTemplate, LeftNode->ComponentTemplate, RightNode->ComponentTemplate, MergedNode->ComponentTemplate);
+				MergeGraphNodes(*NodeDiff, MergedGraph, InOutMergedBlueprint);
+				bChanged = true;
 			}
-			else
+			return;
+		}
+
+		if (DiffData.IsLeftUpdate() && DiffData.IsRightUpdate())
+		{
+			// コンフリクト (マージ計画とレポートで報告する)
+			return;
+		}
+
+		UEdGraph* UpdateGraph = DiffData.IsLeftUpdate() ? LeftGraph : RightGraph;
+		if (bNested)
+		{
+			// 入れ子のグラフの追加と削除は、持ち主のノードと一緒に親のグラフで反映される
+			// 変更は、持ち主のノードの下に複製し直す
+			if (DiffData.GetDiffType() == EDiffType::Modify && MergedGraph && UpdateGraph)
 			{
-				DiffType = EDiffType::Remove;
-				bIsLeftUpdate = !!LeftNode;
-				bIsRightUpdate = !!RightNode;
+				BLUEPRINT_MERGE_COUNTER_ADD(ObjectsDuplicated, 1);
+				ReplaceNestedGraph(MergedGraph, UpdateGraph);
+				bChanged = true;
 			}
+			return;
 		}
-		else
+
+		if (!MergedGraph)
 		{
-			if (LeftNode || RightNode)
+			if (DiffData.GetDiffType() == EDiffType::Add)
 			{
-				DiffType = EDiffType::Add;
-				bIsLeftUpdate = !!LeftNode;
-				bIsRightUpdate = !!RightNode;
+				// ノードが見つからない場合は何もしない
+				if (!LeftGraph && !RightGraph)
+				{
+					return;
+				}
+
+				BLUEPRINT_MERGE_COUNTER_ADD(ObjectsDuplicated, 1);
+				UEdGraph* NewGraph = DuplicateObject(LeftGraph ? LeftGraph : RightGraph, InOutMergedBlueprint);
+				AddGraphToBlueprint(InOutMergedBlueprint, NewGraph, Type);
+				bChanged = true;
 			}
 		}
-
-		if (!bIsLeftUpdate && !bIsRightUpdate)
+		else if (DiffData.GetDiffType() == EDiffType::Remove)
 		{
-			// 差分がない場合はスキップ
-			continue;
+			// コンパイルは呼び出し元で最後にまとめて行う
+			FBlueprintEditorUtils::RemoveGraph(InOutMergedBlueprint, MergedGraph, EGraphRemoveFlags::MarkTransient);
+			bChanged = true;
+		}
+		else if (DiffData.GetDiffType() == EDiffType::Modify)
+		{
+			FBlueprintEditorUtils::RemoveGraph(InOutMergedBlueprint, MergedGraph, EGraphRemoveFlags::MarkTransient);
+			bChanged = true;
+			if (UpdateGraph)
+			{
+				BLUEPRINT_MERGE_COUNTER_ADD(ObjectsDuplicated, 1);
+				UEdGraph* NewGraph = DuplicateObject(UpdateGraph, InOutMergedBlueprint);
+				AddGraphToBlueprint(InOutMergedBlueprint, NewGraph, Type);
+			}
 		}
+	};
 
-		DiffMap.Emplace(Path, FDiffData(Path, DiffType, bIsLeftUpdate, bIsRightUpdate));
-	}
+	FGraphMap MergedGraphMap = BuildGraphMap(InOutMergedBlueprint, Type);
+	BlueprintMerge::TKeyCursor<UEdGraph*> MergedCursor(MergedGraphMap);
 
-	for (TPair<FName, FDiffData>& Pair : DiffMap)
+	for (const TPair<FName, FDiffData>& Pair : DiffResult.DiffMap)
 	{
-		FName Path = Pair.Key;
+		const FName& Path = Pair.Key;
 		const FDiffData& DiffData = Pair.Value;
-
-		USCS_Node* LeftNode = LeftSCSNodeMap.FindRef(Path);
-		USCS_Node* RightNode = RightSCSNodeMap.FindRef(Path);
-		USCS_Node* MergedNode = MergedSCSNodeMap.FindRef(Path);
-
 		if (DiffData.IsNoDifference())
 		{
 			// 差分がない場合はスキップ
 			continue;
 		}
 
-		if (DiffData.IsLeftUpdate() && DiffData.IsRightUpdate())
+		int32 Depth = 0;
+		const FDiffData* ReplacedAncestor = nullptr;
+		for (FName Parent = FBlueprintMergePathTable::GetParentPath(Path); !Parent.IsNone(); Parent = FBlueprintMergePathTable::GetParentPath(Parent))
 		{
-			// コンフリクト
-			UE_LOG(LogTemp, Log, TEXT("Conflict!! ComponentName[%s]"), *Path.ToString());
-			continue;
+			++Depth;
+			if (const FDiffData* const* Ancestor = ReplacedGraphs.Find(Parent))
+			{
+				ReplacedAncestor = *Ancestor;
+			}
 		}
 
-		if (!MergedNode)
+		if (ReplacedAncestor)
 		{
-			if (DiffData.GetDiffType() == EDiffType::Add)
+			// 先祖と一緒に反映される (先祖を反映しない側の変更は失われるので知らせる)
+			if ((DiffData.IsLeftUpdate() && !ReplacedAncestor->IsLeftUpdate()) || (DiffData.IsRightUpdate() && !ReplacedAncestor->IsRightUpdate()))
 			{
-				// ノードが見つからない場合は何もしない
-				if (!LeftNode && !RightNode)
-				{
-					continue;
-				}
-
-				USCS_Node* UpdateNode = LeftNode ? LeftNode : RightNode;;
-				USCS_Node* NewNode = DuplicateObject(UpdateNode, InOutMergedBlueprint->SimpleConstructionScript);
-				NewNode->ComponentTemplate = DuplicateObject(UpdateNode->ComponentTemplate, InOutMergedBlueprint->SimpleConstructionScript->GetOwnerClass());
-				NewNode->ChildNodes.Empty();
-
-				if (USCS_Node* ParentNode = UpdateNode->GetSCS()->FindParentNode(UpdateNode))
-				{
-					InOutMergedBlueprint->SimpleConstructionScript->FindSCSNode(ParentNode->GetVariableName())->AddChildNode(NewNode);
-				}
+				UE_LOG(LogTemp, Warning, TEXT("Nested graph change is overwritten by its parent graph. Path[%s]"), *FBlueprintMergePathTable::PathToString(Path));
 			}
+			continue;
 		}
-		else if (DiffData.GetDiffType() == EDiffType::Remove)
+
+		if (Depth > 0)
 		{
-			// Removeは処理しない
+			NestedDiffs.Emplace(Depth, &Pair);
+			continue;
 		}
+
+		ApplyGraphDiff(Path, DiffData, MergedCursor.SeekRef(Path), false);
 	}
 
-	TArray<UActorComponent*> NewComponents = GetNewComponents(BaseComponents, LeftComponents);
-	NewComponents.Append(GetNewComponents(BaseComponents, RightComponents));
-	FKismetEditorUtilities::CompileBlueprint(InOutMergedBlueprint);
+	NestedDiffs.StableSort([](const TPair<int32, const TPair<FName, FDiffData>*>& A, const TPair<int32, const TPair<FName, FDiffData>*>& B)
+	{
+		return A.Key < B.Key;
+	});
+
+	int32 MapDepth = 0;
+	for (const TPair<int32, const TPair<FName, FDiffData>*>& Nested : NestedDiffs)
+	{
+		if (Nested.Key != MapDepth)
+		{
+			MergedGraphMap = BuildGraphMap(InOutMergedBlueprint, Type);
+			MapDepth = Nested.Key;
+		}
+
+		ApplyGraphDiff(Nested.Value->Key, Nested.Value->Value, FindGraph(MergedGraphMap, Nested.Value->Key), true);
+	}
+	return bChanged;
 }
 
-void UBlueprintMergeLibrary::MergeFunctionGraphs(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, UBlueprint* InOutMergedBlueprint, EGraphType Type)
+void UBlueprintMergeLibrary::ReplaceNestedGraph(UEdGraph* MergedGraph, UEdGraph* SourceGraph)
 {
-	if (!Base || !Left || !Right || !InOutMergedBlueprint)
+	// 持ち主 (合成ノードなど) と名前はそのままに、中身を複製し直す
+	UObject* Owner = MergedGraph->GetOuter();
+	UEdGraph* ParentGraph = MergedGraph->GetTypedOuter<UEdGraph>();
+	const FName GraphName = MergedGraph->GetFName();
+
+	const FName DiscardedName = MakeUniqueObjectName(GetTransientPackage(), MergedGraph->GetClass(), GraphName);
+	MergedGraph->Rename(*DiscardedName.ToString(), GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional | REN_DoNotDirty);
+	UEdGraph* NewGraph = DuplicateObject(SourceGraph, Owner, GraphName);
+
+	// 親のグラフの SubGraphs と、持ち主のノードからの参照を付け替える
+	if (ParentGraph)
 	{
-		return;
+		TMap<UEdGraph*, UEdGraph*> ReplacementMap;
+		ReplacementMap.Add(MergedGraph, NewGraph);
+		FArchiveReplaceObjectRef<UEdGraph> ReplaceAr(ParentGraph, ReplacementMap, EArchiveReplaceObjectFlags::IgnoreOuterRef | EArchiveReplaceObjectFlags::IgnoreArchetypeRef);
 	}
 
-	TMap<FName, UEdGraph*> BaseGraphMap = BuildGraphMap(Base, Type);
-	TMap<FName, UEdGraph*> LeftGraphMap = BuildGraphMap(Left, Type);
-	TMap<FName, UEdGraph*> RightGraphMap = BuildGraphMap(Right, Type);
-	TMap<FName, UEdGraph*> MergedGraphMap = BuildGraphMap(InOutMergedBlueprint, Type);
+	MergedGraph->MarkAsGarbage();
+}
+
+UBlueprintMergeLibrary::FDiffData UBlueprintMergeLibrary::MakeDiffData(const FName& Path, const BlueprintMerge::Core::FDecision& Decision, bool bInLeft, bool bInRight, bool bPresenceFlags)
+{
+	using BlueprintMerge::Core::EChange;
 
-	// キーを統合する
-	TSet<FName> UnionKeys;
+	switch (Decision.Change)
 	{
-		TSet<FName> Keys;
-		BaseGraphMap.GetKeys(Keys);
-		UnionKeys = UnionKeys.Union(Keys);
+	case EChange::Add:
+		return FDiffData(Path, EDiffType::Add, Decision.bLeftChanged, Decision.bRightChanged);
+	case EChange::Remove:
+		// プロパティとコンポーネントの削除は、その側に残っているかをフラグにする
+		return bPresenceFlags ?
+			FDiffData(Path, EDiffType::Remove, bInLeft, bInRight) :
+			FDiffData(Path, EDiffType::Remove, Decision.bLeftChanged, Decision.bRightChanged);
+	case EChange::Modify:
+		return FDiffData(Path, EDiffType::Modify, Decision.bLeftChanged, Decision.bRightChanged);
+	default:
+		return FDiffData(Path, EDiffType::None, false, false);
+	}
+}
 
-		LeftGraphMap.GetKeys(Keys);
-		UnionKeys = UnionKeys.Union(Keys);
+bool UBlueprintMergeLibrary::IsNodeMergeSupported(EGraphType Type)
+{
+	return Type == EGraphType::Function || Type == EGraphType::Macro;
+}
 
-		RightGraphMap.GetKeys(Keys);
-		UnionKeys = UnionKeys.Union(Keys);
+bool UBlueprintMergeLibrary::DiffGraphNodes(UEdGraph* BaseGraph, UEdGraph* LeftGraph, UEdGraph* RightGraph, FGraphNodeDiffResult& OutResult)
+{
+	if (!BaseGraph || !LeftGraph || !RightGraph)
+	{
+		return false;
 	}
 
-	TMap<FName, FDiffData> DiffMap;
-	for (const FName& Path : UnionKeys)
+	// グラフ自身の変更はノード単位では反映できない
+	const uint64 BaseGraphHash = FBlueprintGraphHash::HashGraphProperties(BaseGraph);
+	if (FBlueprintGraphHash::HashGraphProperties(LeftGraph) != BaseGraphHash ||
+		FBlueprintGraphHash::HashGraphProperties(RightGraph) != BaseGraphHash)
 	{
-		UEdGraph* BaseGraph = BaseGraphMap.FindRef(Path);
-		UEdGraph* LeftGraph = LeftGraphMap.FindRef(Path);
-		UEdGraph* RightGraph = RightGraphMap.FindRef(Path);
-		const UEdGraph* MergedGraph = MergedGraphMap.FindRef(Path);
+		return false;
+	}
+
+	TArray<FGraphNodeMatch>& Nodes = OutResult.Nodes;
+	Nodes.Reserve(BaseGraph->Nodes.Num());
 
-		EDiffType DiffType = EDiffType::None;
-		bool bIsLeftUpdate = false;
-		bool bIsRightUpdate = false;
+	// NodeGuid と名前でノードを対応付ける (ハッシュ結合)
+	TMap<FGuid, int32, FMergeArenaSetAllocator> NodeIdsByGuid;
+	TMap<FName, int32, FMergeArenaSetAllocator> NodeIdsByName;
+	TMap<const UEdGraphNode*, int32, FMergeArenaSetAllocator> NodeIds;
+	NodeIdsByGuid.Reserve(BaseGraph->Nodes.Num());
+	NodeIdsByName.Reserve(BaseGraph->Nodes.Num());
 
-		if (BaseGraph)
+	auto MatchNodes = [&](UEdGraph* Graph, UEdGraphNode* FGraphNodeMatch::* Side)
+	{
+		for (UEdGraphNode* Node : Graph->Nodes)
 		{
-			TArray<FName> LeftDiffProperties;
-			TArray<FName> RightDiffProperties;
-			if (LeftGraph && !IdenticalGraphs(BaseGraph, LeftGraph, LeftDiffProperties))
+			if (!Node)
+			{
+				continue;
+			}
+
+			// 名前は新しいノードに自動で付くので、両側で別々に追加したノードが同じ名前になることがある
+			// 名前で対応付けるのは NodeGuid がないノードだけにする
+			const int32* FoundId = Node->NodeGuid.IsValid() ? NodeIdsByGuid.Find(Node->NodeGuid) : NodeIdsByName.Find(Node->GetFName());
+
+			int32 NodeId = FoundId ? *FoundId : INDEX_NONE;
+			if (NodeId == INDEX_NONE || Nodes[NodeId].*Side)
 			{
-				DiffType = EDiffType::Modify;
-				bIsLeftUpdate = true;
+				NodeId = Nodes.AddDefaulted();
+				if (Node->NodeGuid.IsValid())
+				{
+					NodeIdsByGuid.Add(Node->NodeGuid, NodeId);
+				}
+				NodeIdsByName.Add(Node->GetFName(), NodeId);
 			}
 
-			if (RightGraph && !IdenticalGraphs(BaseGraph, RightGraph, RightDiffProperties))
-			{
-				DiffType = EDiffType::Modify;
-				bIsRightUpdate = true;
-			}
+			Nodes[NodeId].*Side = Node;
+			NodeIds.Add(Node, NodeId);
+		}
+	};
+
+	MatchNodes(BaseGraph, &FGraphNodeMatch::BaseNode);
+	MatchNodes(LeftGraph, &FGraphNodeMatch::LeftNode);
+	MatchNodes(RightGraph, &FGraphNodeMatch::RightNode);
+
+	bool bHasConflict = false;
+
+	// マージ後に存在するノードと、複製し直すノード
+	TBitArray<> AliveNodes(false, Nodes.Num());
+	TBitArray<> RecreatedNodes(false, Nodes.Num());
+
+	// マージ後のノードの複製元 (Base のままのノードは Base、複製し直すノードは変更した側)
+	TArray<UEdGraphNode*, FMergeArenaAllocator> KeptNodes;
+	KeptNodes.SetNumZeroed(Nodes.Num());
+
+	for (int32 NodeId = 0; NodeId < Nodes.Num(); ++NodeId)
+	{
+		const FGraphNodeMatch& Match = Nodes[NodeId];
+		const uint64 LeftHash = FBlueprintGraphHash::HashNode(Match.LeftNode);
+		const uint64 RightHash = FBlueprintGraphHash::HashNode(Match.RightNode);
+		const uint64 BaseHash = FBlueprintGraphHash::HashNode(Match.BaseNode);
+
+		const BlueprintMerge::Core::FDecision Decision = BlueprintMerge::Core::ClassifyThreeWay(!!Match.BaseNode, !!Match.LeftNode, !!Match.RightNode,
+			[&]() { return LeftHash != BaseHash; },
+			[&]() { return RightHash != BaseHash; },
+			[&]() { return LeftHash == RightHash; });
+
+		AliveNodes[NodeId] = Match.BaseNode != nullptr;
+		KeptNodes[NodeId] = Match.BaseNode;
+		if (!Decision.HasChange())
+		{
+			continue;
+		}
+
+		if (Decision.IsConflict())
+		{
+			const UEdGraphNode* Node = Match.BaseNode ? Match.BaseNode : Match.LeftNode;
+			OutResult.Conflicts.Add(Node->GetFName());
+			bHasConflict = true;
+			continue;
+		}
+
+		const FDiffData DiffData = MakeDiffData(NAME_None, Decision, !!Match.LeftNode, !!Match.RightNode, false);
+		AliveNodes[NodeId] = DiffData.GetDiffType() != EDiffType::Remove;
+		RecreatedNodes[NodeId] = DiffData.GetDiffType() != EDiffType::Remove;
+		KeptNodes[NodeId] = RecreatedNodes[NodeId] ? (DiffData.IsLeftUpdate() ? Match.LeftNode : Match.RightNode) : nullptr;
+		OutResult.NodeDiffs.Emplace(NodeId, DiffData);
+	}
 
-			if (!LeftGraph || !RightGraph)
+	// リンクを出力ピンの側から集める
+	auto CollectLinks = [&NodeIds](UEdGraph* Graph, FGraphLinkSet& OutLinks)
+	{
+		for (UEdGraphNode* Node : Graph->Nodes)
+		{
+			if (!Node)
 			{
-				DiffType = EDiffType::Remove;
-				bIsLeftUpdate |= !LeftGraph;
-				bIsRightUpdate |= !RightGraph;
+				continue;
 			}
 
-			if (bIsLeftUpdate && bIsRightUpdate)
+			const int32 OutputNode = NodeIds.FindChecked(Node);
+			for (UEdGraphPin* Pin : Node->Pins)
 			{
-				TArray<FName> DiffProperties;
-
-				// 両方の変更が等しい場合、片方の変更を反映すればいいので、片方のフラグを下す
-				if (IdenticalGraphs(LeftGraph, RightGraph, DiffProperties))
+				if (!Pin || Pin->Direction != EGPD_Output)
 				{
-					bIsRightUpdate = false;
+					continue;
 				}
-				else
+
+				for (UEdGraphPin* LinkedPin : Pin->LinkedTo)
 				{
-					UE_LOG(LogTemp, Log, TEXT("Conflict!! LeftGraph[%s] RightGraph[%s]"), LeftGraph ? *GetObjectPath(LeftGraph->GetOutermostObject(), LeftGraph, true) : TEXT("nullptr"), RightGraph ? *GetObjectPath(RightGraph->GetOutermostObject(), RightGraph, true) : TEXT("nullptr"));
-					for (const FName& Property : DiffProperties)
+					const int32* InputNode = LinkedPin ? NodeIds.Find(LinkedPin->GetOwningNodeUnchecked()) : nullptr;
+					if (InputNode)
 					{
-						UE_LOG(LogTemp, Log, TEXT("Diff Property: %s"), *Property.ToString());
+						OutLinks.Add(FGraphLinkKey{ OutputNode, Pin->PinName, *InputNode, LinkedPin->PinName });
 					}
 				}
 			}
 		}
-		else
+	};
+
+	FGraphLinkSet BaseLinks;
+	FGraphLinkSet LeftLinks;
+	FGraphLinkSet RightLinks;
+	CollectLinks(BaseGraph, BaseLinks);
+	CollectLinks(LeftGraph, LeftLinks);
+	CollectLinks(RightGraph, RightLinks);
+
+	// 両方に残っているか、どちらかで追加されたリンクがマージ後のリンク
+	FGraphLinkSet MergedLinks;
+	for (const FGraphLinkKey& Link : LeftLinks)
+	{
+		if (RightLinks.Contains(Link) || !BaseLinks.Contains(Link))
 		{
-			if (LeftGraph || RightGraph)
-			{
-				DiffType = EDiffType::Add;
-				bIsLeftUpdate = !!LeftGraph;
-				bIsRightUpdate = !!RightGraph;
-			}
+			MergedLinks.Add(Link);
+		}
+	}
+	for (const FGraphLinkKey& Link : RightLinks)
+	{
+		if (!BaseLinks.Contains(Link))
+		{
+			MergedLinks.Add(Link);
 		}
+	}
 
-		if (!bIsLeftUpdate && !bIsRightUpdate)
+	for (const FGraphLinkKey& Link : MergedLinks)
+	{
+		if (!AliveNodes[Link.OutputNode] || !AliveNodes[Link.InputNode])
 		{
-			// 差分がない場合はスキップ
+			// 片方で削除されたノードに、もう片方でリンクを張っている
+			// 削除されたノードの側のピンを、ノードの名前とピンの名前のパスで示す
+			const bool bOutputRemoved = !AliveNodes[Link.OutputNode];
+			const FGraphNodeMatch& RemovedNode = OutResult.Nodes[bOutputRemoved ? Link.OutputNode : Link.InputNode];
+			const UEdGraphNode* RemovedNodeObject = RemovedNode.BaseNode ? RemovedNode.BaseNode : (RemovedNode.LeftNode ? RemovedNode.LeftNode : RemovedNode.RightNode);
+			OutResult.Conflicts.Add(FBlueprintMergePathTable::MakePath(RemovedNodeObject->GetFName(), bOutputRemoved ? Link.OutputPin : Link.InputPin));
+			bHasConflict = true;
 			continue;
 		}
 
-		DiffMap.Emplace(Path, FDiffData(Path, DiffType, bIsLeftUpdate, bIsRightUpdate));
+		// 複製し直すノードはリンクが外れるので張り直す
+		if (!BaseLinks.Contains(Link) || RecreatedNodes[Link.OutputNode] || RecreatedNodes[Link.InputNode])
+		{
+			// 張り直すピンが、マージ後に残るノードにあるか確かめる
+			// 片側でピンを消したノードに、もう片側でリンクを張っている場合は、リンクを落とさずにコンフリクトにする
+			UEdGraphNode* OutputNode = KeptNodes[Link.OutputNode];
+			UEdGraphNode* InputNode = KeptNodes[Link.InputNode];
+			const bool bHasOutputPin = OutputNode->FindPin(Link.OutputPin, EGPD_Output) != nullptr;
+			const bool bHasInputPin = InputNode->FindPin(Link.InputPin, EGPD_Input) != nullptr;
+			if (!bHasOutputPin || !bHasInputPin)
+			{
+				OutResult.Conflicts.Add(bHasOutputPin ?
+					FBlueprintMergePathTable::MakePath(InputNode->GetFName(), Link.InputPin) :
+					FBlueprintMergePathTable::MakePath(OutputNode->GetFName(), Link.OutputPin));
+				bHasConflict = true;
+				continue;
+			}
+
+			OutResult.AddedLinks.Add(Link);
+		}
 	}
 
-	for (TPair<FName, FDiffData>& Pair : DiffMap)
+	for (const FGraphLinkKey& Link : BaseLinks)
 	{
-		FName Path = Pair.Key;
-		const FDiffData& DiffData = Pair.Value;
+		// 削除や複製し直すノードのリンクは、ノードと一緒に外れる
+		if (!MergedLinks.Contains(Link) &&
+			AliveNodes[Link.OutputNode] && !RecreatedNodes[Link.OutputNode] &&
+			AliveNodes[Link.InputNode] && !RecreatedNodes[Link.InputNode])
+		{
+			OutResult.RemovedLinks.Add(Link);
+		}
+	}
 
-		UEdGraph* LeftGraph = LeftGraphMap.FindRef(Path);
-		UEdGraph* RightGraph = RightGraphMap.FindRef(Path);
-		UEdGraph* MergedGraph = MergedGraphMap.FindRef(Path);
+	return !bHasConflict;
+}
 
-		if (DiffData.IsNoDifference())
+void UBlueprintMergeLibrary::MergeGraphNodes(const FGraphNodeDiffResult& DiffResult, UEdGraph* InOutMergedGraph, UBlueprint* InOutMergedBlueprint)
+{
+	if (!InOutMergedGraph)
+	{
+		return;
+	}
+
+	// マージ先は Base の複製なので、Base のノードと同じ NodeGuid か名前で対応付ける
+	TMap<FGuid, UEdGraphNode*, FMergeArenaSetAllocator> MergedNodesByGuid;
+	TMap<FName, UEdGraphNode*, FMergeArenaSetAllocator> MergedNodesByName;
+	MergedNodesByGuid.Reserve(InOutMergedGraph->Nodes.Num());
+	MergedNodesByName.Reserve(InOutMergedGraph->Nodes.Num());
+	for (UEdGraphNode* Node : InOutMergedGraph->Nodes)
+	{
+		if (!Node)
 		{
-			// 差分がない場合はスキップ
 			continue;
 		}
 
-		if (DiffData.IsLeftUpdate() && DiffData.IsRightUpdate())
+		// NodeGuid がないノードは全て同じキーになるので、名前だけで引く
+		if (Node->NodeGuid.IsValid())
 		{
-			UE_LOG(LogTemp, Log, TEXT("Conflict!! LeftGraph[%s] RightGraph[%s]"), LeftGraph ? *LeftGraph->GetName() : TEXT("nullptr"), RightGraph ? *RightGraph->GetName() : TEXT("nullptr"));
-			// コンフリクト
-			continue;
+			MergedNodesByGuid.Add(Node->NodeGuid, Node);
 		}
+		MergedNodesByName.Add(Node->GetFName(), Node);
+	}
 
-		if (!MergedGraph)
+	TArray<UEdGraphNode*, FMergeArenaAllocator> MergedNodes;
+	MergedNodes.SetNumZeroed(DiffResult.Nodes.Num());
+	for (int32 NodeId = 0; NodeId < DiffResult.Nodes.Num(); ++NodeId)
+	{
+		if (const UEdGraphNode* BaseNode = DiffResult.Nodes[NodeId].BaseNode)
 		{
-			if (DiffData.GetDiffType() == EDiffType::Add)
-			{
-				// ノードが見つからない場合は何もしない
-				if (!LeftGraph && !RightGraph)
-				{
-					continue;
-				}
+			UEdGraphNode* const* MergedNode = BaseNode->NodeGuid.IsValid() ? MergedNodesByGuid.Find(BaseNode->NodeGuid) : MergedNodesByName.Find(BaseNode->GetFName());
+			MergedNodes[NodeId] = MergedNode ? *MergedNode : nullptr;
+		}
+	}
 
-				UEdGraph* UpdateGraph = LeftGraph ? LeftGraph : RightGraph;
-				UEdGraph* NewGraph = DuplicateObject(UpdateGraph, InOutMergedBlueprint);
-				InOutMergedBlueprint->FunctionGraphs.Add(NewGraph);
-			}
+	// ノードを反映
+	for (const TPair<int32, FDiffData>& Pair : DiffResult.NodeDiffs)
+	{
+		const int32 NodeId = Pair.Key;
+		const FDiffData& DiffData = Pair.Value;
+		const FGraphNodeMatch& Match = DiffResult.Nodes[NodeId];
+		UEdGraphNode* UpdatedNode = DiffData.IsLeftUpdate() ? Match.LeftNode : Match.RightNode;
+
+		if (MergedNodes[NodeId])
+		{
+			// 変更されたノードは削除してから複製し直す
+			RemoveGraphNode(MergedNodes[NodeId], InOutMergedBlueprint);
+			MergedNodes[NodeId] = nullptr;
 		}
-		else if (DiffData.GetDiffType() == EDiffType::Remove)
+
+		if (DiffData.GetDiffType() != EDiffType::Remove && UpdatedNode)
 		{
-			FBlueprintEditorUtils::RemoveGraph(InOutMergedBlueprint, MergedGraph);
+			MergedNodes[NodeId] = DuplicateGraphNode(UpdatedNode, InOutMergedGraph);
 		}
-		else if (DiffData.GetDiffType() == EDiffType::Modify)
+	}
+
+	auto FindLinkPins = [&MergedNodes](const FGraphLinkKey& Link, UEdGraphPin*& OutOutputPin, UEdGraphPin*& OutInputPin)
+	{
+		UEdGraphNode* OutputNode = MergedNodes[Link.OutputNode];
+		UEdGraphNode* InputNode = MergedNodes[Link.InputNode];
+		OutOutputPin = OutputNode ? OutputNode->FindPin(Link.OutputPin, EGPD_Output) : nullptr;
+		OutInputPin = InputNode ? InputNode->FindPin(Link.InputPin, EGPD_Input) : nullptr;
+		return OutOutputPin && OutInputPin;
+	};
+
+	// リンクを反映
+	for (const FGraphLinkKey& Link : DiffResult.RemovedLinks)
+	{
+		UEdGraphPin* OutputPin = nullptr;
+		UEdGraphPin* InputPin = nullptr;
+		if (FindLinkPins(Link, OutputPin, InputPin))
 		{
-			FBlueprintEditorUtils::RemoveGraph(InOutMergedBlueprint, MergedGraph);
-			if (DiffData.IsLeftUpdate())
-			{
-				UEdGraph* NewGraph = DuplicateObject(LeftGraph, InOutMergedBlueprint);
-				AddGraphToBlueprint(InOutMergedBlueprint, NewGraph, Type);
-			}
-			else if (DiffData.IsRightUpdate())
-			{
-				UEdGraph* NewGraph = DuplicateObject(RightGraph, InOutMergedBlueprint);
-				AddGraphToBlueprint(InOutMergedBlueprint, NewGraph, Type);
-			}
+			OutputPin->BreakLinkTo(InputPin);
 		}
 	}
+
+	for (const FGraphLinkKey& Link : DiffResult.AddedLinks)
+	{
+		UEdGraphPin* OutputPin = nullptr;
+		UEdGraphPin* InputPin = nullptr;
+		if (!FindLinkPins(Link, OutputPin, InputPin))
+		{
+			// ピンがあることは DiffGraphNodes で確かめているので、ここには来ないはず
+			UE_LOG(LogTemp, Warning, TEXT("Failed to link pins. Graph[%s] Link[%s -> %s]"), *InOutMergedGraph->GetName(), *Link.OutputPin.ToString(), *Link.InputPin.ToString());
+			continue;
+		}
+
+		if (!OutputPin->LinkedTo.Contains(InputPin))
+		{
+			OutputPin->MakeLinkTo(InputPin);
+		}
+	}
+}
+
+UEdGraphNode* UBlueprintMergeLibrary::DuplicateGraphNode(UEdGraphNode* SourceNode, UEdGraph* Graph)
+{
+	// 名前が使われている場合は自動で付ける
+	const FName NodeName = StaticFindObjectFast(nullptr, Graph, SourceNode->GetFName()) ? NAME_None : SourceNode->GetFName();
+	BLUEPRINT_MERGE_COUNTER_ADD(ObjectsDuplicated, 1);
+	UEdGraphNode* NewNode = DuplicateObject(SourceNode, Graph, NodeName);
+
+	// 複製元のグラフのピンへのリンクが残っているので外す (相手側のピンは変更しない)
+	for (UEdGraphPin* Pin : NewNode->Pins)
+	{
+		Pin->LinkedTo.Reset();
+	}
+
+	Graph->AddNode(NewNode, false, false);
+	return NewNode;
+}
+
+void UBlueprintMergeLibrary::RemoveGraphNode(UEdGraphNode* Node, UBlueprint* Blueprint)
+{
+	UEdGraph* Graph = Node->GetGraph();
+	FBlueprintEditorUtils::RemoveNode(Blueprint, Node, true);
+
+	// 複製し直すノードが同じ名前を使えるように、グラフの外に移す
+	if (Node->GetOuter() == Graph)
+	{
+		Node->Rename(nullptr, GetTransientPackage(), REN_DontCreateRedirectors | REN_NonTransactional | REN_DoNotDirty);
+	}
 }
 
 bool UBlueprintMergeLibrary::IdenticalGraphs(UEdGraph* LeftGraph, UEdGraph* RightGraph, TArray<FName>& OutConflictProperties)
@@ -921,181 +3048,242 @@ bool UBlueprintMergeLibrary::IdenticalGraphs(UEdGraph* LeftGraph, UEdGraph* Righ
 
 	OutConflictProperties.Empty();
 
-	TMap<FName, FPropertyData> LeftPropertyMap = BuildPropertyMap(LeftGraph);
-	TMap<FName, FPropertyData> RightPropertyMap = BuildPropertyMap(RightGraph);
+	// 内容のハッシュが一致すれば、プロパティやノードを比較しなくてよい
+	if (FBlueprintGraphHash::HashGraph(LeftGraph) == FBlueprintGraphHash::HashGraph(RightGraph))
+	{
+		return true;
+	}
+
+	// ここから先は、差分の内容を調べるための比較
+	FPropertyMap LeftPropertyMap = BuildPropertyMap(LeftGraph);
+	FPropertyMap RightPropertyMap = BuildPropertyMap(RightGraph);
 
-	// キーを統合する
+	// 差分があるかチェック
+	const bool bIdenticalProperties = BlueprintMerge::TwoWayJoin(LeftPropertyMap, RightPropertyMap,
+		[LeftGraph, RightGraph, &OutConflictProperties](const FName& PropertyPath, const FPropertyData* LeftPropertyData, const FPropertyData* RightPropertyData)
 	{
-		TSet<FName> UnionKeys;
+		if (FBlueprintMergePathTable::PathContains(PropertyPath, TEXT("GUID")))
 		{
-			TSet<FName> Keys;
-			LeftPropertyMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
-
-			RightPropertyMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
+			// GUIDは自動生成されるため比較しない
+			return true;
 		}
 
-		// 差分があるかチェック
-		for (const FName& PropertyPath : UnionKeys)
+		if (LeftPropertyData && RightPropertyData)
 		{
-			const FPropertyData* LeftPropertyData = LeftPropertyMap.Find(PropertyPath);
-			const FPropertyData* RightPropertyData = RightPropertyMap.Find(PropertyPath);
-
-			if (PropertyPath.ToString().ToUpper().Contains(TEXT("GUID")))
-			{
-				// GUIDは自動生成されるため比較しない
-				continue;
-			}
-
-			if (LeftPropertyData && RightPropertyData)
-			{
-				if (!IdenticalProperties(LeftGraph->GetOutermostObject(), *LeftPropertyData, RightGraph->GetOutermostObject(), *RightPropertyData))
-				{
-					OutConflictProperties.Emplace(PropertyPath);
-					return false;
-				}
-			}
-			else if (!LeftPropertyData || !RightPropertyData)
+			if (!IdenticalProperties(LeftGraph->GetOutermostObject(), *LeftPropertyData, RightGraph->GetOutermostObject(), *RightPropertyData))
 			{
+				OutConflictProperties.Emplace(PropertyPath);
 				return false;
 			}
+			return true;
 		}
+		return false;
+	});
+
+	if (!bIdenticalProperties)
+	{
+		return false;
 	}
 
 	// グラフが等しかったので、ノードを比較
-	TMap<FName, UEdGraphNode*> LeftNodeMap = BuildGraphNodesMap(LeftGraph);
-	TMap<FName, UEdGraphNode*> RightNodeMap = BuildGraphNodesMap(RightGraph);
+	FGraphNodeMap LeftNodeMap = BuildGraphNodesMap(LeftGraph);
+	FGraphNodeMap RightNodeMap = BuildGraphNodesMap(RightGraph);
+	BlueprintMerge::TwoWayJoin(LeftNodeMap, RightNodeMap,
+		[LeftGraph, RightGraph, &OutConflictProperties](const FName& NodePath, UEdGraphNode* const* LeftNode, UEdGraphNode* const* RightNode)
 	{
-		TSet<FName> UnionKeys;
+		if (!LeftNode || !RightNode || !IdenticalNodes(LeftGraph, *LeftNode, RightGraph, *RightNode))
 		{
-			TSet<FName> Keys;
-			LeftNodeMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
-
-			RightNodeMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
+			OutConflictProperties.Emplace(NodePath);
 		}
+		return true;
+	});
 
-		for (const FName& NodePath : UnionKeys)
-		{
-			UEdGraphNode* LeftNode = LeftNodeMap.FindRef(NodePath);
-			UEdGraphNode* RightNode = RightNodeMap.FindRef(NodePath);
+	// ハッシュが異なるので、比較で差分が見つからなくても等しくない
+	return false;
+}
 
-			if (LeftNode && RightNode)
-			{
-				if (!IdenticalNodes(LeftGraph, LeftNode, RightGraph,  RightNode))
-				{
-					return false;
-				}
-			}
-			else if (!LeftNode || !RightNode)
+bool UBlueprintMergeLibrary::IdenticalNodes(UEdGraph* LeftGraph, UEdGraphNode* LeftNode, UEdGraph* RightGraph, UEdGraphNode* RightNode)
+{
+	if (!LeftNode || !RightNode)
+	{
+		return false;
+	}
+
+	FPropertyMap LeftPropertyMap = BuildPropertyMap(LeftNode);
+	FPropertyMap RightPropertyMap = BuildPropertyMap(RightNode);
+
+	// ノードプロパティを比較
+	const bool bIdenticalProperties = BlueprintMerge::TwoWayJoin(LeftPropertyMap, RightPropertyMap,
+		[](const FName& PropertyPath, const FPropertyData* LeftPropertyData, const FPropertyData* RightPropertyData)
+	{
+		if (LeftPropertyData && RightPropertyData)
+		{
+			// 除外するプロパティ
+			if (FBlueprintMergePathTable::PathContains(PropertyPath, TEXT("GUID")))
 			{
-				return false;
+				// GUIDは自動生成されるため比較しない
+				return true;
 			}
+
+			BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
+			return LeftPropertyData->Property->Identical(LeftPropertyData->Container, RightPropertyData->Container);
 		}
+		return false;
+	});
+
+	if (!bIdenticalProperties)
+	{
+		return false;
 	}
 
-	return true;
+	// ノードが等しかったので、ピンを比較
+	FGraphPinMap LeftPinsMap = BuildGraphPinsMap(LeftNode);
+	FGraphPinMap RightPinsMap = BuildGraphPinsMap(RightNode);
+	return BlueprintMerge::TwoWayJoin(LeftPinsMap, RightPinsMap,
+		[](const FName& PinName, UEdGraphPin* const* LeftPin, UEdGraphPin* const* RightPin)
+	{
+		if (LeftPin && RightPin)
+		{
+			return IdenticalPins(*LeftPin, *RightPin);
+		}
+		return false;
+	});
 }
 
-bool UBlueprintMergeLibrary::IdenticalNodes(UEdGraph* LeftGraph, UEdGraphNode* LeftNode, UEdGraph* RightGraph, UEdGraphNode* RightNode)
+bool UBlueprintMergeLibrary::IdenticalPins(UEdGraphPin* LeftPin, UEdGraphPin* RightPin)
 {
-	if (!LeftNode || !RightNode)
+	if (!LeftPin || !RightPin)
+	{
+		return false;
+	}
+
+	if (LeftPin->Direction != RightPin->Direction)
 	{
 		return false;
 	}
 
-	TMap<FName, FPropertyData> LeftPropertyMap = BuildPropertyMap(LeftNode);
-	TMap<FName, FPropertyData> RightPropertyMap = BuildPropertyMap(RightNode);
+	UEdGraphNode* LeftNode = LeftPin->GetOwningNodeUnchecked();
+	UEdGraphNode* RightNode = RightPin->GetOwningNodeUnchecked();
+	UObject* LeftRootObject = LeftNode ? LeftNode->GetOutermostObject() : nullptr;
+	UObject* RightRootObject = RightNode ? RightNode->GetOutermostObject() : nullptr;
 
-	// キーを統合する
+	if (!IdenticalPinTypes(LeftRootObject, LeftPin->PinType, RightRootObject, RightPin->PinType))
 	{
-		TSet<FName> UnionKeys;
-		{
-			TSet<FName> Keys;
-			LeftPropertyMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
+		return false;
+	}
 
-			RightPropertyMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
-		}
+	// 既定値 (文字列は大文字小文字を区別する)
+	if (!LeftPin->DefaultValue.Equals(RightPin->DefaultValue, ESearchCase::CaseSensitive) ||
+		!IdenticalObjectReferences(LeftRootObject, LeftPin->DefaultObject, RightRootObject, RightPin->DefaultObject) ||
+		!IdenticalTexts(LeftPin->DefaultTextValue, RightPin->DefaultTextValue))
+	{
+		return false;
+	}
 
-		// ノードプロパティを比較
-		for (const FName& PropertyPath : UnionKeys)
-		{
-			const FPropertyData* LeftPropertyData = LeftPropertyMap.Find(PropertyPath);
-			const FPropertyData* RightPropertyData = RightPropertyMap.Find(PropertyPath);
+	return IdenticalPinLinks(LeftPin, RightPin);
+}
 
-			if (LeftPropertyData && RightPropertyData)
-			{
-				// 除外するプロパティ
-				if (PropertyPath.ToString().ToUpper().Contains(TEXT("GUID")))
-				{
-					// GUIDは自動生成されるため比較しない
-					continue;
-				}
+bool UBlueprintMergeLibrary::IdenticalTexts(const FText& Left, const FText& Right)
+{
+	if (Left.IdenticalTo(Right))
+	{
+		return true;
+	}
 
-				if (!LeftPropertyData->Property->Identical(LeftPropertyData->Container, RightPropertyData->Container))
-				{
-					OutputPropertyValues(*LeftPropertyData, FString::Printf(TEXT("Context[%s] Left"), *GetObjectPath(LeftGraph->GetOutermostObject(), LeftGraph, true)));
-					OutputPropertyValues(*RightPropertyData, FString::Printf(TEXT("Context[%s] Right"), *GetObjectPath(RightGraph->GetOutermostObject(), RightGraph, true)));
-					return false;
-				}
-			}
-			else if (!LeftPropertyData || !RightPropertyData)
-			{
-				return false;
-			}
-		}
+	// 表示用の文字列はカルチャで変わるので、ソースの文字列とローカライズの名前空間・キーで比べる
+	const FString* LeftSource = FTextInspector::GetSourceString(Left);
+	const FString* RightSource = FTextInspector::GetSourceString(Right);
+	if (!LeftSource || !RightSource)
+	{
+		return LeftSource == RightSource;
 	}
 
-	// ノードが等しかったので、ピンを比較
-	TMap<FName, UEdGraphPin*> LeftPinsMap = BuildGraphPinsMap(LeftNode);
-	TMap<FName, UEdGraphPin*> RightPinsMap = BuildGraphPinsMap(RightNode);
+	return Left.IsCultureInvariant() == Right.IsCultureInvariant() &&
+		LeftSource->Equals(*RightSource, ESearchCase::CaseSensitive) &&
+		FTextInspector::GetNamespace(Left).Get(FString()).Equals(FTextInspector::GetNamespace(Right).Get(FString()), ESearchCase::CaseSensitive) &&
+		FTextInspector::GetKey(Left).Get(FString()).Equals(FTextInspector::GetKey(Right).Get(FString()), ESearchCase::CaseSensitive);
+}
+
+bool UBlueprintMergeLibrary::IdenticalPinTypes(UObject* LeftRootObject, const FEdGraphPinType& Left, UObject* RightRootObject, const FEdGraphPinType& Right)
+{
+	// FEdGraphPinType::operator== はオブジェクトをポインタで比較するので、個別に比較する
+	return Left.PinCategory == Right.PinCategory &&
+		Left.PinSubCategory == Right.PinSubCategory &&
+		Left.ContainerType == Right.ContainerType &&
+		Left.bIsReference == Right.bIsReference &&
+		Left.bIsConst == Right.bIsConst &&
+		Left.bIsWeakPointer == Right.bIsWeakPointer &&
+		Left.PinValueType.TerminalCategory == Right.PinValueType.TerminalCategory &&
+		Left.PinValueType.TerminalSubCategory == Right.PinValueType.TerminalSubCategory &&
+		IdenticalObjectReferences(LeftRootObject, Left.PinSubCategoryObject.Get(), RightRootObject, Right.PinSubCategoryObject.Get()) &&
+		IdenticalObjectReferences(LeftRootObject, Left.PinValueType.TerminalSubCategoryObject.Get(), RightRootObject, Right.PinValueType.TerminalSubCategoryObject.Get());
+}
+
+bool UBlueprintMergeLibrary::IdenticalPinLinks(const UEdGraphPin* LeftPin, const UEdGraphPin* RightPin)
+{
+	const int32 NumLinks = LeftPin->LinkedTo.Num();
+	if (NumLinks != RightPin->LinkedTo.Num())
 	{
-		// キーを統合する
-		TSet<FName> UnionKeys;
-		{
-			TSet<FName> Keys;
-			LeftPinsMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
+		return false;
+	}
 
-			RightPinsMap.GetKeys(Keys);
-			UnionKeys = UnionKeys.Union(Keys);
+	if (NumLinks == 0)
+	{
+		return true;
+	}
 
-		}
+	if (NumLinks == 1)
+	{
+		return MakePinEndpoint(LeftPin->LinkedTo[0]) == MakePinEndpoint(RightPin->LinkedTo[0]);
+	}
 
-		// 差分があるかチェック
-		for (const FName& PinName : UnionKeys)
-		{
-			UEdGraphPin* LeftPin = LeftPinsMap.FindRef(PinName);
-			UEdGraphPin* RightPin = RightPinsMap.FindRef(PinName);
+	// リンク先の並び順は比較しない (同じリンク先が重複することはない)
+	TSet<FGraphPinEndpoint, DefaultKeyFuncs<FGraphPinEndpoint>, FMergeArenaSetAllocator> LeftEndpoints;
+	LeftEndpoints.Reserve(NumLinks);
+	for (const UEdGraphPin* LinkedPin : LeftPin->LinkedTo)
+	{
+		LeftEndpoints.Add(MakePinEndpoint(LinkedPin));
+	}
 
-			if (LeftPin && RightPin)
-			{
-				if (!IdenticalPins(LeftPin, RightPin))
-				{
-					return false;
-				}
-			}
-			else if (!LeftPin || !RightPin)
-			{
-				return false;
-			}
+	for (const UEdGraphPin* LinkedPin : RightPin->LinkedTo)
+	{
+		if (!LeftEndpoints.Contains(MakePinEndpoint(LinkedPin)))
+		{
+			return false;
 		}
 	}
 	return true;
 }
 
-bool UBlueprintMergeLibrary::IdenticalPins(UEdGraphPin* LeftPin, UEdGraphPin* RightPin)
+UBlueprintMergeLibrary::FGraphPinEndpoint UBlueprintMergeLibrary::MakePinEndpoint(const UEdGraphPin* Pin)
 {
-	if (!LeftPin || !RightPin)
+	if (!Pin)
 	{
-		return false;
+		return FGraphPinEndpoint();
 	}
 
-	return true;
+	const UEdGraphNode* Node = Pin->GetOwningNodeUnchecked();
+	return FGraphPinEndpoint{ Node ? Node->GetFName() : NAME_None, Pin->PinName };
+}
+
+bool UBlueprintMergeLibrary::IdenticalObjectReferences(UObject* LeftRootObject, UObject* LeftObject, UObject* RightRootObject, UObject* RightObject)
+{
+	if (!LeftObject || !RightObject)
+	{
+		// 両方 nullptr の場合は等しい
+		return LeftObject == RightObject;
+	}
+
+	UObject* LeftOuterMost = LeftObject->GetOutermostObject();
+	UObject* RightOuterMost = RightObject->GetOutermostObject();
+	if (LeftRootObject && RightRootObject && (LeftOuterMost == LeftRootObject) && (RightOuterMost == RightRootObject))
+	{
+		// 同じテーブルのキーなので、整数の比較で済む
+		const FName LeftObjectPath = GetObjectPath(LeftRootObject, LeftObject);
+		const FName RightObjectPath = GetObjectPath(RightRootObject, RightObject);
+		return LeftObjectPath == RightObjectPath;
+	}
+	return LeftObject == RightObject;
 }
 
 bool UBlueprintMergeLibrary::IdenticalProperties(UObject* LeftRootObject, const FPropertyData& Left, UObject* RightRootObject, const FPropertyData& Right)
@@ -1112,24 +3300,7 @@ bool UBlueprintMergeLibrary::IdenticalProperties(UObject* LeftRootObject, const
 
 		UObject* LeftObject = LeftObjectProperty->GetObjectPropertyValue(Left.Container);
 		UObject* RightObject = RightObjectProperty->GetObjectPropertyValue(Right.Container);
-
-		UObject* LeftOuterMost = LeftObject->GetOutermostObject();
-		UObject* RightOuterMost = RightObject->GetOutermostObject();
-
-		if (LeftObject && RightObject)
-		{
-			if ((LeftOuterMost == LeftRootObject) && (RightOuterMost == RightRootObject))
-			{
-				FString LeftObjectPath = GetObjectPath(LeftRootObject, LeftObject);
-				FString RightObjectPath = GetObjectPath(RightRootObject, RightObject);
-				return LeftObjectPath == RightObjectPath;
-			}
-			return LeftObject == RightObject;
-		}
-		else if (!LeftObject || !RightObject)
-		{
-			return false;
-		}
+		return IdenticalObjectReferences(LeftRootObject, LeftObject, RightRootObject, RightObject);
 	}
 	else if (Left.Property->IsA<FArrayProperty>())
 	{
@@ -1142,34 +3313,6 @@ bool UBlueprintMergeLibrary::IdenticalProperties(UObject* LeftRootObject, const
 		int32 LeftNum = LeftArrayHelper.Num();
 		int32 RightNum = RightArrayHelper.Num();
 
-		for (int32 Index = 0; Index < LeftArrayHelper.Num(); ++Index)
-		{
-			if (const FObjectProperty* LeftObjectProperty = CastField<FObjectProperty>(LeftArrayProperty->Inner))
-			{
-				UObject* LeftObject = LeftObjectProperty->GetObjectPropertyValue(LeftArrayHelper.GetRawPtr(Index));
-				UObject* LeftOuterMost = LeftObject->GetOutermostObject();
-				if (LeftOuterMost == LeftRootObject)
-				{
-					FString LeftObjectPath = GetObjectPath(LeftRootObject, LeftObject);
-					UE_LOG(LogTemp, Log, TEXT("Index[%d] Name[%s]"), Index, *LeftObjectPath);
-				}
-			}
-		}
-
-		for (int32 Index = 0; Index < RightArrayHelper.Num(); ++Index)
-		{
-			if (const FObjectProperty* RightObjectProperty = CastField<FObjectProperty>(RightArrayProperty->Inner))
-			{
-				UObject* RightObject = RightObjectProperty->GetObjectPropertyValue(RightArrayHelper.GetRawPtr(Index));
-				UObject* RightOuterMost = RightObject->GetOutermostObject();
-				if (RightOuterMost == RightRootObject)
-				{
-					FString RightObjectPath = GetObjectPath(RightRootObject, RightObject);
-					UE_LOG(LogTemp, Log, TEXT("Index[%d] Name[%s]"), Index, *RightObjectPath);
-				}
-			}
-		}
-
 		if (LeftNum != RightNum)
 		{
 			return false;
@@ -1185,22 +3328,20 @@ bool UBlueprintMergeLibrary::IdenticalProperties(UObject* LeftRootObject, const
 	}
 	else
 	{
+		BLUEPRINT_MERGE_COUNTER_ADD(IdenticalCalls, 1);
 		if (!Left.Property->Identical(Left.Container, Right.Container))
 		{
-			OutputPropertyValues(Left, TEXT("Diff Left"));
-			OutputPropertyValues(Right, TEXT("Diff Right"));
 			return false;
 		}
 	}
 	return true;
 }
 
-void UBlueprintMergeLibrary::OutputPropertyValues(const FPropertyData& PropertyData, const FString& ContextString)
+FString UBlueprintMergeLibrary::ExportPropertyValue(const FPropertyData& PropertyData)
 {
-	// プロパティを文字列化
 	FString PropertyString;
-	PropertyData.Property->ExportTextItem_Direct(PropertyString, PropertyData.Container, PropertyData.Container, nullptr, PPF_None);
-	UE_LOG(LogTemp, Log, TEXT("%s : Property[%s] Value[%s]"), *ContextString, *PropertyData.Property->GetName(), *PropertyString);
+	PropertyData.Property->ExportTextItem_Direct(PropertyString, PropertyData.Container, nullptr, nullptr, PPF_None);
+	return PropertyString;
 }
 
 void UBlueprintMergeLibrary::AddGraphToBlueprint(UBlueprint* Blueprint, UEdGraph* Graph, EGraphType Type)
@@ -1233,5 +3374,3 @@ void UBlueprintMergeLibrary::AddGraphToBlueprint(UBlueprint* Blueprint, UEdGraph
 }
 
 
-
-UE_ENABLE_OPTIMIZATION
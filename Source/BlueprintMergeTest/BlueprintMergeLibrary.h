@@ -4,8 +4,119 @@
 
 #include "CoreMinimal.h"
 #include "Kismet/BlueprintFunctionLibrary.h"
+#include "BlueprintMergeJoin.h"
+#include "BlueprintMergeCore.h"
+#include "BlueprintMergeSequence.h"
+#include "BlueprintMergePath.h"
 #include "BlueprintMergeLibrary.generated.h"
 
+class UBlueprint;
+class FBlueprintMergeReport;
+class FBlueprintPropertySchema;
+struct FEdGraphPinType;
+
+// 一括マージの要求
+USTRUCT(BlueprintType)
+struct FBlueprintMergeRequest
+{
+	GENERATED_BODY()
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<UBlueprint> Base = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<UBlueprint> Left = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	TObjectPtr<UBlueprint> Right = nullptr;
+
+	UPROPERTY(EditAnywhere, BlueprintReadWrite)
+	FString OutputName;
+};
+
+// ファイルのマージ結果
+UENUM(BlueprintType)
+enum class EBlueprintMergeResult : uint8
+{
+	Clean,
+	Conflict,
+	Error,
+};
+
+// マージ計画の対象
+UENUM(BlueprintType)
+enum class EBlueprintMergePlanCategory : uint8
+{
+	Property,
+	Component,
+	ComponentProperty,
+	Graph,
+	GraphNode,
+};
+
+// マージ計画の操作
+UENUM(BlueprintType)
+enum class EBlueprintMergePlanAction : uint8
+{
+	Add,
+	Remove,
+	Modify,
+	Conflict,
+};
+
+// 変更を反映する側
+UENUM(BlueprintType)
+enum class EBlueprintMergePlanSide : uint8
+{
+	Left,
+	Right,
+	Both,
+};
+
+// マージ計画の 1 項目
+USTRUCT(BlueprintType)
+struct FBlueprintMergePlanEntry
+{
+	GENERATED_BODY()
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	EBlueprintMergePlanCategory Category = EBlueprintMergePlanCategory::Property;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FString Path;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	EBlueprintMergePlanAction Action = EBlueprintMergePlanAction::Modify;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	EBlueprintMergePlanSide Side = EBlueprintMergePlanSide::Left;
+};
+
+// アセットを作らずに解析したマージ計画
+USTRUCT(BlueprintType)
+struct FBlueprintMergePlan
+{
+	GENERATED_BODY()
+
+	// 入力が正しく、解析できたか
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	bool bIsValid = false;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	FString OutputName;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	TArray<FBlueprintMergePlanEntry> Entries;
+
+	UPROPERTY(VisibleAnywhere, BlueprintReadOnly)
+	int32 NumConflicts = 0;
+
+	// コンフリクトなしでマージできるか
+	bool IsClean() const
+	{
+		return bIsValid && NumConflicts == 0;
+	}
+};
 
 /**
  * 
@@ -20,19 +131,50 @@ public:
 	UFUNCTION(BlueprintCallable)
 	static void MergeBlueprint(UObject* WorldContextObject, UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, const FString& OutputName);
 
-private:
+	// 複数のブループリントをまとめてマージする
+	// 差分の解析はワーカースレッドで並列に行い、アセットの変更とコンパイルはゲームスレッドで順番に行う
+	UFUNCTION(BlueprintCallable)
+	static void MergeBlueprintBatch(UObject* WorldContextObject, const TArray<FBlueprintMergeRequest>& Requests);
 
+	// マージ計画を作る
+	// 差分とコンフリクトを解析するだけで、アセットの作成・削除やコンパイルは行わない
+	UFUNCTION(BlueprintCallable)
+	static FBlueprintMergePlan PlanBlueprintMerge(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right);
+
+	// 複数のマージ計画をまとめて作る (結果は要求と同じ順番)
+	UFUNCTION(BlueprintCallable)
+	static TArray<FBlueprintMergePlan> PlanBlueprintMergeBatch(const TArray<FBlueprintMergeRequest>& Requests);
 
+	// .uasset ファイルをマージして、OutputFilename に保存する
+	// OutputPackageName は元のアセットのパッケージ名 (/Game/...)、空の場合は一時的なパッケージ名で保存する
+	// コンフリクトがある場合は保存しない
+	UFUNCTION(BlueprintCallable)
+	static EBlueprintMergeResult MergeBlueprintFiles(const FString& BaseFilename, const FString& LeftFilename, const FString& RightFilename, const FString& OutputFilename, const FString& OutputPackageName, FBlueprintMergePlan& OutPlan);
+
+	// 差分とコンフリクトのレポートを JSON Lines で書き出し始める
+	// EndMergeReport を呼ぶまでの全てのマージ (計画の作成を含む) がレポートに書き出される
+	// bIncludeValues が true の場合、プロパティの値も書き出す
+	UFUNCTION(BlueprintCallable)
+	static bool BeginMergeReport(const FString& Filename, bool bIncludeValues);
+
+	UFUNCTION(BlueprintCallable)
+	static void EndMergeReport();
+
+private:
 	struct FPropertyData
 	{
-		FPropertyData(const FProperty* InProperty, const void* InContainer)
+		FPropertyData(const FProperty* InProperty, const void* InContainer, int32 InSchemaIndex = INDEX_NONE)
 			: Property(InProperty)
 			, Container(InContainer)
+			, SchemaIndex(InSchemaIndex)
 		{
 		}
 
 		const FProperty* Property;
 		const void* Container;
+
+		// プロパティスキーマのエントリのインデックス (動的なコンテナの要素は INDEX_NONE)
+		int32 SchemaIndex;
 	};
 
 	enum class EDiffType
@@ -42,6 +184,10 @@ private:
 		Remove,
 		Modify,
 		Confilict,
+
+		// 両側の変更を合わせた (配列の要素の並びをマージした)
+		// 両側のフラグが立つが、コンフリクトではない
+		Merge,
 	};
 
 	// プロパティの差分情報
@@ -118,46 +264,445 @@ private:
 		Ubergraph,
 	};
 
+	// キーでソートされたマップ
+	using FPropertyMap = TSortedKeyArray<FPropertyData>;
+	using FDiffMap = TSortedKeyArray<FDiffData>;
+	using FSCSNodeMap = TSortedKeyArray<class USCS_Node*>;
+	using FGraphMap = TSortedKeyArray<class UEdGraph*>;
+	using FGraphNodeMap = TSortedKeyArray<class UEdGraphNode*>;
+	using FGraphPinMap = TSortedKeyArray<class UEdGraphPin*>;
+
+	// ブループリントの全てのグラフ (グラフの種類ごとのマップ)
+	// キーは親のグラフからたどったパス
+	struct FGraphHierarchy
+	{
+		FGraphMap GraphMaps[static_cast<int32>(EGraphType::Ubergraph) + 1];
+
+		FGraphMap& operator[](EGraphType Type)
+		{
+			return GraphMaps[static_cast<int32>(Type)];
+		}
+
+		const FGraphMap& operator[](EGraphType Type) const
+		{
+			return GraphMaps[static_cast<int32>(Type)];
+		}
+	};
+
+	// オブジェクトのプロパティ差分の解析結果
+	// 遅延モードのプロパティマップは、差分のあった部分木のプロパティだけを含む
+	struct FPropertyDiffResult
+	{
+		FPropertyMap BasePropertyMap;
+		FPropertyMap LeftPropertyMap;
+		FPropertyMap RightPropertyMap;
+		FDiffMap DiffPropertyMap;
+
+		// 両側の変更を合わせたコンテナ (差分の種類が Merge の配列 / Map / Set) の要素
+		// 配列は並び順、Map と Set は追加する順に並べる
+		TSortedKeyArray<TArray<BlueprintMerge::Core::FSequenceItem>> ContainerMerges;
+	};
+
+	// コンポーネント差分の解析結果
+	struct FComponentDiffResult
+	{
+		FSCSNodeMap BaseSCSNodeMap;
+		FSCSNodeMap LeftSCSNodeMap;
+		FSCSNodeMap RightSCSNodeMap;
+		FDiffMap DiffMap;
+
+		// 全てに存在するコンポーネントのテンプレートのプロパティ差分
+		TSortedKeyArray<FPropertyDiffResult> TemplateDiffs;
+	};
+
+	// Base / Left / Right で対応付けたノード
+	struct FGraphNodeMatch
+	{
+		class UEdGraphNode* BaseNode = nullptr;
+		class UEdGraphNode* LeftNode = nullptr;
+		class UEdGraphNode* RightNode = nullptr;
+	};
+
+	// ピンのリンク
+	// ノードは FGraphNodeDiffResult::Nodes のインデックス、ピンは名前で表す
+	struct FGraphLinkKey
+	{
+		int32 OutputNode = INDEX_NONE;
+		FName OutputPin;
+		int32 InputNode = INDEX_NONE;
+		FName InputPin;
+
+		bool operator==(const FGraphLinkKey& Other) const
+		{
+			return OutputNode == Other.OutputNode && OutputPin == Other.OutputPin && InputNode == Other.InputNode && InputPin == Other.InputPin;
+		}
+
+		friend uint32 GetTypeHash(const FGraphLinkKey& Key)
+		{
+			return HashCombine(HashCombine(::GetTypeHash(Key.OutputNode), ::GetTypeHash(Key.OutputPin)), HashCombine(::GetTypeHash(Key.InputNode), ::GetTypeHash(Key.InputPin)));
+		}
+	};
+
+	// 解析中に一時的に使うリンクの集合 (アリーナから確保する)
+	using FGraphLinkSet = TSet<FGraphLinkKey, DefaultKeyFuncs<FGraphLinkKey>, FMergeArenaSetAllocator>;
+
+	// リンク先のピン
+	// ノードはグラフの中で名前で対応付けるので、所有するノードの名前とピンの名前で表す
+	struct FGraphPinEndpoint
+	{
+		FName Node;
+		FName Pin;
+
+		bool operator==(const FGraphPinEndpoint& Other) const
+		{
+			return Node == Other.Node && Pin == Other.Pin;
+		}
+
+		friend uint32 GetTypeHash(const FGraphPinEndpoint& Endpoint)
+		{
+			return HashCombine(::GetTypeHash(Endpoint.Node), ::GetTypeHash(Endpoint.Pin));
+		}
+	};
+
+	// ノード単位のマージの解析結果
+	struct FGraphNodeDiffResult
+	{
+		// 対応付けたノード (インデックスをノードの ID として使う)
+		TArray<FGraphNodeMatch> Nodes;
+
+		// 差分のあるノードの ID と差分
+		TArray<TPair<int32, FDiffData>> NodeDiffs;
+
+		// マージ先に追加 / 削除するリンク
+		TArray<FGraphLinkKey> AddedLinks;
+		TArray<FGraphLinkKey> RemovedLinks;
+
+		// コンフリクトしたノードとリンクの名前
+		TArray<FName> Conflicts;
+	};
+
+	// グラフ差分の解析結果
+	struct FGraphDiffResult
+	{
+		EGraphType Type = EGraphType::None;
+		FGraphMap BaseGraphMap;
+		FGraphMap LeftGraphMap;
+		FGraphMap RightGraphMap;
+		FDiffMap DiffMap;
+
+		// ノード単位でマージするグラフ
+		TSortedKeyArray<FGraphNodeDiffResult> NodeDiffs;
+
+		// コンフリクトしたグラフの、差分のあったプロパティ・ノード・リンクの名前
+		TSortedKeyArray<TArray<FName>> ConflictDetails;
+	};
+
+	// 並列に比較するグラフの組
+	struct FGraphComparison
+	{
+		// 結果を反映する FGraphDiffResult の番号
+		int32 ResultIndex = INDEX_NONE;
+		EGraphType Type = EGraphType::None;
+		FName Path;
+		UEdGraph* BaseGraph = nullptr;
+		UEdGraph* LeftGraph = nullptr;
+		UEdGraph* RightGraph = nullptr;
+
+		// 比較の結果
+		BlueprintMerge::Core::FDecision Decision;
+		TArray<FName> DiffProperties;
+
+		// ノード単位の差分 (bNodeMerge が false でもコンフリクトの詳細が入ることがある)
+		bool bNodeMerge = false;
+		FGraphNodeDiffResult NodeDiff;
+	};
+
+	// 解析した時点の入力のブループリント
+	// 一括マージで先に反映したマージが、入力を再インスタンス化したり出力で置き換えたりしていないかを確かめる
+	struct FMergeInputSnapshot
+	{
+		FSoftObjectPath Path;
+		TWeakObjectPtr<UBlueprint> Blueprint;
+		TWeakObjectPtr<UClass> GeneratedClass;
+		TWeakObjectPtr<UObject> DefaultObject;
+	};
+
+	// 1つのマージの解析結果
+	// 読み取りのみで構築されるので、ワーカースレッドで並列に作成できる
+	struct FMergeAnalysis
+	{
+		UBlueprint* Base = nullptr;
+		UBlueprint* Left = nullptr;
+		UBlueprint* Right = nullptr;
+		UObject* BaseDefaultObject = nullptr;
+		UObject* LeftDefaultObject = nullptr;
+		UObject* RightDefaultObject = nullptr;
+		FString OutputName;
+
+		// Base / Left / Right の順
+		FMergeInputSnapshot Inputs[3];
+
+		// 解析とマージの一時的なマップを確保するアリーナ
+		// 解析結果のマップもここから確保するので、解析結果より先に宣言する (破棄は最後になる)
+		TSharedRef<FMergeArena> Arena = MakeShared<FMergeArena>();
+
+		// 差分のキーになるパスのテーブル (解析を移動できるように共有参照で持つ)
+		TSharedRef<FBlueprintMergePathTable> Paths = MakeShared<FBlueprintMergePathTable>();
+
+		FPropertyDiffResult Properties;
+		FComponentDiffResult Components;
+		TArray<FGraphDiffResult> Graphs;
+	};
+
+	// マージ計画の項目をレポートに書き出すための情報 (計画の項目と同じ順番)
+	struct FMergePlanRecordSource
+	{
+		// 値を書き出すプロパティ (値がない項目は nullptr)
+		const FPropertyDiffResult* Values = nullptr;
+		FName Key;
+
+		// コンフリクトの原因になったグラフのプロパティ・ノード・リンク
+		const TArray<FName>* ConflictDetail = nullptr;
+	};
+
+	// 解析の準備をする (ゲームスレッドで呼ぶ)
+	static bool InitializeMergeAnalysis(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, const FString& OutputName, FMergeAnalysis& OutAnalysis);
+
+	// 差分を解析する (読み取り専用なので、ワーカースレッドから呼べる)
+	static void AnalyzeMerge(FMergeAnalysis& InOutAnalysis);
+
+	// 解析した後に、入力のブループリント・生成クラス・CDO が入れ替わっていないか (ゲームスレッドで呼ぶ)
+	static bool IsMergeAnalysisCurrent(const FMergeAnalysis& Analysis);
+
+	// 入力を解析したときのパスから引き直して、解析の準備をやり直す (ゲームスレッドで呼ぶ)
+	static bool ReinitializeMergeAnalysis(const FMergeAnalysis& StaleAnalysis, FMergeAnalysis& OutAnalysis);
+
+	// 差分を解析するグラフの種類
+	static TConstArrayView<EGraphType> GetAnalyzedGraphTypes();
+
+	// ブループリントが持つ全てのグラフの種類 (一致の確認とグラフの階層に使う)
+	static TConstArrayView<EGraphType> GetAllGraphTypes();
+
+	// 解析結果をアセットに反映する (ゲームスレッドで呼ぶ)
+	static void ApplyMerge(const FMergeAnalysis& Analysis);
+
+	// 一時パッケージの Base の複製に、解析結果を反映する
+	static UBlueprint* BuildMergedBlueprint(const FMergeAnalysis& Analysis);
+
+	// ファイルからブループリントを読み込む
+	static UBlueprint* LoadBlueprintFile(const FString& Filename, const FString& OriginalPackageName, const TCHAR* Label);
+
+	// マージ結果をファイルに保存する
+	// 保存したブループリントは、成否にかかわらず次の GC で破棄されるようにする
+	static bool SaveBlueprintFile(UBlueprint* MergedBlueprint, const FString& Filename, const FString& PackageName);
+
+	// パッケージと中のオブジェクトのフラグを外して、次の GC で破棄されるようにする
+	static void UnloadPackage(UPackage* Package);
+
+	// 一時パッケージにブループリントを複製する
+	static UBlueprint* DuplicateToTransientPackage(UBlueprint* Source, const FString& Name);
+
+	// マージ結果を出力先のパッケージに移す
+	// 既存の出力と内容が同じ場合は何もしない
+	// 既存の出力への参照はマージ結果に付け替えてから、既存の出力を破棄する
+	static void CommitMergedBlueprint(UBlueprint* MergedBlueprint, const FString& OutputPackageName);
+
+	// ブループリントを一時パッケージに移して、名前を空ける
+	static void RenameToTransientPackage(UBlueprint* Blueprint);
+
+	// ブループリントを一時パッケージに移して破棄する
+	static void DiscardBlueprint(UBlueprint* Blueprint);
+
+	// ブループリント自身のプロパティ (メンバー変数の定義を含む)・デフォルト値・コンポーネントの階層とテンプレート・グラフの内容が一致するか
+	static bool IdenticalBlueprints(UBlueprint* Left, UBlueprint* Right);
+
+	// 解析結果からマージ計画を作る (読み取り専用なので、ワーカースレッドから呼べる)
+	// OutRecordSources が指定された場合、レポートに書き出すための情報も集める
+	static void BuildMergePlan(const FMergeAnalysis& Analysis, FBlueprintMergePlan& OutPlan, TArray<FMergePlanRecordSource>* OutRecordSources = nullptr);
+
+	// 作ったマージ計画の項目とコンフリクトの詳細をレポートに書き出す (ゲームスレッドで呼ぶ)
+	static void WriteMergeReport(FBlueprintMergeReport& Report, const FMergeAnalysis& Analysis, const FBlueprintMergePlan& Plan, TConstArrayView<FMergePlanRecordSource> RecordSources);
+
+	// レポートが開いていれば、マージ計画を作ってレポートに書き出す (ゲームスレッドで呼ぶ)
+	static void BuildMergePlanWithReport(const FMergeAnalysis& Analysis, FBlueprintMergePlan& OutPlan);
+
+	// bIsLeftUpdate / bIsRightUpdate は変更した側を表す
+	// 追加した項目を返す (差分がない場合は nullptr)
+	static const FBlueprintMergePlanEntry* AddMergePlanEntry(FBlueprintMergePlan& OutPlan, EBlueprintMergePlanCategory Category, const FString& Path, EDiffType DiffType, bool bIsLeftUpdate, bool bIsRightUpdate);
+
+	// 計画の項目をレポートに書き出す
+	// Values が指定され、レポートが値を含む場合は Key のプロパティの値も書き出す
+	static void WriteMergeReportRecord(FBlueprintMergeReport& Report, const FBlueprintMergePlan& Plan, const FBlueprintMergePlanEntry& Entry, const FPropertyDiffResult* Values = nullptr, FName Key = NAME_None);
+
+	// プロパティの差分を解析する
+	// bResolveSameChanges が true の場合、両方の変更が等しければ片方の変更として扱う
+	static void DiffObjectProperties(UObject* Base, UObject* Left, UObject* Right, bool bResolveSameChanges, FPropertyDiffResult& OutResult);
+
+	// 遅延モードの差分の状態
+	struct FLazyPropertyDiffContext
+	{
+		FPropertyDiffResult& Result;
+		bool bResolveSameChanges;
+
+		// オブジェクト参照を相対パスで比べるときの基準
+		UObject* BaseRoot;
+		UObject* LeftRoot;
+		UObject* RightRoot;
+
+		// Base のスキーマのエントリごとの POD の一致
+		const TBitArray<>& LeftIdenticalEntries;
+		const TBitArray<>& RightIdenticalEntries;
+	};
+
+	// スキーマのエントリと、その値のアドレス
+	struct FLazyPropertyValue
+	{
+		const FBlueprintPropertySchema* Schema = nullptr;
+		int32 EntryIndex = INDEX_NONE;
+		const void* Value = nullptr;
+	};
+
+	// 最上位のプロパティから比べ、異なる場合だけ構造体のメンバーやコンテナの要素に降りる
+	// 差分の結果は全てのプロパティを展開した場合と同じになる
+	static void DiffObjectPropertiesLazy(UObject* Base, UObject* Left, UObject* Right, bool bResolveSameChanges, FPropertyDiffResult& OutResult);
+	static void DiffEntryLazy(FLazyPropertyDiffContext& Context, const FName* Prefix, const FLazyPropertyValue& Base, const FLazyPropertyValue& Left, const FLazyPropertyValue& Right);
+	static void DiffElementLazy(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right);
+	static void DiffContainerLazy(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right);
+
+	// 配列の要素の並びを O(ND) の差分で比べ、挿入・削除・移動を合わせた並びを作る
+	// 配列そのものを差分のキーにする
+	// 要素数が同じでコンフリクトした場合や、要素のハッシュを求められない場合など、要素ごとに比べる方がよい場合は false を返す
+	static bool DiffArraySequence(FLazyPropertyDiffContext& Context, const FName& Path, const FArrayProperty* ArrayProperty, const void* Base, const void* Left, const void* Right);
+
+	// Map と Set の要素を、キーのハッシュで Base / Left / Right の間で対応付けて 3-way でマージする
+	// 要素の数に対して線形時間で、ハッシュテーブルの並び順には依存しない
+	// コンテナそのものを差分のキーにする
+	// コンフリクトしたキーは "Container[Key]" のパスで報告して Base の要素を残し、他のキーの変更はマージする
+	static void DiffKeyedContainer(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right);
+
+	// コンテナ単位の差分を追加する
+	// 両側が変更し、コンフリクトしなかった場合は Items の並びを Merge として記録する
+	static void AddContainerDiff(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right,
+		bool bLeftChanged, bool bRightChanged, bool bConflict, TConstArrayView<BlueprintMerge::Core::FSequenceItem> Items);
+
+	// コンテナの要素のハッシュ (IdenticalProperties で等しい要素は同じハッシュになる)
+	// オブジェクト参照は、Root の中のオブジェクトなら相対パス、それ以外はアドレスで求める
+	// 構造体と配列はメンバーや要素のハッシュを合わせる。ハッシュを求められない型は false を返す
+	static bool HashContainerElement(const FProperty* Property, const void* Value, UObject* Root, uint32& OutHash);
+
+	// 部分木を展開して差分を調べる (存在しない側は nullptr)
+	static void DiffExpandedEntries(FLazyPropertyDiffContext& Context, const FName* Prefix, const FLazyPropertyValue* Base, const FLazyPropertyValue* Left, const FLazyPropertyValue* Right);
+	static void DiffExpandedElements(FLazyPropertyDiffContext& Context, const FName& Path, const FProperty* Property, const void* Base, const void* Left, const void* Right);
+	static void DiffPropertyMaps(FLazyPropertyDiffContext& Context, FPropertyMap& BaseMap, FPropertyMap& LeftMap, FPropertyMap& RightMap);
+
+	// 1 つのプロパティの差分を調べて、差分があれば DiffPropertyMap に追加する
+	static void ClassifyPropertyDiff(const FName& PropertyPath, const FPropertyData* BasePropertyData, const FPropertyData* LeftPropertyData, const FPropertyData* RightPropertyData,
+		bool bResolveSameChanges, const TBitArray<>& LeftIdenticalEntries, const TBitArray<>& RightIdenticalEntries, FDiffMap& OutDiffPropertyMap);
+	static void ApplyObjectPropertyDiff(const FPropertyDiffResult& DiffResult, UObject* InOutMergedObject);
+
+	// マージした要素でコンテナ (配列 / Map / Set) を作り直す
+	static void ApplyContainerMerge(const TArray<BlueprintMerge::Core::FSequenceItem>& Items, const FPropertyData& Base, const FPropertyData& Left, const FPropertyData& Right, const FPropertyData& InOutMerged);
+
 	// プロパティマップを構築する
-	static TMap<FName, FPropertyData> BuildPropertyMap(UObject* Target, EBuildPropertyMapOption Flags = EBuildPropertyMapOption::None);
-	static TMap<FName, class USCS_Node*> BuildSCSNodeMap(UBlueprintGeneratedClass* BPGC);
-	static void BuildSCSNodeMapRecursive(class USCS_Node* Node, const FString& Path, TMap<FName, class USCS_Node*>& InOutMap);
-	static TMap<FName, class UEdGraph*> BuildGraphMap(UBlueprint* Blueprint, EGraphType Type);
-	static void BuildGraphMapRecursive(UEdGraph* Graph, const FString& Path, TMap<FName, UEdGraph*>& InOutMap);
-	static TMap<FName, class UEdGraphNode*> BuildGraphNodesMap(UEdGraph* Graph);
-	static TMap<FName, class UEdGraphPin*> BuildGraphPinsMap(UEdGraphNode* Node);
-	static FString GetObjectPath(UObject* Root, UObject* Object, bool bRequiredRootName = false);
-
-	static void MergeBlueprintMemberVariables(UBlueprint* Base,
-		const TMap<FName, FPropertyData>& BasePropertyMap,
+	static FPropertyMap BuildPropertyMap(UObject* Target, EBuildPropertyMapOption Flags = EBuildPropertyMapOption::None);
+	static FSCSNodeMap BuildSCSNodeMap(UBlueprintGeneratedClass* BPGC);
+	static void BuildSCSNodeMapRecursive(class USCS_Node* Node, const FName& Path, FSCSNodeMap& InOutMap);
+	static FGraphMap BuildGraphMap(UBlueprint* Blueprint, EGraphType Type);
+	// 全ての種類のグラフを一度の走査でマップにする
+	static void BuildGraphHierarchy(UBlueprint* Blueprint, FGraphHierarchy& OutHierarchy);
+	// RootGraph とその子のグラフを、深さ優先でそれぞれ一度だけ追加する
+	static void AddGraphTree(UEdGraph* RootGraph, FGraphMap& InOutMap);
+	static const TArray<TObjectPtr<UEdGraph>>* GetRootGraphs(UBlueprint* Blueprint, EGraphType Type);
+	static FGraphNodeMap BuildGraphNodesMap(UEdGraph* Graph);
+	static FGraphPinMap BuildGraphPinsMap(UEdGraphNode* Node);
+	// Root からの相対パスを現在のパスのテーブルに登録して返す
+	// テーブルがある場合は、テーブルが Root ごとに持つ索引を引く
+	static FName GetObjectPath(UObject* Root, UObject* Object, bool bRequiredRootName = false);
+
+	// 変数の追加と削除を反映する (構造を変更した場合は true を返す)
+	static bool MergeBlueprintMemberVariables(UBlueprint* Base,
+		const FPropertyMap& BasePropertyMap,
 		UBlueprint* Left,
-		const TMap<FName, FPropertyData>& LeftPropertyMap,
+		const FPropertyMap& LeftPropertyMap,
 		UBlueprint* Right, 
-		const TMap<FName, FPropertyData>& RightPropertyMap,
-		const TMap<FName, FDiffData>& DiffPropertyMap,
-		const TSet<FName>& UnionPropertyKeys, 
-		const TMap<FName, FPropertyData>& MergedPropertyMap,
+		const FPropertyMap& RightPropertyMap,
+		const FDiffMap& DiffPropertyMap,
+		const FPropertyMap& MergedPropertyMap,
 		UBlueprint* InOutMergedBlueprint);
 
 	static void MergeObjectProperties(UObject* Base, UObject* Left, UObject* Right, UObject* InOutMergedObject);
 
 	static void MergeComponentProperties(FPropertyData& BaseComponentProperty, FPropertyData& LeftComponentProperty, FPropertyData& RightComponentProperty, FPropertyData& InOutMergedComponentProperty);
 
-	static void MergeBlueprintComponents(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, UBlueprint* InOutMergedBlueprint);
+	static void DiffBlueprintComponents(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, FComponentDiffResult& OutResult);
+	// コンポーネントの追加を反映する (構造を変更した場合は true を返す)
+	static bool MergeBlueprintComponents(const FComponentDiffResult& DiffResult, UBlueprint* InOutMergedBlueprint);
+
+	// コンポーネントのテンプレートのプロパティを反映する (コンパイルの後に呼ぶ)
+	static void ApplyComponentTemplateDiffs(const FComponentDiffResult& DiffResult, UBlueprint* InOutMergedBlueprint);
+
+	// 解析する全ての種類のグラフの差分 (グラフの階層は側ごとに一度だけ作る)
+	static void DiffBlueprintGraphs(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, TArray<FGraphDiffResult>& OutResults);
+	// 階層のマップは OutResult に移す
+	static void DiffFunctionGraphs(FGraphHierarchy& BaseGraphs, FGraphHierarchy& LeftGraphs, FGraphHierarchy& RightGraphs, EGraphType Type, FGraphDiffResult& OutResult);
+	// 全ての種類のグラフの組を先に集めて並列に比較し、結果を順番に反映する
+	static void DiffBlueprintGraphsParallel(FGraphHierarchy& BaseGraphs, FGraphHierarchy& LeftGraphs, FGraphHierarchy& RightGraphs, TArray<FGraphDiffResult>& OutResults);
+	// 3 つのグラフを比較して変更を判定する (読み取りのみなので、ワーカースレッドから呼べる)
+	static BlueprintMerge::Core::FDecision ClassifyGraphs(UEdGraph* BaseGraph, UEdGraph* LeftGraph, UEdGraph* RightGraph, TArray<FName>& OutDiffProperties);
+	// ノード単位でマージできる変更なら、ノード単位の差分を調べる (読み取りのみなので、ワーカースレッドから呼べる)
+	// ノード単位でマージできない場合も、OutNodeDiff にはコンフリクトの詳細が入ることがある
+	static bool DiffGraphNodesIfSupported(EGraphType Type, const BlueprintMerge::Core::FDecision& Decision, UEdGraph* BaseGraph, UEdGraph* LeftGraph, UEdGraph* RightGraph, FGraphNodeDiffResult& OutNodeDiff);
+	// 1 つのグラフの組の判定結果とノード単位の差分を、キーの順に反映する
+	static void AddGraphDiff(const FName& Path, UEdGraph* LeftGraph, UEdGraph* RightGraph, const BlueprintMerge::Core::FDecision& Decision, TArray<FName>& DiffProperties, bool bNodeMerge, FGraphNodeDiffResult& NodeDiff, FGraphDiffResult& OutResult);
+	// グラフの変更を反映する (構造を変更した場合は true を返す)
+	// 入れ子のグラフは、先祖を複製し直す場合は先祖と一緒に反映し、そうでなければ持ち主のノードの下で置き換える
+	static bool MergeFunctionGraphs(const FGraphDiffResult& DiffResult, UBlueprint* InOutMergedBlueprint);
+
+	// 3-way の判定結果を差分データにする
+	// bPresenceFlags が true の場合、削除のフラグはその側に残っているかを表す (プロパティとコンポーネント)
+	// false の場合は削除した側を表す (グラフとノード)
+	static FDiffData MakeDiffData(const FName& Path, const BlueprintMerge::Core::FDecision& Decision, bool bInLeft, bool bInRight, bool bPresenceFlags);
 
-	static void MergeFunctionGraphs(UBlueprint* Base, UBlueprint* Left, UBlueprint* Right, UBlueprint* InOutMergedBlueprint, EGraphType Type);
+	// ノード単位でマージできるグラフの種類か
+	static bool IsNodeMergeSupported(EGraphType Type);
+
+	// ノード単位の差分を解析する
+	// ノードは NodeGuid で対応付け、NodeGuid がないノードだけ名前で対応付ける
+	// コンフリクトがある場合や、グラフ自身のプロパティが変更されている場合は false を返す
+	// 張り直すリンクのピンが、マージ後に残るノードにない場合もコンフリクトにする
+	static bool DiffGraphNodes(UEdGraph* BaseGraph, UEdGraph* LeftGraph, UEdGraph* RightGraph, FGraphNodeDiffResult& OutResult);
+	static void MergeGraphNodes(const FGraphNodeDiffResult& DiffResult, UEdGraph* InOutMergedGraph, UBlueprint* InOutMergedBlueprint);
+
+	// ノードを複製してグラフに追加する (リンクは張らない)
+	static UEdGraphNode* DuplicateGraphNode(UEdGraphNode* SourceNode, UEdGraph* Graph);
+	static void RemoveGraphNode(UEdGraphNode* Node, UBlueprint* Blueprint);
 
 	// グラフの内容が一致するか
 	// 差分があったプロパティのリストを返す
 	static bool IdenticalGraphs(UEdGraph* LeftGraph, UEdGraph* RightGraph, TArray<FName>& OutDiffProperties);
 	static bool IdenticalNodes(UEdGraph* LeftGraph, UEdGraphNode* LeftNode, UEdGraph* RightGraph, UEdGraphNode* RightNode);
+	// ピンの型・既定値・リンク先が一致するか
 	static bool IdenticalPins(UEdGraphPin* LeftPin, UEdGraphPin* RightPin);
 
+	// テキストのソースの文字列と、ローカライズの名前空間・キーが一致するか
+	static bool IdenticalTexts(const FText& Left, const FText& Right);
+	static bool IdenticalPinTypes(UObject* LeftRootObject, const FEdGraphPinType& Left, UObject* RightRootObject, const FEdGraphPinType& Right);
+	// リンク先を (ノードの名前, ピンの名前) の集合として比較する
+	static bool IdenticalPinLinks(const UEdGraphPin* LeftPin, const UEdGraphPin* RightPin);
+	static FGraphPinEndpoint MakePinEndpoint(const UEdGraphPin* Pin);
+
+	// オブジェクトの参照が一致するか
+	// Root の中のオブジェクトは Root からの相対パスで、それ以外は同じオブジェクトかで比較する
+	static bool IdenticalObjectReferences(UObject* LeftRootObject, UObject* LeftObject, UObject* RightRootObject, UObject* RightObject);
+
 	static bool IdenticalProperties(UObject* LeftRootObject, const FPropertyData& Left, UObject* RightRootObject, const FPropertyData& Right);
 
-	// プロパティの値をログ出力する
-	static void OutputPropertyValues(const FPropertyData& PropertyData, const FString& ContextString);
+	// プロパティの値を文字列化する
+	static FString ExportPropertyValue(const FPropertyData& PropertyData);
 
 	// グラフタイプに応じたグラフを追加する
 	static void AddGraphToBlueprint(UBlueprint* Blueprint, UEdGraph* Graph, EGraphType Type);
+
+	// 入れ子のグラフを、持ち主と名前を変えずに SourceGraph の複製と置き換える
+	static void ReplaceNestedGraph(UEdGraph* MergedGraph, UEdGraph* SourceGraph);
 };
@@ -0,0 +1,370 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergePath.h"
+#include "BlueprintMergeStats.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/UObjectHash.h"
+
+
+namespace
+{
+	// 登録したキーは、この名前に ID + 1 を番号として付ける
+	const FName& GetPathMarker()
+	{
+		static const FName PathMarker(TEXT("__BlueprintMergePath"));
+		return PathMarker;
+	}
+
+	thread_local FBlueprintMergePathTable* CurrentTable = nullptr;
+
+	int32 GetPathId(const FName& Key)
+	{
+		return Key.GetNumber() - 1;
+	}
+}
+
+FName FBlueprintMergePathTable::Intern(const FName& Parent, const FName& Leaf, int32 ArrayIndex)
+{
+	const FPathNode Node{ Parent, Leaf, ArrayIndex };
+	const uint32 Hash = GetTypeHash(Node);
+	{
+		FReadScopeLock ReadLock(Lock);
+		if (const int32* Id = NodeIds.FindByHash(Hash, Node))
+		{
+			return FName(GetPathMarker(), *Id + 1);
+		}
+	}
+
+	FWriteScopeLock WriteLock(Lock);
+	if (const int32* Id = NodeIds.FindByHash(Hash, Node))
+	{
+		return FName(GetPathMarker(), *Id + 1);
+	}
+
+	const int32 Id = Nodes.Add(Node);
+	NodeIds.AddByHash(Hash, Node, Id);
+	return FName(GetPathMarker(), Id + 1);
+}
+
+void FBlueprintMergePathTable::AppendString(const FName& Key, FStringBuilderBase& Out) const
+{
+	FReadScopeLock ReadLock(Lock);
+	AppendStringLocked(Key, Out);
+}
+
+FString FBlueprintMergePathTable::ToString(const FName& Key) const
+{
+	TStringBuilder<256> Builder;
+	AppendString(Key, Builder);
+	return FString(Builder.ToView());
+}
+
+int32 FBlueprintMergePathTable::Num() const
+{
+	FReadScopeLock ReadLock(Lock);
+	return Nodes.Num();
+}
+
+FName FBlueprintMergePathTable::FindOrAddObjectPath(const UObject* Root, const UObject* Object)
+{
+	if (!Root || !Object || Object == Root)
+	{
+		return NAME_None;
+	}
+
+	{
+		FReadScopeLock ReadLock(ObjectPathLock);
+		if (const FObjectPathMap* Paths = ObjectPaths.Find(Root))
+		{
+			if (const FName* Path = Paths->Find(Object))
+			{
+				return *Path;
+			}
+		}
+	}
+
+	FWriteScopeLock WriteLock(ObjectPathLock);
+	bool bNewRoot = false;
+	FObjectPathMap* Paths = ObjectPaths.Find(Root);
+	if (!Paths)
+	{
+		Paths = &ObjectPaths.Add(Root);
+		bNewRoot = true;
+	}
+
+	if (bNewRoot)
+	{
+		// Root の中のオブジェクトを一度の走査でまとめて登録する
+		ForEachObjectWithOuter(Root, [this, Root, Paths](UObject* Child)
+		{
+			ResolveObjectPathLocked(Root, Child, *Paths);
+		}, true);
+	}
+
+	// 索引を作った後に作られたオブジェクトは、ここで登録する
+	return ResolveObjectPathLocked(Root, Object, *Paths);
+}
+
+FName FBlueprintMergePathTable::ResolveObjectPathLocked(const UObject* Root, const UObject* Object, FObjectPathMap& InOutPaths)
+{
+	if (const FName* Path = InOutPaths.Find(Object))
+	{
+		return *Path;
+	}
+
+	const UObject* Outer = Object->GetOuter();
+	if (!Outer)
+	{
+		// Root の中にない
+		InOutPaths.Add(Object, NAME_None);
+		return NAME_None;
+	}
+
+	FName OuterPath = NAME_None;
+	if (Outer != Root)
+	{
+		OuterPath = ResolveObjectPathLocked(Root, Outer, InOutPaths);
+		if (OuterPath.IsNone())
+		{
+			InOutPaths.Add(Object, NAME_None);
+			return NAME_None;
+		}
+	}
+
+	const FName Path = Intern(OuterPath, Object->GetFName());
+	InOutPaths.Add(Object, Path);
+	return Path;
+}
+
+void FBlueprintMergePathTable::AppendStringLocked(const FName& Key, FStringBuilderBase& Out) const
+{
+	// 親をたどってから、先頭から順に追加する
+	TArray<int32, TInlineAllocator<16>> Chain;
+	FName Current = Key;
+	while (IsInterned(Current) && Nodes.IsValidIndex(GetPathId(Current)))
+	{
+		Chain.Add(GetPathId(Current));
+		Current = Nodes[Chain.Last()].Parent;
+	}
+
+	if (!Current.IsNone())
+	{
+		Current.AppendString(Out);
+	}
+
+	for (int32 Index = Chain.Num() - 1; Index >= 0; --Index)
+	{
+		const FPathNode& Node = Nodes[Chain[Index]];
+		if (Node.ArrayIndex == KeyLeafIndex)
+		{
+			Out << TEXT('[');
+			Node.Leaf.AppendString(Out);
+			Out << TEXT(']');
+			continue;
+		}
+
+		if (!Node.Leaf.IsNone())
+		{
+			if (Out.Len() > 0)
+			{
+				Out << TEXT('.');
+			}
+			Node.Leaf.AppendString(Out);
+		}
+
+		if (Node.ArrayIndex != INDEX_NONE)
+		{
+			Out << TEXT('[') << Node.ArrayIndex << TEXT(']');
+		}
+	}
+}
+
+FName FBlueprintMergePathTable::GetRootNameLocked(const FName& Key) const
+{
+	FName Current = Key;
+	FName Root = Key;
+	while (IsInterned(Current) && Nodes.IsValidIndex(GetPathId(Current)))
+	{
+		const FPathNode& Node = Nodes[GetPathId(Current)];
+		Root = Node.Leaf;
+		Current = Node.Parent;
+	}
+	return Current.IsNone() ? Root : Current;
+}
+
+uint32 FBlueprintMergePathTable::HashPathLocked(const FName& Key) const
+{
+	if (!IsInterned(Key) || !Nodes.IsValidIndex(GetPathId(Key)))
+	{
+		return GetTypeHash(Key);
+	}
+
+	TArray<int32, TInlineAllocator<16>> Chain;
+	FName Current = Key;
+	while (IsInterned(Current) && Nodes.IsValidIndex(GetPathId(Current)))
+	{
+		Chain.Add(GetPathId(Current));
+		Current = Nodes[Chain.Last()].Parent;
+	}
+
+	uint32 Hash = GetTypeHash(Current);
+	for (int32 Index = Chain.Num() - 1; Index >= 0; --Index)
+	{
+		const FPathNode& Node = Nodes[Chain[Index]];
+		Hash = HashCombine(HashCombine(Hash, GetTypeHash(Node.Leaf)), ::GetTypeHash(Node.ArrayIndex));
+	}
+	return Hash;
+}
+
+bool FBlueprintMergePathTable::IsInterned(const FName& Key)
+{
+	return Key.GetNumber() > 0 && Key.GetComparisonIndex() == GetPathMarker().GetComparisonIndex();
+}
+
+FBlueprintMergePathTable* FBlueprintMergePathTable::GetCurrent()
+{
+	return CurrentTable;
+}
+
+FName FBlueprintMergePathTable::MakePath(const FName& Parent, const FName& Leaf, int32 ArrayIndex)
+{
+	if (CurrentTable)
+	{
+		return CurrentTable->Intern(Parent, Leaf, ArrayIndex);
+	}
+
+	// テーブルがない場合は、これまで通りパスの文字列から FName を作る
+	TStringBuilder<256> Builder;
+	if (!Parent.IsNone())
+	{
+		Parent.AppendString(Builder);
+	}
+	if (!Leaf.IsNone())
+	{
+		if (Builder.Len() > 0)
+		{
+			Builder << TEXT('.');
+		}
+		Leaf.AppendString(Builder);
+	}
+	if (ArrayIndex != INDEX_NONE)
+	{
+		Builder << TEXT('[') << ArrayIndex << TEXT(']');
+	}
+
+	BLUEPRINT_MERGE_COUNTER_ADD(FNamesCreated, 1);
+	return FName(Builder.ToView());
+}
+
+FName FBlueprintMergePathTable::MakeKeyPath(const FName& Parent, FStringView KeyText)
+{
+	// FName の長さの上限を超えるキーは、ハッシュで区別する
+	TStringBuilder<NAME_SIZE> KeyBuilder;
+	if (KeyText.Len() < NAME_SIZE)
+	{
+		KeyBuilder << KeyText;
+	}
+	else
+	{
+		KeyBuilder << KeyText.Left(NAME_SIZE / 2);
+		KeyBuilder.Appendf(TEXT("...#%08x"), FCrc::MemCrc32(KeyText.GetData(), KeyText.Len() * sizeof(TCHAR)));
+	}
+
+	BLUEPRINT_MERGE_COUNTER_ADD(FNamesCreated, 1);
+	const FName Key(KeyBuilder.ToView());
+	if (CurrentTable)
+	{
+		return CurrentTable->Intern(Parent, Key, KeyLeafIndex);
+	}
+
+	TStringBuilder<256> Builder;
+	if (!Parent.IsNone())
+	{
+		Parent.AppendString(Builder);
+	}
+	Builder << TEXT('[');
+	Key.AppendString(Builder);
+	Builder << TEXT(']');
+
+	BLUEPRINT_MERGE_COUNTER_ADD(FNamesCreated, 1);
+	return FName(Builder.ToView());
+}
+
+void FBlueprintMergePathTable::AppendPathString(const FName& Key, FStringBuilderBase& Out)
+{
+	if (CurrentTable && IsInterned(Key))
+	{
+		CurrentTable->AppendString(Key, Out);
+	}
+	else
+	{
+		Key.AppendString(Out);
+	}
+}
+
+FString FBlueprintMergePathTable::PathToString(const FName& Key)
+{
+	TStringBuilder<256> Builder;
+	AppendPathString(Key, Builder);
+	return FString(Builder.ToView());
+}
+
+bool FBlueprintMergePathTable::PathContains(const FName& Key, const TCHAR* Text)
+{
+	TStringBuilder<256> Builder;
+	AppendPathString(Key, Builder);
+	return UE::String::FindFirst(Builder.ToView(), Text, ESearchCase::IgnoreCase) != INDEX_NONE;
+}
+
+FName FBlueprintMergePathTable::GetRootName(const FName& Key)
+{
+	if (!CurrentTable || !IsInterned(Key))
+	{
+		return Key;
+	}
+
+	FReadScopeLock ReadLock(CurrentTable->Lock);
+	return CurrentTable->GetRootNameLocked(Key);
+}
+
+FName FBlueprintMergePathTable::GetParentPath(const FName& Key)
+{
+	if (!CurrentTable || !IsInterned(Key))
+	{
+		return NAME_None;
+	}
+
+	FReadScopeLock ReadLock(CurrentTable->Lock);
+	const int32 Id = GetPathId(Key);
+	return CurrentTable->Nodes.IsValidIndex(Id) ? CurrentTable->Nodes[Id].Parent : NAME_None;
+}
+
+uint32 FBlueprintMergePathTable::HashPath(const FName& Key)
+{
+	if (!CurrentTable || !IsInterned(Key))
+	{
+		return GetTypeHash(Key);
+	}
+
+	FReadScopeLock ReadLock(CurrentTable->Lock);
+	return CurrentTable->HashPathLocked(Key);
+}
+
+FBlueprintMergePathTable::FScope::FScope(FBlueprintMergePathTable* Table)
+{
+	if (Table)
+	{
+		PreviousTable = CurrentTable;
+		CurrentTable = Table;
+		bActive = true;
+	}
+}
+
+FBlueprintMergePathTable::FScope::~FScope()
+{
+	if (bActive)
+	{
+		CurrentTable = PreviousTable;
+	}
+}
@@ -0,0 +1,117 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+// マージごとのパスのテーブル
+// "Parent.Leaf[ArrayIndex]" というパスを (親のキー, 末尾の名前, 配列のインデックス) の組として登録し、
+// 32 ビットの ID を番号に持つ FName をキーとして返す
+// パスの文字列や FName を作らないので、グローバルな名前テーブルに一時的なパスが残らない
+// 文字列はレポートなどで必要になったときだけ作る
+class FBlueprintMergePathTable
+{
+public:
+	FBlueprintMergePathTable() = default;
+	FBlueprintMergePathTable(const FBlueprintMergePathTable&) = delete;
+	FBlueprintMergePathTable& operator=(const FBlueprintMergePathTable&) = delete;
+
+	// パスを登録してキーを返す (ワーカースレッドから呼べる)
+	// Parent が NAME_None の場合は Leaf が先頭、Leaf が NAME_None の場合は "Parent[ArrayIndex]" になる
+	FName Intern(const FName& Parent, const FName& Leaf, int32 ArrayIndex = INDEX_NONE);
+
+	// キーのパスの文字列を追加する (登録されていないキーはそのまま追加する)
+	void AppendString(const FName& Key, FStringBuilderBase& Out) const;
+	FString ToString(const FName& Key) const;
+
+	int32 Num() const;
+
+	// Root からの Object の相対パスのキー (Object が Root の中にない場合は NAME_None)
+	// Root ごとに、最初に引いたときに Root の中のオブジェクトをまとめて登録し、以降は索引を引くだけにする
+	// 索引はマージの間だけ使うので、登録した後に名前やアウターが変わるオブジェクトには使わない (ワーカースレッドから呼べる)
+	FName FindOrAddObjectPath(const UObject* Root, const UObject* Object);
+
+	// テーブルに登録されたキーか
+	static bool IsInterned(const FName& Key);
+
+	// 現在のスレッドのテーブル (なければ nullptr)
+	static FBlueprintMergePathTable* GetCurrent();
+
+	// 現在のテーブルに登録する
+	// テーブルがない場合は、これまで通りパスの文字列から FName を作る
+	static FName MakePath(const FName& Parent, const FName& Leaf, int32 ArrayIndex = INDEX_NONE);
+
+	// Map や Set のキーを末尾に付けた "Parent[Key]" のパス (キーの文字列から FName を作るので、コンフリクトなど必要なときだけ使う)
+	static FName MakeKeyPath(const FName& Parent, FStringView KeyText);
+
+	// 現在のテーブルでパスを文字列にする
+	static void AppendPathString(const FName& Key, FStringBuilderBase& Out);
+	static FString PathToString(const FName& Key);
+
+	// パスの文字列に Text が含まれるか (大文字小文字を区別しない)
+	static bool PathContains(const FName& Key, const TCHAR* Text);
+
+	// パスの先頭の名前
+	static FName GetRootName(const FName& Key);
+
+	// 親のパスのキー (先頭のパスや、テーブルに登録されていないキーは NAME_None)
+	static FName GetParentPath(const FName& Key);
+
+	// テーブルに依存しないパスのハッシュ (同じパスは別のテーブルでも同じハッシュになる)
+	static uint32 HashPath(const FName& Key);
+
+	// スコープの間、現在のスレッドのテーブルを切り替える
+	// nullptr を指定した場合は何もしない
+	class FScope
+	{
+	public:
+		explicit FScope(FBlueprintMergePathTable* Table);
+		~FScope();
+
+		FScope(const FScope&) = delete;
+		FScope& operator=(const FScope&) = delete;
+
+	private:
+		FBlueprintMergePathTable* PreviousTable = nullptr;
+		bool bActive = false;
+	};
+
+private:
+	// ArrayIndex にこの値を持つノードは、Leaf をキーとして "[Leaf]" と書き出す
+	static constexpr int32 KeyLeafIndex = -2;
+
+	struct FPathNode
+	{
+		FName Parent;
+		FName Leaf;
+		int32 ArrayIndex = INDEX_NONE;
+
+		bool operator==(const FPathNode& Other) const
+		{
+			return Parent == Other.Parent && Leaf == Other.Leaf && ArrayIndex == Other.ArrayIndex;
+		}
+
+		friend uint32 GetTypeHash(const FPathNode& Node)
+		{
+			return HashCombine(HashCombine(GetTypeHash(Node.Parent), GetTypeHash(Node.Leaf)), ::GetTypeHash(Node.ArrayIndex));
+		}
+	};
+
+	// ロックを取った状態で呼ぶ
+	void AppendStringLocked(const FName& Key, FStringBuilderBase& Out) const;
+	FName GetRootNameLocked(const FName& Key) const;
+	uint32 HashPathLocked(const FName& Key) const;
+
+	using FObjectPathMap = TMap<const UObject*, FName>;
+
+	// ObjectPathLock を取った状態で呼ぶ (アウターから順に登録する)
+	FName ResolveObjectPathLocked(const UObject* Root, const UObject* Object, FObjectPathMap& InOutPaths);
+
+	TArray<FPathNode> Nodes;
+	TMap<FPathNode, int32> NodeIds;
+	mutable FRWLock Lock;
+
+	// Root ごとのオブジェクトの相対パス
+	TMap<const UObject*, FObjectPathMap> ObjectPaths;
+	FRWLock ObjectPathLock;
+};
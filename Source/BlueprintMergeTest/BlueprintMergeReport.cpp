@@ -0,0 +1,152 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeReport.h"
+#include "HAL/FileManager.h"
+
+
+namespace
+{
+	// この大きさを超えたらファイルに書き出す
+	constexpr int32 FlushThreshold = 64 * 1024;
+
+	FBlueprintMergeReport* ActiveReport = nullptr;
+}
+
+FBlueprintMergeReport::~FBlueprintMergeReport()
+{
+	Close();
+}
+
+bool FBlueprintMergeReport::Open(const FString& Filename, bool bInIncludeValues)
+{
+	Close();
+
+	Writer.Reset(IFileManager::Get().CreateFileWriter(*Filename));
+	if (!Writer)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to open merge report. Filename[%s]"), *Filename);
+		return false;
+	}
+
+	bIncludeValues = bInIncludeValues;
+	Buffer.Reserve(FlushThreshold + 1024);
+	return true;
+}
+
+void FBlueprintMergeReport::Close()
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	Flush();
+	Writer->Close();
+	Writer.Reset();
+
+	if (ActiveReport == this)
+	{
+		ActiveReport = nullptr;
+	}
+}
+
+void FBlueprintMergeReport::Write(const FBlueprintMergeReportRecord& Record)
+{
+	if (!Writer)
+	{
+		return;
+	}
+
+	Buffer += TEXT("{\"merge\":");
+	AppendJsonString(Buffer, Record.Merge);
+	Buffer += TEXT(",\"category\":");
+	AppendJsonString(Buffer, Record.Category);
+	Buffer += TEXT(",\"path\":");
+	AppendJsonString(Buffer, Record.Path);
+	Buffer += TEXT(",\"action\":");
+	AppendJsonString(Buffer, Record.Action);
+	Buffer += TEXT(",\"left\":");
+	Buffer += Record.bIsLeftUpdate ? TEXT("true") : TEXT("false");
+	Buffer += TEXT(",\"right\":");
+	Buffer += Record.bIsRightUpdate ? TEXT("true") : TEXT("false");
+
+	if (bIncludeValues && Record.LeftValue)
+	{
+		Buffer += TEXT(",\"leftValue\":");
+		AppendJsonString(Buffer, *Record.LeftValue);
+	}
+
+	if (bIncludeValues && Record.RightValue)
+	{
+		Buffer += TEXT(",\"rightValue\":");
+		AppendJsonString(Buffer, *Record.RightValue);
+	}
+	Buffer += TEXT("}\n");
+
+	if (Buffer.Len() >= FlushThreshold)
+	{
+		Flush();
+	}
+}
+
+void FBlueprintMergeReport::Flush()
+{
+	if (!Writer || Buffer.IsEmpty())
+	{
+		return;
+	}
+
+	const FTCHARToUTF8 Utf8Buffer(*Buffer, Buffer.Len());
+	Writer->Serialize(const_cast<ANSICHAR*>(Utf8Buffer.Get()), Utf8Buffer.Length());
+	Buffer.Reset();
+}
+
+FBlueprintMergeReport* FBlueprintMergeReport::GetActive()
+{
+	check(IsInGameThread());
+	return ActiveReport;
+}
+
+void FBlueprintMergeReport::SetActive(FBlueprintMergeReport* Report)
+{
+	check(IsInGameThread());
+	ActiveReport = Report;
+}
+
+void FBlueprintMergeReport::AppendJsonString(FString& Out, FStringView Value)
+{
+	Out += TEXT('"');
+	for (TCHAR Char : Value)
+	{
+		switch (Char)
+		{
+		case TEXT('"'):
+			Out += TEXT("\\\"");
+			break;
+		case TEXT('\\'):
+			Out += TEXT("\\\\");
+			break;
+		case TEXT('\n'):
+			Out += TEXT("\\n");
+			break;
+		case TEXT('\r'):
+			Out += TEXT("\\r");
+			break;
+		case TEXT('\t'):
+			Out += TEXT("\\t");
+			break;
+		default:
+			if (Char < 0x20)
+			{
+				Out += FString::Printf(TEXT("\\u%04x"), static_cast<uint32>(Char));
+			}
+			else
+			{
+				Out += Char;
+			}
+			break;
+		}
+	}
+	Out += TEXT('"');
+}
@@ -0,0 +1,68 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+
+class FArchive;
+
+// マージレポートの 1 レコード
+struct FBlueprintMergeReportRecord
+{
+	// マージの出力名
+	FStringView Merge;
+
+	// Property / Component / ComponentProperty / Graph / GraphNode / GraphProperty
+	FStringView Category;
+
+	FStringView Path;
+
+	// Add / Remove / Modify / Conflict
+	FStringView Action;
+
+	// 変更した側
+	bool bIsLeftUpdate = false;
+	bool bIsRightUpdate = false;
+
+	// 値 (レポートが値を含む場合のみ)
+	const FString* LeftValue = nullptr;
+	const FString* RightValue = nullptr;
+};
+
+// 差分とコンフリクトのレポート
+// レコードを JSON Lines でファイルに書き出す (1 行 1 レコード)
+class FBlueprintMergeReport
+{
+public:
+	FBlueprintMergeReport() = default;
+	~FBlueprintMergeReport();
+
+	bool Open(const FString& Filename, bool bInIncludeValues);
+	void Close();
+
+	bool IsOpen() const
+	{
+		return Writer != nullptr;
+	}
+
+	// 値を書き出すか (false の場合、呼び出し側は値を文字列化しなくてよい)
+	bool IncludesValues() const
+	{
+		return bIncludeValues;
+	}
+
+	void Write(const FBlueprintMergeReportRecord& Record);
+	void Flush();
+
+	// 現在のレポート (開いていない場合は nullptr)
+	// ゲームスレッドからのみ使う
+	static FBlueprintMergeReport* GetActive();
+	static void SetActive(FBlueprintMergeReport* Report);
+
+private:
+	static void AppendJsonString(FString& Out, FStringView Value);
+
+	TUniquePtr<FArchive> Writer;
+	FString Buffer;
+	bool bIncludeValues = false;
+};
@@ -0,0 +1,340 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+// 配列の要素の並びの差分と 3-way マージ
+// BlueprintMergeCore.h と同じく、エンジンに依存しない C++ だけで書く
+// 要素のハッシュと比較は UBlueprintMergeLibrary 側で用意する
+
+#include <cstdint>
+#include <iterator>
+#include <unordered_map>
+#include <vector>
+
+namespace BlueprintMerge
+{
+	namespace Core
+	{
+		// 1 つの側の、Base からの編集
+		struct FSequenceDiff
+		{
+			// 最長共通部分列で対応付けた位置 (対応しない要素は -1)
+			std::vector<std::int32_t> BaseToOther;
+			std::vector<std::int32_t> OtherToBase;
+
+			// 移動した要素 (共通部分列から外れた、削除と追加の組)
+			std::vector<std::int32_t> BaseMovedTo;
+			std::vector<std::int32_t> OtherMovedFrom;
+
+			// 追加と削除の数 (移動を含む)
+			std::int32_t EditDistance = 0;
+			std::int32_t NumMoves = 0;
+
+			bool IsDeleted(std::int32_t BaseIndex) const
+			{
+				return BaseToOther[BaseIndex] < 0 && BaseMovedTo[BaseIndex] < 0;
+			}
+		};
+
+		enum class ESequenceSide : std::uint8_t
+		{
+			Base,
+			Left,
+			Right,
+		};
+
+		// マージした並びの 1 要素 (どの側の何番目の要素か)
+		struct FSequenceItem
+		{
+			ESequenceSide Side = ESequenceSide::Base;
+			std::int32_t Index = -1;
+		};
+
+		struct FSequenceMergeResult
+		{
+			std::vector<FSequenceItem> Items;
+			bool bLeftChanged = false;
+			bool bRightChanged = false;
+
+			// 両側が同じ範囲を別々に変更した
+			bool bConflict = false;
+		};
+
+		// 編集距離の上限の既定値 (これを超える場合は差分を諦める)
+		// 記録する経路は編集距離の 2 乗に比例する
+		constexpr std::int32_t DefaultMaxEditDistance = 2048;
+
+		/**
+		 * Myers の O(ND) アルゴリズムで、Base から Other への最短の編集を求める
+		 *
+		 * Hashes: 要素のハッシュ (等しい要素は同じハッシュにすること)
+		 * IsEqual(BaseIndex, OtherIndex): ハッシュが一致した要素の内容が等しいか
+		 *
+		 * 共通部分列から外れた削除と追加のうち、内容が等しい組は移動として記録する
+		 * 編集距離が MaxEditDistance を超えた場合は false を返す
+		 */
+		template<typename EqualFunc>
+		bool DiffSequences(const std::uint32_t* BaseHashes, std::int32_t BaseNum, const std::uint32_t* OtherHashes, std::int32_t OtherNum, EqualFunc&& IsEqual, FSequenceDiff& OutDiff, std::int32_t MaxEditDistance = DefaultMaxEditDistance)
+		{
+			auto Equals = [&](std::int32_t BaseIndex, std::int32_t OtherIndex)
+			{
+				return BaseHashes[BaseIndex] == OtherHashes[OtherIndex] && IsEqual(BaseIndex, OtherIndex);
+			};
+
+			OutDiff.BaseToOther.assign(BaseNum, -1);
+			OutDiff.OtherToBase.assign(OtherNum, -1);
+			OutDiff.BaseMovedTo.assign(BaseNum, -1);
+			OutDiff.OtherMovedFrom.assign(OtherNum, -1);
+			OutDiff.EditDistance = 0;
+			OutDiff.NumMoves = 0;
+
+			auto Match = [&OutDiff](std::int32_t BaseIndex, std::int32_t OtherIndex)
+			{
+				OutDiff.BaseToOther[BaseIndex] = OtherIndex;
+				OutDiff.OtherToBase[OtherIndex] = BaseIndex;
+			};
+
+			// 先頭と末尾の共通部分は、経路を探す前に外す
+			std::int32_t Prefix = 0;
+			while (Prefix < BaseNum && Prefix < OtherNum && Equals(Prefix, Prefix))
+			{
+				Match(Prefix, Prefix);
+				++Prefix;
+			}
+
+			std::int32_t Suffix = 0;
+			while (Suffix < BaseNum - Prefix && Suffix < OtherNum - Prefix && Equals(BaseNum - 1 - Suffix, OtherNum - 1 - Suffix))
+			{
+				Match(BaseNum - 1 - Suffix, OtherNum - 1 - Suffix);
+				++Suffix;
+			}
+
+			const std::int32_t N = BaseNum - Prefix - Suffix;
+			const std::int32_t M = OtherNum - Prefix - Suffix;
+			const std::int32_t Max = N + M;
+			if (Max > 0)
+			{
+				// V[k] は対角線 k (x - y) で到達した最も遠い x
+				// 経路を復元するため、編集距離ごとに [-D, D] の範囲を記録する
+				const std::int32_t Offset = Max + 1;
+				std::vector<std::int32_t> V(2 * Max + 3, 0);
+				std::vector<std::vector<std::int32_t>> Trace;
+
+				std::int32_t FoundDistance = -1;
+				for (std::int32_t D = 0; D <= Max && FoundDistance < 0; ++D)
+				{
+					if (D > MaxEditDistance)
+					{
+						return false;
+					}
+
+					for (std::int32_t K = -D; K <= D; K += 2)
+					{
+						std::int32_t X = (K == -D || (K != D && V[Offset + K - 1] < V[Offset + K + 1])) ? V[Offset + K + 1] : V[Offset + K - 1] + 1;
+						std::int32_t Y = X - K;
+						while (X < N && Y < M && Equals(Prefix + X, Prefix + Y))
+						{
+							++X;
+							++Y;
+						}
+						V[Offset + K] = X;
+
+						if (X >= N && Y >= M)
+						{
+							FoundDistance = D;
+							break;
+						}
+					}
+					Trace.emplace_back(V.begin() + (Offset - D), V.begin() + (Offset + D + 1));
+				}
+
+				// 終点から経路を逆にたどり、対角線 (一致) を記録する
+				std::int32_t X = N;
+				std::int32_t Y = M;
+				for (std::int32_t D = FoundDistance; D > 0; --D)
+				{
+					const std::vector<std::int32_t>& Previous = Trace[D - 1];
+					auto PreviousX = [&Previous, D](std::int32_t K)
+					{
+						return Previous[K + D - 1];
+					};
+
+					const std::int32_t K = X - Y;
+					const std::int32_t PreviousK = (K == -D || (K != D && PreviousX(K - 1) < PreviousX(K + 1))) ? K + 1 : K - 1;
+					const std::int32_t StartX = PreviousX(PreviousK);
+					const std::int32_t StartY = StartX - PreviousK;
+					const std::int32_t MidX = (PreviousK == K + 1) ? StartX : StartX + 1;
+					while (X > MidX)
+					{
+						--X;
+						--Y;
+						Match(Prefix + X, Prefix + Y);
+					}
+					X = StartX;
+					Y = StartY;
+				}
+				while (X > 0)
+				{
+					--X;
+					--Y;
+					Match(Prefix + X, Prefix + Y);
+				}
+				OutDiff.EditDistance = FoundDistance;
+			}
+
+			// 削除した要素をハッシュで引けるようにして、同じ内容の追加と組にする
+			std::unordered_map<std::uint32_t, std::vector<std::int32_t>> DeletedByHash;
+			for (std::int32_t BaseIndex = BaseNum - 1; BaseIndex >= 0; --BaseIndex)
+			{
+				if (OutDiff.BaseToOther[BaseIndex] < 0)
+				{
+					DeletedByHash[BaseHashes[BaseIndex]].push_back(BaseIndex);
+				}
+			}
+
+			if (!DeletedByHash.empty())
+			{
+				for (std::int32_t OtherIndex = 0; OtherIndex < OtherNum; ++OtherIndex)
+				{
+					if (OutDiff.OtherToBase[OtherIndex] >= 0)
+					{
+						continue;
+					}
+
+					auto Found = DeletedByHash.find(OtherHashes[OtherIndex]);
+					if (Found == DeletedByHash.end())
+					{
+						continue;
+					}
+
+					// 候補は Base の先頭から順に使う (末尾から積んでいる)
+					std::vector<std::int32_t>& Candidates = Found->second;
+					for (auto It = Candidates.rbegin(); It != Candidates.rend(); ++It)
+					{
+						if (IsEqual(*It, OtherIndex))
+						{
+							OutDiff.BaseMovedTo[*It] = OtherIndex;
+							OutDiff.OtherMovedFrom[OtherIndex] = *It;
+							++OutDiff.NumMoves;
+							Candidates.erase(std::next(It).base());
+							break;
+						}
+					}
+				}
+			}
+			return true;
+		}
+
+		/**
+		 * Base から Left / Right への編集を合わせた並びを作る
+		 *
+		 * 両側で共通部分列に残った Base の要素を同期点とし、その間の範囲ごとに
+		 * 片側だけが変更していればその側を、両側が同じ変更をしていれば Left を使う
+		 * IsSame(LeftIndex, RightIndex): Left と Right の要素の内容が等しいか
+		 *
+		 * 移動した要素は、もう片側が削除していれば削除を優先し、
+		 * 両側が別々の位置に移動した場合はコンフリクトにする
+		 */
+		template<typename SameFunc>
+		void MergeSequences(std::int32_t BaseNum, std::int32_t LeftNum, std::int32_t RightNum, const FSequenceDiff& LeftDiff, const FSequenceDiff& RightDiff, SameFunc&& IsSame, FSequenceMergeResult& OutResult)
+		{
+			OutResult = FSequenceMergeResult();
+			OutResult.Items.reserve(LeftNum > RightNum ? LeftNum : RightNum);
+
+			// 範囲 [BaseBegin, BaseEnd) がその側で変わっていないか
+			auto IsUnchanged = [](const FSequenceDiff& Diff, std::int32_t BaseBegin, std::int32_t BaseEnd, std::int32_t OtherBegin, std::int32_t OtherEnd)
+			{
+				if (BaseEnd - BaseBegin != OtherEnd - OtherBegin)
+				{
+					return false;
+				}
+				for (std::int32_t BaseIndex = BaseBegin; BaseIndex < BaseEnd; ++BaseIndex)
+				{
+					if (Diff.BaseToOther[BaseIndex] != OtherBegin + (BaseIndex - BaseBegin))
+					{
+						return false;
+					}
+				}
+				return true;
+			};
+
+			// 片側の範囲を追加する
+			auto Emit = [&OutResult](ESequenceSide Side, const FSequenceDiff& Diff, const FSequenceDiff& OtherDiff, std::int32_t Begin, std::int32_t End, bool bSameChange)
+			{
+				for (std::int32_t Index = Begin; Index < End; ++Index)
+				{
+					const std::int32_t MovedFrom = Diff.OtherMovedFrom[Index];
+					if (MovedFrom >= 0)
+					{
+						if (OtherDiff.IsDeleted(MovedFrom))
+						{
+							// 移動した要素を、もう片側が削除した
+							continue;
+						}
+						if (OtherDiff.BaseMovedTo[MovedFrom] >= 0 && !bSameChange)
+						{
+							// 両側が同じ要素を別々の位置に移動した
+							OutResult.bConflict = true;
+						}
+					}
+					OutResult.Items.push_back(FSequenceItem{ Side, Index });
+				}
+			};
+
+			std::int32_t BaseBegin = 0;
+			std::int32_t LeftBegin = 0;
+			std::int32_t RightBegin = 0;
+			for (std::int32_t Sync = 0; Sync <= BaseNum; ++Sync)
+			{
+				const bool bEnd = (Sync == BaseNum);
+				if (!bEnd && (LeftDiff.BaseToOther[Sync] < 0 || RightDiff.BaseToOther[Sync] < 0))
+				{
+					continue;
+				}
+
+				const std::int32_t LeftEnd = bEnd ? LeftNum : LeftDiff.BaseToOther[Sync];
+				const std::int32_t RightEnd = bEnd ? RightNum : RightDiff.BaseToOther[Sync];
+
+				const bool bLeftUnchanged = IsUnchanged(LeftDiff, BaseBegin, Sync, LeftBegin, LeftEnd);
+				const bool bRightUnchanged = IsUnchanged(RightDiff, BaseBegin, Sync, RightBegin, RightEnd);
+				if (bLeftUnchanged)
+				{
+					OutResult.bRightChanged |= !bRightUnchanged;
+					Emit(ESequenceSide::Right, RightDiff, LeftDiff, RightBegin, RightEnd, false);
+				}
+				else if (bRightUnchanged)
+				{
+					OutResult.bLeftChanged = true;
+					Emit(ESequenceSide::Left, LeftDiff, RightDiff, LeftBegin, LeftEnd, false);
+				}
+				else
+				{
+					OutResult.bLeftChanged = true;
+					OutResult.bRightChanged = true;
+
+					bool bSameChange = (LeftEnd - LeftBegin == RightEnd - RightBegin);
+					for (std::int32_t Offset = 0; bSameChange && Offset < LeftEnd - LeftBegin; ++Offset)
+					{
+						bSameChange = IsSame(LeftBegin + Offset, RightBegin + Offset);
+					}
+
+					if (!bSameChange)
+					{
+						OutResult.bConflict = true;
+					}
+					Emit(ESequenceSide::Left, LeftDiff, RightDiff, LeftBegin, LeftEnd, bSameChange);
+				}
+
+				if (!bEnd)
+				{
+					// 同期点の要素は 3 つとも等しい
+					OutResult.Items.push_back(FSequenceItem{ ESequenceSide::Left, LeftEnd });
+				}
+
+				BaseBegin = Sync + 1;
+				LeftBegin = LeftEnd + 1;
+				RightBegin = RightEnd + 1;
+			}
+		}
+	}
+}
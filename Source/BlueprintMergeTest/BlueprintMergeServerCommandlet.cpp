@@ -0,0 +1,313 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeServerCommandlet.h"
+#include "BlueprintMergeLibrary.h"
+#include "BlueprintPropertySchema.h"
+#include "BlueprintGraphHash.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "AssetToolsModule.h"
+#include "Sockets.h"
+#include "SocketSubsystem.h"
+#include "IPAddress.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Guid.h"
+#include "Misc/PackageName.h"
+#include "Misc/Paths.h"
+#include "HAL/FileManager.h"
+#include "HAL/PlatformProcess.h"
+
+#if PLATFORM_UNIX || PLATFORM_MAC
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+
+UBlueprintMergeServerCommandlet::UBlueprintMergeServerCommandlet()
+{
+	IsClient = false;
+	IsServer = false;
+	IsEditor = true;
+	LogToConsole = true;
+	ShowErrorCount = false;
+}
+
+int32 UBlueprintMergeServerCommandlet::Main(const FString& Params)
+{
+	int32 Port = DefaultPort;
+	FParse::Value(*Params, TEXT("Port="), Port);
+
+	// ジョブごとに読み込まないように、モジュールとアセットレジストリを先に準備しておく
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry")).Get();
+	AssetRegistry.SearchAllAssets(true);
+	FModuleManager::LoadModuleChecked<FAssetToolsModule>("AssetTools");
+	FBlueprintPropertySchemaCache::Get();
+
+	ISocketSubsystem* SocketSubsystem = ISocketSubsystem::Get(PLATFORM_SOCKETSUBSYSTEM);
+	TSharedRef<FInternetAddr> Address = SocketSubsystem->CreateInternetAddr();
+	Address->SetLoopbackAddress();
+	Address->SetPort(Port);
+
+	// 外部から接続されないように、ループバックアドレスでのみ待ち受ける
+	FSocket* ListenSocket = SocketSubsystem->CreateSocket(NAME_Stream, TEXT("BlueprintMergeServer"), Address->GetProtocolType());
+	if (!ListenSocket || !ListenSocket->Bind(*Address) || !ListenSocket->Listen(8))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to listen. Port[%d]"), Port);
+		if (ListenSocket)
+		{
+			SocketSubsystem->DestroySocket(ListenSocket);
+		}
+		return 1;
+	}
+
+	// 起動ごとのトークンを、本人だけが読めるファイルに書き出す
+	FString TokenFilename = FPaths::Combine(FPlatformProcess::UserSettingsDir(), TEXT("BlueprintMergeServer"), FString::Printf(TEXT("Port%d.token"), Port));
+	FParse::Value(*Params, TEXT("TokenFile="), TokenFilename);
+	TokenFilename = FPaths::ConvertRelativePathToFull(FPaths::LaunchDir(), TokenFilename);
+
+	const FString Token = FGuid::NewGuid().ToString(EGuidFormats::Digits) + FGuid::NewGuid().ToString(EGuidFormats::Digits);
+	if (!WriteTokenFile(TokenFilename, Token))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Failed to write the session token. TokenFile[%s]"), *TokenFilename);
+		ListenSocket->Close();
+		SocketSubsystem->DestroySocket(ListenSocket);
+		return 1;
+	}
+
+	UE_LOG(LogTemp, Display, TEXT("Blueprint merge server is listening. Port[%d] TokenFile[%s]"), Port, *TokenFilename);
+
+	bool bQuit = false;
+	while (!bQuit && !IsEngineExitRequested())
+	{
+		bool bHasPendingConnection = false;
+		if (!ListenSocket->WaitForPendingConnection(bHasPendingConnection, FTimespan::FromSeconds(1.0)) || !bHasPendingConnection)
+		{
+			continue;
+		}
+
+		FSocket* Client = ListenSocket->Accept(TEXT("BlueprintMergeClient"));
+		if (!Client)
+		{
+			continue;
+		}
+
+		bQuit = ServeClient(*Client, Token);
+		Client->Close();
+		SocketSubsystem->DestroySocket(Client);
+	}
+
+	ListenSocket->Close();
+	SocketSubsystem->DestroySocket(ListenSocket);
+	IFileManager::Get().Delete(*TokenFilename, false, true, true);
+	return 0;
+}
+
+bool UBlueprintMergeServerCommandlet::ServeClient(FSocket& Client, const FString& Token)
+{
+	TArray<uint8> Buffer;
+	FString Line;
+
+	// 最初の行でトークンを確かめ、一致しなければ何も実行せずに切断する
+	if (!ReceiveLine(Client, Buffer, Line))
+	{
+		return false;
+	}
+
+	FString Command;
+	FString ClientToken;
+	Line.TrimStartAndEndInline();
+	if (!Line.Split(TEXT("\t"), &Command, &ClientToken) || Command != TEXT("auth") || !TokensMatch(Token, ClientToken))
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Rejected a client without a valid session token."));
+		return false;
+	}
+	SendLine(Client, TEXT("auth\tok"));
+
+	while (ReceiveLine(Client, Buffer, Line))
+	{
+		Line.TrimStartAndEndInline();
+		if (Line.IsEmpty())
+		{
+			continue;
+		}
+
+		if (Line.Equals(TEXT("quit"), ESearchCase::IgnoreCase))
+		{
+			return true;
+		}
+
+		RunJob(Client, Line);
+	}
+	return false;
+}
+
+void UBlueprintMergeServerCommandlet::RunJob(FSocket& Client, const FString& Request)
+{
+	TArray<FString> Fields;
+	Request.ParseIntoArray(Fields, TEXT("\t"), false);
+	if (Fields.Num() < 4)
+	{
+		UE_LOG(LogTemp, Error, TEXT("Invalid request. Request[%s]"), *Request);
+		SendLine(Client, TEXT("result\terror"));
+		return;
+	}
+
+	for (int32 Index = 0; Index < 4; ++Index)
+	{
+		if (!IsAllowedJobPath(Fields[Index]))
+		{
+			UE_LOG(LogTemp, Error, TEXT("Job path must be an absolute path under the project or a content root. Path[%s]"), *Fields[Index]);
+			SendLine(Client, TEXT("result\terror"));
+			return;
+		}
+	}
+
+	const FString PackageName = Fields.IsValidIndex(4) ? Fields[4] : FString();
+	if (!PackageName.IsEmpty() && !FPackageName::IsValidLongPackageName(PackageName))
+	{
+		UE_LOG(LogTemp, Error, TEXT("Invalid package name. Package[%s]"), *PackageName);
+		SendLine(Client, TEXT("result\terror"));
+		return;
+	}
+
+	FBlueprintMergePlan Plan;
+	const EBlueprintMergeResult Result = UBlueprintMergeLibrary::MergeBlueprintFiles(Fields[0], Fields[1], Fields[2], Fields[3], PackageName, Plan);
+
+	for (const FBlueprintMergePlanEntry& Entry : Plan.Entries)
+	{
+		if (Entry.Action == EBlueprintMergePlanAction::Conflict)
+		{
+			SendLine(Client, FString::Printf(TEXT("conflict\t%s\t%s"), *UEnum::GetDisplayValueAsText(Entry.Category).ToString(), *Entry.Path));
+		}
+	}
+
+	switch (Result)
+	{
+	case EBlueprintMergeResult::Clean:
+		SendLine(Client, TEXT("result\tclean"));
+		break;
+	case EBlueprintMergeResult::Conflict:
+		SendLine(Client, TEXT("result\tconflict"));
+		break;
+	default:
+		SendLine(Client, TEXT("result\terror"));
+		break;
+	}
+
+	// 読み込んだパッケージはジョブごとに破棄する
+	// キャッシュは破棄したクラスやパッケージを指しているので、一緒に空にする
+	FBlueprintPropertySchemaCache::Get().InvalidateAll();
+	FBlueprintGraphHashCache::Get().Empty();
+	CollectGarbage(GARBAGE_COLLECTION_KEEPFLAGS);
+}
+
+bool UBlueprintMergeServerCommandlet::ReceiveLine(FSocket& Socket, TArray<uint8>& InOutBuffer, FString& OutLine)
+{
+	while (true)
+	{
+		const int32 NewLineIndex = InOutBuffer.Find('\n');
+		if (NewLineIndex != INDEX_NONE)
+		{
+			OutLine = FString(FUTF8ToTCHAR(reinterpret_cast<const ANSICHAR*>(InOutBuffer.GetData()), NewLineIndex));
+			InOutBuffer.RemoveAt(0, NewLineIndex + 1, EAllowShrinking::No);
+			return true;
+		}
+
+		uint8 Data[1024];
+		int32 BytesRead = 0;
+		if (!Socket.Recv(Data, sizeof(Data), BytesRead) || BytesRead <= 0)
+		{
+			return false;
+		}
+		InOutBuffer.Append(Data, BytesRead);
+	}
+}
+
+bool UBlueprintMergeServerCommandlet::SendLine(FSocket& Socket, const FString& Line)
+{
+	const FTCHARToUTF8 Utf8Line(*(Line + TEXT("\n")));
+	const uint8* Data = reinterpret_cast<const uint8*>(Utf8Line.Get());
+	int32 Remaining = Utf8Line.Length();
+	while (Remaining > 0)
+	{
+		int32 BytesSent = 0;
+		if (!Socket.Send(Data, Remaining, BytesSent) || BytesSent <= 0)
+		{
+			return false;
+		}
+		Data += BytesSent;
+		Remaining -= BytesSent;
+	}
+	return true;
+}
+
+bool UBlueprintMergeServerCommandlet::WriteTokenFile(const FString& Filename, const FString& Token)
+{
+	IFileManager::Get().MakeDirectory(*FPaths::GetPath(Filename), true);
+
+#if PLATFORM_UNIX || PLATFORM_MAC
+	// 書き込む前に権限を 0600 にして、他のユーザーが読める瞬間を作らない
+	const FTCHARToUTF8 Utf8Filename(*Filename);
+	const int32 File = open(Utf8Filename.Get(), O_WRONLY | O_CREAT | O_TRUNC, S_IRUSR | S_IWUSR);
+	if (File < 0)
+	{
+		return false;
+	}
+
+	const FTCHARToUTF8 Utf8Token(*Token);
+	const bool bWritten = fchmod(File, S_IRUSR | S_IWUSR) == 0 && write(File, Utf8Token.Get(), Utf8Token.Length()) == Utf8Token.Length();
+	close(File);
+	return bWritten;
+#else
+	// Windows のユーザー設定のディレクトリ (LocalAppData) は、既定で本人だけがアクセスできる
+	return FFileHelper::SaveStringToFile(Token, *Filename, FFileHelper::EEncodingOptions::ForceUTF8WithoutBOM);
+#endif
+}
+
+bool UBlueprintMergeServerCommandlet::TokensMatch(const FString& Expected, const FString& Actual)
+{
+	if (Expected.Len() != Actual.Len())
+	{
+		return false;
+	}
+
+	uint32 Difference = 0;
+	for (int32 Index = 0; Index < Expected.Len(); ++Index)
+	{
+		Difference |= static_cast<uint32>(Expected[Index] ^ Actual[Index]);
+	}
+	return Difference == 0;
+}
+
+bool UBlueprintMergeServerCommandlet::IsAllowedJobPath(const FString& Filename)
+{
+	if (Filename.IsEmpty() || FPaths::IsRelative(Filename))
+	{
+		return false;
+	}
+
+	// ".." を畳んでから、ルートの下にあるか確かめる
+	FString FullPath = FPaths::ConvertRelativePathToFull(Filename);
+	FPaths::NormalizeFilename(FullPath);
+
+	TArray<FString> Roots;
+	Roots.Add(FPaths::ConvertRelativePathToFull(FPaths::ProjectDir()));
+
+	TArray<FString> RootPackagePaths;
+	FPackageName::QueryRootContentPaths(RootPackagePaths);
+	for (const FString& RootPackagePath : RootPackagePaths)
+	{
+		FString RootFilename;
+		if (FPackageName::TryConvertLongPackageNameToFilename(RootPackagePath, RootFilename))
+		{
+			Roots.Add(FPaths::ConvertRelativePathToFull(RootFilename));
+		}
+	}
+
+	return Roots.ContainsByPredicate([&FullPath](FString Root)
+	{
+		FPaths::NormalizeDirectoryName(Root);
+		return FPaths::IsUnderDirectory(FullPath, Root);
+	});
+}
@@ -0,0 +1,58 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Commandlets/Commandlet.h"
+#include "BlueprintMergeServerCommandlet.generated.h"
+
+class FSocket;
+struct FBlueprintMergePlan;
+
+/**
+ * マージのジョブを受け付け続けるサーバー
+ * エンジンの起動を一度で済ませるため、ローカルの TCP ポートでジョブを受け付ける
+ *
+ * UnrealEditor-Cmd <Project>.uproject -run=BlueprintMergeServer [-Port=<port>] [-TokenFile=<path>] -nullrhi -unattended
+ *
+ * 同じマシンの他のユーザーやプロセスからジョブを送れないように、起動ごとにトークンを作り、
+ * 本人だけが読めるファイル (既定はユーザー設定のディレクトリの BlueprintMergeServer/Port<port>.token) に書き出す
+ * 接続したら最初に "auth\t<token>" を送る (応答は "auth\tok"。一致しない場合は切断する)
+ *
+ * 要求 (1 行 1 ジョブ、タブ区切り): <base>\t<left>\t<right>\t<output>[\t<package>]
+ * ファイルは絶対パスで、プロジェクトかコンテンツのルートの下にあること (それ以外は error を返す)
+ * 応答: コンフリクトごとに "conflict\t<category>\t<path>"、最後に "result\t<clean|conflict|error>"
+ * "quit" を送るとサーバーを終了する
+ */
+UCLASS()
+class BLUEPRINTMERGETEST_API UBlueprintMergeServerCommandlet : public UCommandlet
+{
+	GENERATED_BODY()
+
+public:
+	UBlueprintMergeServerCommandlet();
+
+	virtual int32 Main(const FString& Params) override;
+
+private:
+	// クライアントの要求を処理する (quit を受け取った場合は true を返す)
+	bool ServeClient(FSocket& Client, const FString& Token);
+
+	// 1 つのジョブを処理して結果を返す
+	void RunJob(FSocket& Client, const FString& Request);
+
+	// 1 行受信する (接続が切れた場合は false を返す)
+	static bool ReceiveLine(FSocket& Socket, TArray<uint8>& InOutBuffer, FString& OutLine);
+	static bool SendLine(FSocket& Socket, const FString& Line);
+
+	// 本人だけが読み書きできるファイルにトークンを書き出す
+	static bool WriteTokenFile(const FString& Filename, const FString& Token);
+
+	// 長さが同じなら、一致した位置によらず同じ時間で比べる
+	static bool TokensMatch(const FString& Expected, const FString& Actual);
+
+	// ジョブのファイルが、プロジェクトかコンテンツのルートの下の絶対パスか
+	static bool IsAllowedJobPath(const FString& Filename);
+
+	static constexpr int32 DefaultPort = 8930;
+};
@@ -0,0 +1,66 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintMergeStats.h"
+
+
+UE_TRACE_CHANNEL_DEFINE(BlueprintMergeChannel);
+
+DEFINE_STAT(STAT_BlueprintMerge_Analyze);
+DEFINE_STAT(STAT_BlueprintMerge_BuildPropertyMap);
+DEFINE_STAT(STAT_BlueprintMerge_DiffProperties);
+DEFINE_STAT(STAT_BlueprintMerge_DiffComponents);
+DEFINE_STAT(STAT_BlueprintMerge_DiffGraphs);
+DEFINE_STAT(STAT_BlueprintMerge_Duplicate);
+DEFINE_STAT(STAT_BlueprintMerge_MergeVariables);
+DEFINE_STAT(STAT_BlueprintMerge_MergeComponents);
+DEFINE_STAT(STAT_BlueprintMerge_MergeFunctionGraphs);
+DEFINE_STAT(STAT_BlueprintMerge_MergeEventGraphs);
+DEFINE_STAT(STAT_BlueprintMerge_MergeMacroGraphs);
+DEFINE_STAT(STAT_BlueprintMerge_MergeDelegateGraphs);
+DEFINE_STAT(STAT_BlueprintMerge_MergeUbergraphs);
+DEFINE_STAT(STAT_BlueprintMerge_Compile);
+DEFINE_STAT(STAT_BlueprintMerge_ApplyDefaultValues);
+DEFINE_STAT(STAT_BlueprintMerge_ResolveReferences);
+DEFINE_STAT(STAT_BlueprintMerge_Commit);
+
+DEFINE_STAT(STAT_BlueprintMerge_PropertiesVisited);
+DEFINE_STAT(STAT_BlueprintMerge_FNamesCreated);
+DEFINE_STAT(STAT_BlueprintMerge_MapsBuilt);
+DEFINE_STAT(STAT_BlueprintMerge_IdenticalCalls);
+DEFINE_STAT(STAT_BlueprintMerge_ObjectsDuplicated);
+DEFINE_STAT(STAT_BlueprintMerge_ArenaBlocks);
+
+TRACE_DECLARE_ATOMIC_INT_COUNTER(BlueprintMerge_PropertiesVisited, TEXT("BlueprintMerge/PropertiesVisited"));
+TRACE_DECLARE_ATOMIC_INT_COUNTER(BlueprintMerge_FNamesCreated, TEXT("BlueprintMerge/FNamesCreated"));
+TRACE_DECLARE_ATOMIC_INT_COUNTER(BlueprintMerge_MapsBuilt, TEXT("BlueprintMerge/MapsBuilt"));
+TRACE_DECLARE_ATOMIC_INT_COUNTER(BlueprintMerge_IdenticalCalls, TEXT("BlueprintMerge/IdenticalCalls"));
+TRACE_DECLARE_ATOMIC_INT_COUNTER(BlueprintMerge_ObjectsDuplicated, TEXT("BlueprintMerge/ObjectsDuplicated"));
+TRACE_DECLARE_ATOMIC_INT_COUNTER(BlueprintMerge_ArenaBlocks, TEXT("BlueprintMerge/ArenaBlocks"));
+
+std::atomic<uint64> FBlueprintMergePhaseTimes::Cycles[static_cast<int32>(EBlueprintMergePhase::Num)] = {};
+
+void FBlueprintMergePhaseTimes::Reset()
+{
+	for (std::atomic<uint64>& PhaseCycles : Cycles)
+	{
+		PhaseCycles.store(0, std::memory_order_relaxed);
+	}
+}
+
+double FBlueprintMergePhaseTimes::GetMilliseconds(EBlueprintMergePhase Phase)
+{
+	if (Phase >= EBlueprintMergePhase::Num)
+	{
+		return 0.0;
+	}
+	return FPlatformTime::ToMilliseconds64(Cycles[static_cast<int32>(Phase)].load(std::memory_order_relaxed));
+}
+
+void FBlueprintMergePhaseTimes::AddCycles(EBlueprintMergePhase Phase, uint64 PhaseCycles)
+{
+	if (Phase < EBlueprintMergePhase::Num)
+	{
+		Cycles[static_cast<int32>(Phase)].fetch_add(PhaseCycles, std::memory_order_relaxed);
+	}
+}
@@ -0,0 +1,128 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "Stats/Stats.h"
+#include "Trace/Trace.h"
+#include "ProfilingDebugging/CpuProfilerTrace.h"
+#include "ProfilingDebugging/CountersTrace.h"
+#include <atomic>
+
+// マージの計測用のトレースチャンネル
+// Unreal Insights で -trace=cpu,counters,BlueprintMerge を指定すると有効になる
+UE_TRACE_CHANNEL_EXTERN(BlueprintMergeChannel, BLUEPRINTMERGETEST_API);
+
+DECLARE_STATS_GROUP(TEXT("BlueprintMerge"), STATGROUP_BlueprintMerge, STATCAT_Advanced);
+
+// フェーズごとの時間
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Analyze"), STAT_BlueprintMerge_Analyze, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Build Property Map"), STAT_BlueprintMerge_BuildPropertyMap, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Diff Properties"), STAT_BlueprintMerge_DiffProperties, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Diff Components"), STAT_BlueprintMerge_DiffComponents, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Diff Graphs"), STAT_BlueprintMerge_DiffGraphs, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Duplicate"), STAT_BlueprintMerge_Duplicate, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Variables"), STAT_BlueprintMerge_MergeVariables, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Components"), STAT_BlueprintMerge_MergeComponents, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Function Graphs"), STAT_BlueprintMerge_MergeFunctionGraphs, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Event Graphs"), STAT_BlueprintMerge_MergeEventGraphs, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Macro Graphs"), STAT_BlueprintMerge_MergeMacroGraphs, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Delegate Graphs"), STAT_BlueprintMerge_MergeDelegateGraphs, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Merge Ubergraphs"), STAT_BlueprintMerge_MergeUbergraphs, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Compile"), STAT_BlueprintMerge_Compile, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Apply Default Values"), STAT_BlueprintMerge_ApplyDefaultValues, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Resolve References"), STAT_BlueprintMerge_ResolveReferences, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_CYCLE_STAT_EXTERN(TEXT("Commit"), STAT_BlueprintMerge_Commit, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+
+// 処理量のカウンタ
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Properties Visited"), STAT_BlueprintMerge_PropertiesVisited, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("FNames Created"), STAT_BlueprintMerge_FNamesCreated, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Maps Built"), STAT_BlueprintMerge_MapsBuilt, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Identical Calls"), STAT_BlueprintMerge_IdenticalCalls, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Objects Duplicated"), STAT_BlueprintMerge_ObjectsDuplicated, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+DECLARE_DWORD_ACCUMULATOR_STAT_EXTERN(TEXT("Arena Blocks"), STAT_BlueprintMerge_ArenaBlocks, STATGROUP_BlueprintMerge, BLUEPRINTMERGETEST_API);
+
+// フェーズ (BLUEPRINT_MERGE_SCOPE の名前と同じ)
+enum class EBlueprintMergePhase : uint8
+{
+	Analyze,
+	BuildPropertyMap,
+	DiffProperties,
+	DiffComponents,
+	DiffGraphs,
+	Duplicate,
+	MergeVariables,
+	MergeComponents,
+	MergeFunctionGraphs,
+	MergeEventGraphs,
+	MergeMacroGraphs,
+	MergeDelegateGraphs,
+	MergeUbergraphs,
+	Compile,
+	ApplyDefaultValues,
+	ResolveReferences,
+	Commit,
+	Num,
+};
+
+// フェーズごとの時間の累計
+// stat はプログラムから読めないので、ベンチマークやテストはこちらを読む
+// 解析はワーカースレッドからも加算するので、スレッドをまたいだ合計になる
+class BLUEPRINTMERGETEST_API FBlueprintMergePhaseTimes
+{
+public:
+	static void Reset();
+
+	// 累計の時間 (ミリ秒)
+	static double GetMilliseconds(EBlueprintMergePhase Phase);
+
+	static void AddCycles(EBlueprintMergePhase Phase, uint64 Cycles);
+
+	// スコープの間の時間を加算する (Num を指定した場合は何もしない)
+	class FScope
+	{
+	public:
+		explicit FScope(EBlueprintMergePhase InPhase)
+			: Phase(InPhase)
+			, StartCycles(FPlatformTime::Cycles64())
+		{
+		}
+
+		~FScope()
+		{
+			AddCycles(Phase, FPlatformTime::Cycles64() - StartCycles);
+		}
+
+		FScope(const FScope&) = delete;
+		FScope& operator=(const FScope&) = delete;
+
+	private:
+		EBlueprintMergePhase Phase;
+		uint64 StartCycles;
+	};
+
+private:
+	static std::atomic<uint64> Cycles[static_cast<int32>(EBlueprintMergePhase::Num)];
+};
+
+// Insights のカウンタ (解析はワーカースレッドからも加算するのでアトミック)
+TRACE_DECLARE_ATOMIC_INT_COUNTER_EXTERN(BlueprintMerge_PropertiesVisited);
+TRACE_DECLARE_ATOMIC_INT_COUNTER_EXTERN(BlueprintMerge_FNamesCreated);
+TRACE_DECLARE_ATOMIC_INT_COUNTER_EXTERN(BlueprintMerge_MapsBuilt);
+TRACE_DECLARE_ATOMIC_INT_COUNTER_EXTERN(BlueprintMerge_IdenticalCalls);
+TRACE_DECLARE_ATOMIC_INT_COUNTER_EXTERN(BlueprintMerge_ObjectsDuplicated);
+TRACE_DECLARE_ATOMIC_INT_COUNTER_EXTERN(BlueprintMerge_ArenaBlocks);
+
+// フェーズの計測 (stat と Insights の両方に出し、フェーズごとの累計にも加算する)
+#define BLUEPRINT_MERGE_SCOPE(Name) \
+	SCOPE_CYCLE_COUNTER(STAT_BlueprintMerge_##Name); \
+	FBlueprintMergePhaseTimes::FScope BlueprintMergePhaseScope_##Name(EBlueprintMergePhase::Name); \
+	TRACE_CPUPROFILER_EVENT_SCOPE_ON_CHANNEL_STR("BlueprintMerge_" #Name, BlueprintMergeChannel)
+
+// カウンタの加算 (stat と Insights の両方に出す)
+#define BLUEPRINT_MERGE_COUNTER_ADD(Name, Amount) \
+	do \
+	{ \
+		INC_DWORD_STAT_BY(STAT_BlueprintMerge_##Name, Amount); \
+		TRACE_COUNTER_ADD(BlueprintMerge_##Name, Amount); \
+	} while (0)
@@ -10,12 +10,16 @@ public class BlueprintMergeTest : ModuleRules
 	
 		PublicDependencyModuleNames.AddRange(new string[] { "Core", "CoreUObject", "Engine", "InputCore", "EnhancedInput" });
 
-		PrivateDependencyModuleNames.AddRange(new string[] { });
+		PrivateDependencyModuleNames.AddRange(new string[] { "Sockets", "Networking" });
+
+		// アセット参照の解決ルールの std::regex が、不正なパターンで例外を投げるため
+		bEnableExceptions = true;
 
 		if (Target.Type == TargetType.Editor)
 		{
 			PublicDependencyModuleNames.Add("UnrealEd");
 			PublicDependencyModuleNames.Add("AssetTools");
+			PublicDependencyModuleNames.Add("BlueprintGraph");
 
 		}
 
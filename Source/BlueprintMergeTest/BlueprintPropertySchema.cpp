@@ -0,0 +1,418 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintPropertySchema.h"
+#include "BlueprintMergePath.h"
+#include "BlueprintMergeStats.h"
+#include "Editor.h"
+#include "Misc/ScopeRWLock.h"
+#include "UObject/UObjectGlobals.h"
+
+
+namespace
+{
+	bool IsSkippedProperty(const FProperty* Property)
+	{
+		// Transient プロパティはスキップ
+		return Property->HasAnyPropertyFlags(CPF_Transient) ||
+			Property->HasAnyPropertyFlags(CPF_EditConst);
+	}
+
+	bool IsCompositeProperty(const FProperty* Property)
+	{
+		return Property->IsA<FArrayProperty>() ||
+			Property->IsA<FMapProperty>() ||
+			Property->IsA<FSetProperty>() ||
+			Property->IsA<FStructProperty>();
+	}
+
+	bool IsDynamicContainerProperty(const FProperty* Property)
+	{
+		return Property->IsA<FArrayProperty>() ||
+			Property->IsA<FMapProperty>() ||
+			Property->IsA<FSetProperty>();
+	}
+
+	// バイト列が一致すれば Identical も一致するプロパティ
+	bool IsPlainOldDataProperty(const FProperty* Property)
+	{
+		if (const FBoolProperty* BoolProperty = CastField<FBoolProperty>(Property))
+		{
+			// ビットフィールドは他のプロパティとバイトを共有するので除外する
+			return BoolProperty->IsNativeBool();
+		}
+
+		return Property->IsA<FNumericProperty>() ||
+			Property->IsA<FEnumProperty>() ||
+			Property->IsA<FNameProperty>();
+	}
+
+	void VisitElementValue(const FProperty* Property, const void* Value, const FName& Path, bool bIncludeCompositeType, FBlueprintPropertySchema::FVisitFunc Func);
+
+	// 動的なコンテナの要素を展開する
+	void VisitContainerElements(const FProperty* Property, const void* Value, const FName& Path, bool bIncludeCompositeType, FBlueprintPropertySchema::FVisitFunc Func)
+	{
+		if (const FArrayProperty* ArrayProperty = CastField<FArrayProperty>(Property))
+		{
+			FScriptArrayHelper ArrayHelper(ArrayProperty, Value);
+			for (int32 Index = 0; Index < ArrayHelper.Num(); ++Index)
+			{
+				VisitElementValue(ArrayProperty->Inner, ArrayHelper.GetRawPtr(Index), FBlueprintMergePathTable::MakePath(Path, NAME_None, Index), bIncludeCompositeType, Func);
+			}
+		}
+		else if (const FSetProperty* SetProperty = CastField<FSetProperty>(Property))
+		{
+			FScriptSetHelper SetHelper(SetProperty, Value);
+			for (int32 Index = 0, Count = 0; Count < SetHelper.Num(); ++Index)
+			{
+				if (!SetHelper.IsValidIndex(Index))
+				{
+					continue;
+				}
+
+				VisitElementValue(SetProperty->ElementProp, SetHelper.GetElementPtr(Index), FBlueprintMergePathTable::MakePath(Path, NAME_None, Count), bIncludeCompositeType, Func);
+				++Count;
+			}
+		}
+		else if (const FMapProperty* MapProperty = CastField<FMapProperty>(Property))
+		{
+			FScriptMapHelper MapHelper(MapProperty, Value);
+			for (int32 Index = 0, Count = 0; Count < MapHelper.Num(); ++Index)
+			{
+				if (!MapHelper.IsValidIndex(Index))
+				{
+					continue;
+				}
+
+				static const FName KeyName(TEXT("Key"));
+				static const FName ValueName(TEXT("Value"));
+
+				const FName EntryPath = FBlueprintMergePathTable::MakePath(Path, NAME_None, Count);
+				VisitElementValue(MapProperty->KeyProp, MapHelper.GetKeyPtr(Index), FBlueprintMergePathTable::MakePath(EntryPath, KeyName), bIncludeCompositeType, Func);
+				VisitElementValue(MapProperty->ValueProp, MapHelper.GetValuePtr(Index), FBlueprintMergePathTable::MakePath(EntryPath, ValueName), bIncludeCompositeType, Func);
+				++Count;
+			}
+		}
+	}
+
+	// 動的なコンテナの 1 要素を列挙する
+	void VisitElementValue(const FProperty* Property, const void* Value, const FName& Path, bool bIncludeCompositeType, FBlueprintPropertySchema::FVisitFunc Func)
+	{
+		const bool bCompositeType = IsCompositeProperty(Property);
+		if (!IsSkippedProperty(Property) && (!bCompositeType || bIncludeCompositeType))
+		{
+			Func(Path, Property, Value, INDEX_NONE);
+		}
+
+		if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+		{
+			// 構造体の中は、要素のパスをプレフィックスとしてスキーマを使う
+			TSharedRef<const FBlueprintPropertySchema> Schema = FBlueprintPropertySchemaCache::Get().FindOrAdd(StructProperty->Struct);
+			Schema->ForEachValue(Value, bIncludeCompositeType, Func, &Path);
+		}
+		else if (IsDynamicContainerProperty(Property))
+		{
+			VisitContainerElements(Property, Value, Path, bIncludeCompositeType, Func);
+		}
+	}
+}
+
+FBlueprintPropertySchema::FBlueprintPropertySchema(const UStruct* InStruct)
+{
+	ChildProperties = InStruct->ChildProperties;
+	PropertyLink = InStruct->PropertyLink;
+	PropertiesSize = InStruct->GetPropertiesSize();
+
+	BuildEntries(InStruct, INDEX_NONE, 0, FString());
+	BuildPodRuns();
+}
+
+bool FBlueprintPropertySchema::IsUpToDate(const UStruct* InStruct) const
+{
+	return InStruct &&
+		ChildProperties == InStruct->ChildProperties &&
+		PropertyLink == InStruct->PropertyLink &&
+		PropertiesSize == InStruct->GetPropertiesSize();
+}
+
+void FBlueprintPropertySchema::BuildEntries(const UStruct* InStruct, int32 ParentIndex, int32 ParentOffset, const FString& ParentPath)
+{
+	for (TFieldIterator<FProperty> It(InStruct, EFieldIteratorFlags::IncludeSuper, EFieldIteratorFlags::IncludeDeprecated); It; ++It)
+	{
+		const FProperty* Property = *It;
+		for (int32 ArrayIndex = 0; ArrayIndex < Property->GetArrayDim(); ++ArrayIndex)
+		{
+			// PropertyA.PropertyB.PropertyC... という形式にする
+			FString Path = ParentPath.IsEmpty() ? Property->GetName() : ParentPath + TEXT(".") + Property->GetName();
+			if (Property->GetArrayDim() > 1)
+			{
+				Path += FString::Printf(TEXT("[%d]"), ArrayIndex);
+			}
+
+			const int32 EntryIndex = Entries.AddDefaulted();
+			FBlueprintPropertySchemaEntry& Entry = Entries[EntryIndex];
+			Entry.Property = Property;
+			Entry.PathString = Path;
+			Entry.ParentIndex = ParentIndex;
+			Entry.ArrayIndex = ArrayIndex;
+			Entry.Offset = ParentOffset + Property->GetOffset_ForInternal() + Property->GetElementSize() * ArrayIndex;
+			Entry.Size = Property->GetElementSize();
+			Entry.bSkip = IsSkippedProperty(Property);
+			Entry.bCompositeType = IsCompositeProperty(Property);
+			Entry.bDynamicContainer = IsDynamicContainerProperty(Property);
+			Entry.bPlainOldData = IsPlainOldDataProperty(Property);
+			Entry.bIsGuid = Path.Contains(TEXT("GUID"), ESearchCase::IgnoreCase);
+
+			// 構造体のメンバーは静的に展開できる
+			if (const FStructProperty* StructProperty = CastField<FStructProperty>(Property))
+			{
+				const int32 StructOffset = Entry.Offset;
+				BuildEntries(StructProperty->Struct, EntryIndex, StructOffset, Path);
+			}
+
+			// 再帰で Entries が再確保されるので、インデックスで書き込む
+			Entries[EntryIndex].SubtreeEnd = Entries.Num();
+		}
+	}
+}
+
+FName FBlueprintPropertySchema::MakeEntryPath(int32 EntryIndex, const FName* Prefix) const
+{
+	// 親をたどってから、先頭から順にキーを作る
+	TArray<int32, TInlineAllocator<8>> Chain;
+	for (int32 Index = EntryIndex; Index != INDEX_NONE; Index = Entries[Index].ParentIndex)
+	{
+		Chain.Add(Index);
+	}
+
+	FName Path = Prefix ? *Prefix : NAME_None;
+	for (int32 ChainIndex = Chain.Num() - 1; ChainIndex >= 0; --ChainIndex)
+	{
+		Path = MakeChildPath(Entries[Chain[ChainIndex]], Path);
+	}
+	return Path;
+}
+
+FName FBlueprintPropertySchema::MakeChildPath(const FBlueprintPropertySchemaEntry& Entry, const FName& ParentPath)
+{
+	// 最上位のプロパティは、テーブルに登録せずにプロパティの名前をそのまま使う
+	const int32 ArrayIndex = Entry.Property->GetArrayDim() > 1 ? Entry.ArrayIndex : INDEX_NONE;
+	if (ParentPath.IsNone() && ArrayIndex == INDEX_NONE)
+	{
+		return Entry.Property->GetFName();
+	}
+	return FBlueprintMergePathTable::MakePath(ParentPath, Entry.Property->GetFName(), ArrayIndex);
+}
+
+void FBlueprintPropertySchema::ForEachValue(const void* Container, bool bIncludeCompositeType, FVisitFunc Func, const FName* Prefix) const
+{
+	// 親の値のアドレスとパスを覚えておき、メンバーのコンテナとパスに使う
+	TArray<const void*, TInlineAllocator<128>> ValuePtrs;
+	TArray<FName, TInlineAllocator<128>> Paths;
+	ValuePtrs.SetNumUninitialized(Entries.Num());
+	Paths.SetNum(Entries.Num());
+
+	const FName RootPath = Prefix ? *Prefix : NAME_None;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		const FBlueprintPropertySchemaEntry& Entry = Entries[Index];
+		const bool bTopLevel = Entry.ParentIndex == INDEX_NONE;
+		const void* ParentPtr = bTopLevel ? Container : ValuePtrs[Entry.ParentIndex];
+		const void* ValuePtr = Entry.Property->ContainerPtrToValuePtr<void>(ParentPtr, Entry.ArrayIndex);
+		ValuePtrs[Index] = ValuePtr;
+		Paths[Index] = MakeChildPath(Entry, bTopLevel ? RootPath : Paths[Entry.ParentIndex]);
+		VisitEntry(Index, ValuePtr, bIncludeCompositeType, Func, Paths[Index], Prefix != nullptr);
+	}
+}
+
+void FBlueprintPropertySchema::ForEachSubtreeValue(int32 EntryIndex, const void* Value, bool bIncludeCompositeType, FVisitFunc Func, const FName* Prefix) const
+{
+	const int32 SubtreeEnd = Entries[EntryIndex].SubtreeEnd;
+
+	// 子孫の値とパスは、部分木の先頭からの相対インデックスで覚えておく
+	TArray<const void*, TInlineAllocator<32>> ValuePtrs;
+	TArray<FName, TInlineAllocator<32>> Paths;
+	ValuePtrs.SetNumUninitialized(SubtreeEnd - EntryIndex);
+	Paths.SetNum(SubtreeEnd - EntryIndex);
+	ValuePtrs[0] = Value;
+	Paths[0] = MakeEntryPath(EntryIndex, Prefix);
+	VisitEntry(EntryIndex, Value, bIncludeCompositeType, Func, Paths[0], Prefix != nullptr);
+
+	for (int32 Index = EntryIndex + 1; Index < SubtreeEnd; ++Index)
+	{
+		const FBlueprintPropertySchemaEntry& Entry = Entries[Index];
+		const int32 ParentOffset = Entry.ParentIndex - EntryIndex;
+		const void* ValuePtr = Entry.Property->ContainerPtrToValuePtr<void>(ValuePtrs[ParentOffset], Entry.ArrayIndex);
+		ValuePtrs[Index - EntryIndex] = ValuePtr;
+		Paths[Index - EntryIndex] = MakeChildPath(Entry, Paths[ParentOffset]);
+		VisitEntry(Index, ValuePtr, bIncludeCompositeType, Func, Paths[Index - EntryIndex], Prefix != nullptr);
+	}
+}
+
+void FBlueprintPropertySchema::ForEachElementValue(const FProperty* Property, const void* Value, const FName& Path, bool bIncludeCompositeType, FVisitFunc Func)
+{
+	VisitElementValue(Property, Value, Path, bIncludeCompositeType, Func);
+}
+
+void FBlueprintPropertySchema::VisitEntry(int32 Index, const void* ValuePtr, bool bIncludeCompositeType, FVisitFunc Func, const FName& Path, bool bPrefixed) const
+{
+	const FBlueprintPropertySchemaEntry& Entry = Entries[Index];
+	const bool bVisit = !Entry.bSkip && (!Entry.bCompositeType || bIncludeCompositeType);
+	if (!bVisit && !Entry.bDynamicContainer)
+	{
+		return;
+	}
+
+	if (bVisit)
+	{
+		Func(Path, Entry.Property, ValuePtr, bPrefixed ? INDEX_NONE : Index);
+	}
+
+	if (Entry.bDynamicContainer)
+	{
+		VisitContainerElements(Entry.Property, ValuePtr, Path, bIncludeCompositeType, Func);
+	}
+}
+
+void FBlueprintPropertySchema::BuildPodRuns()
+{
+	TArray<int32> PodEntryIndices;
+	for (int32 Index = 0; Index < Entries.Num(); ++Index)
+	{
+		const FBlueprintPropertySchemaEntry& Entry = Entries[Index];
+		if (Entry.bPlainOldData && !Entry.bSkip)
+		{
+			PodEntryIndices.Add(Index);
+		}
+	}
+
+	PodEntryIndices.Sort([this](int32 A, int32 B)
+	{
+		return Entries[A].Offset < Entries[B].Offset;
+	});
+
+	// 隙間なく連続するプロパティを 1 つの範囲にまとめる
+	// パディングの値は不定なので、隙間がある場合は範囲を分ける
+	for (int32 EntryIndex : PodEntryIndices)
+	{
+		const FBlueprintPropertySchemaEntry& Entry = Entries[EntryIndex];
+		FBlueprintPropertySchemaPodRun* Run = PodRuns.Num() > 0 ? &PodRuns.Last() : nullptr;
+		if (!Run || Run->Offset + Run->Size != Entry.Offset)
+		{
+			Run = &PodRuns.AddDefaulted_GetRef();
+			Run->Offset = Entry.Offset;
+		}
+
+		Run->Size += Entry.Size;
+		Run->EntryIndices.Add(EntryIndex);
+		Run->Signature = HashCombine(Run->Signature, HashCombine(GetTypeHash(Entry.PathString), HashCombine(GetTypeHash(Entry.Property->GetClass()), GetTypeHash(Entry.Offset - Run->Offset))));
+	}
+
+	for (int32 RunIndex = 0; RunIndex < PodRuns.Num(); ++RunIndex)
+	{
+		PodRunIndexBySignature.Add(PodRuns[RunIndex].Signature, RunIndex);
+	}
+}
+
+void FBlueprintPropertySchema::FindIdenticalPodEntries(const void* Container, const FBlueprintPropertySchema& OtherSchema, const void* OtherContainer, TBitArray<>& OutIdenticalEntries) const
+{
+	OutIdenticalEntries.Init(false, Entries.Num());
+
+	const uint8* Bytes = static_cast<const uint8*>(Container);
+	const uint8* OtherBytes = static_cast<const uint8*>(OtherContainer);
+
+	for (const FBlueprintPropertySchemaPodRun& Run : PodRuns)
+	{
+		// 同じ構成の範囲を相手のスキーマから探す
+		const int32* OtherRunIndex = OtherSchema.PodRunIndexBySignature.Find(Run.Signature);
+		if (!OtherRunIndex)
+		{
+			continue;
+		}
+
+		const FBlueprintPropertySchemaPodRun& OtherRun = OtherSchema.PodRuns[*OtherRunIndex];
+		if (OtherRun.Size != Run.Size ||
+			OtherRun.EntryIndices.Num() != Run.EntryIndices.Num() ||
+			OtherSchema.Entries[OtherRun.EntryIndices[0]].PathString != Entries[Run.EntryIndices[0]].PathString)
+		{
+			// ハッシュの衝突
+			continue;
+		}
+
+		// 範囲全体が一致すれば、含まれるプロパティは全て一致する
+		if (FMemory::Memcmp(Bytes + Run.Offset, OtherBytes + OtherRun.Offset, Run.Size) == 0)
+		{
+			for (int32 EntryIndex : Run.EntryIndices)
+			{
+				OutIdenticalEntries[EntryIndex] = true;
+			}
+			continue;
+		}
+
+		// 範囲内のどこかが違うので、プロパティごとにバイト比較する
+		for (int32 Index = 0; Index < Run.EntryIndices.Num(); ++Index)
+		{
+			const FBlueprintPropertySchemaEntry& Entry = Entries[Run.EntryIndices[Index]];
+			const FBlueprintPropertySchemaEntry& OtherEntry = OtherSchema.Entries[OtherRun.EntryIndices[Index]];
+			if (FMemory::Memcmp(Bytes + Entry.Offset, OtherBytes + OtherEntry.Offset, Entry.Size) == 0)
+			{
+				OutIdenticalEntries[Run.EntryIndices[Index]] = true;
+			}
+		}
+	}
+}
+
+FBlueprintPropertySchemaCache& FBlueprintPropertySchemaCache::Get()
+{
+	static FBlueprintPropertySchemaCache Instance;
+	return Instance;
+}
+
+FBlueprintPropertySchemaCache::FBlueprintPropertySchemaCache()
+{
+	// コンパイルや再インスタンス化でプロパティが作り直されるので、キャッシュを破棄する
+	if (GEditor)
+	{
+		GEditor->OnBlueprintCompiled().AddRaw(this, &FBlueprintPropertySchemaCache::InvalidateAll);
+	}
+	FCoreUObjectDelegates::ReloadCompleteDelegate.AddLambda([this](EReloadCompleteReason)
+	{
+		InvalidateAll();
+	});
+}
+
+TSharedRef<const FBlueprintPropertySchema> FBlueprintPropertySchemaCache::FindOrAdd(const UStruct* Struct)
+{
+	check(Struct);
+
+	const FObjectKey Key(Struct);
+	{
+		FReadScopeLock ReadLock(Lock);
+		if (const TSharedPtr<const FBlueprintPropertySchema>* Schema = Schemas.Find(Key))
+		{
+			if ((*Schema)->IsUpToDate(Struct))
+			{
+				return Schema->ToSharedRef();
+			}
+		}
+	}
+
+	// スキーマの構築はロックの外で行う
+	TSharedRef<const FBlueprintPropertySchema> NewSchema = MakeShared<FBlueprintPropertySchema>(Struct);
+
+	FWriteScopeLock WriteLock(Lock);
+	Schemas.Add(Key, NewSchema);
+	return NewSchema;
+}
+
+void FBlueprintPropertySchemaCache::Invalidate(const UStruct* Struct)
+{
+	FWriteScopeLock WriteLock(Lock);
+	Schemas.Remove(FObjectKey(Struct));
+}
+
+void FBlueprintPropertySchemaCache::InvalidateAll()
+{
+	FWriteScopeLock WriteLock(Lock);
+	Schemas.Empty();
+}
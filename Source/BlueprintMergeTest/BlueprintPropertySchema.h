@@ -0,0 +1,142 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/ObjectKey.h"
+
+// プロパティスキーマの 1 要素
+// 構造体のメンバーは親要素の値をコンテナとして解決する
+struct FBlueprintPropertySchemaEntry
+{
+	const FProperty* Property = nullptr;
+
+	// 構造体からの相対パスの文字列 (POD の範囲の照合に使う)
+	// 差分のキーは FBlueprintPropertySchema::MakeEntryPath で作る
+	FString PathString;
+
+	// 親要素 (構造体プロパティ) のインデックス
+	int32 ParentIndex = INDEX_NONE;
+
+	// 子孫の要素の次のインデックス (子孫は [自身 + 1, SubtreeEnd) に並ぶ)
+	int32 SubtreeEnd = INDEX_NONE;
+
+	// 固定長配列のインデックス
+	int32 ArrayIndex = 0;
+
+	// コンテナの先頭からのオフセット
+	int32 Offset = 0;
+	int32 Size = 0;
+
+	// Transient / EditConst のプロパティ
+	bool bSkip = false;
+
+	// Array / Map / Set / Struct のプロパティ
+	bool bCompositeType = false;
+
+	// Array / Map / Set のプロパティ (要素はインスタンスごとに展開する)
+	bool bDynamicContainer = false;
+
+	// バイト列の比較で一致を判定できるプロパティ (数値 / bool / enum / FName)
+	bool bPlainOldData = false;
+
+	// パスに GUID を含むプロパティ (自動生成される値なので、グラフのハッシュに含めない)
+	bool bIsGuid = false;
+};
+
+// メモリ上で連続する POD プロパティの範囲
+struct FBlueprintPropertySchemaPodRun
+{
+	int32 Offset = 0;
+	int32 Size = 0;
+
+	// 範囲に含まれるエントリのインデックス (オフセット順)
+	TArray<int32> EntryIndices;
+
+	// 範囲の構成 (パス / 型 / 相対オフセット) のハッシュ
+	// 同じハッシュの範囲は、別のクラスでも同じレイアウトとして比較できる
+	uint32 Signature = 0;
+};
+
+// クラス (構造体) ごとのプロパティパスの構成
+// 同じクラスのインスタンスは同じ構成なので、パスの文字列は一度だけ作る
+// スキーマはマージをまたいで共有するので、キーは列挙するときに現在のパスのテーブルに登録する
+// 最上位のプロパティのキーはプロパティの名前そのもの (変数名としても使う)
+class FBlueprintPropertySchema
+{
+public:
+	// EntryIndex はスキーマのエントリのインデックス (動的なコンテナの要素は INDEX_NONE)
+	using FVisitFunc = TFunctionRef<void(const FName& Path, const FProperty* Property, const void* Value, int32 EntryIndex)>;
+
+	explicit FBlueprintPropertySchema(const UStruct* InStruct);
+
+	// 構築時から構造体のレイアウトが変わっていないか
+	bool IsUpToDate(const UStruct* InStruct) const;
+
+	const TArray<FBlueprintPropertySchemaEntry>& GetEntries() const
+	{
+		return Entries;
+	}
+
+	// EntryIndex のエントリのパスのキー (ForEachValue と同じもの)
+	FName MakeEntryPath(int32 EntryIndex, const FName* Prefix = nullptr) const;
+
+	// コンテナ (オブジェクトや構造体のメモリ) のプロパティの値を列挙する
+	// 動的なコンテナの要素は "Array[0]" のようなパスで展開する
+	// Prefix を指定した場合は、パスの先頭に付ける
+	// 展開したパスは現在のパスのテーブル (FBlueprintMergePathTable) に登録する
+	void ForEachValue(const void* Container, bool bIncludeCompositeType, FVisitFunc Func, const FName* Prefix = nullptr) const;
+
+	// EntryIndex のエントリとその子孫の値を列挙する (Value はエントリの値のアドレス)
+	// パスと EntryIndex は ForEachValue と同じものを渡す
+	void ForEachSubtreeValue(int32 EntryIndex, const void* Value, bool bIncludeCompositeType, FVisitFunc Func, const FName* Prefix = nullptr) const;
+
+	// 動的なコンテナの要素を、ForEachValue と同じパスで列挙する
+	static void ForEachElementValue(const FProperty* Property, const void* Value, const FName& Path, bool bIncludeCompositeType, FVisitFunc Func);
+
+	// POD の範囲をまとめてバイト比較し、一致したエントリに印を付ける
+	// OutIdenticalEntries はこのスキーマのエントリのインデックスに対応する
+	// 印が付かなかったエントリは FProperty::Identical で比較すること
+	void FindIdenticalPodEntries(const void* Container, const FBlueprintPropertySchema& OtherSchema, const void* OtherContainer, TBitArray<>& OutIdenticalEntries) const;
+
+private:
+	void BuildEntries(const UStruct* InStruct, int32 ParentIndex, int32 ParentOffset, const FString& ParentPath);
+	void BuildPodRuns();
+
+	// 親のパスのキーから、エントリのパスのキーを作る
+	static FName MakeChildPath(const FBlueprintPropertySchemaEntry& Entry, const FName& ParentPath);
+
+	// 1 つのエントリの値と、動的なコンテナの要素を列挙する
+	// プレフィックスの下のエントリは EntryIndex を INDEX_NONE として渡す
+	void VisitEntry(int32 Index, const void* ValuePtr, bool bIncludeCompositeType, FVisitFunc Func, const FName& Path, bool bPrefixed) const;
+
+	TArray<FBlueprintPropertySchemaEntry> Entries;
+	TArray<FBlueprintPropertySchemaPodRun> PodRuns;
+	TMap<uint32, int32> PodRunIndexBySignature;
+
+	// レイアウトの確認用
+	const FField* ChildProperties = nullptr;
+	const FProperty* PropertyLink = nullptr;
+	int32 PropertiesSize = 0;
+};
+
+// プロパティスキーマのキャッシュ
+// ブループリントのコンパイルやクラスの再インスタンス化で無効化される
+class FBlueprintPropertySchemaCache
+{
+public:
+	// 最初の呼び出しはゲームスレッドで行うこと (エディタのデリゲートを登録するため)
+	static FBlueprintPropertySchemaCache& Get();
+
+	// スキーマを取得する (ワーカースレッドから呼べる)
+	TSharedRef<const FBlueprintPropertySchema> FindOrAdd(const UStruct* Struct);
+
+	void Invalidate(const UStruct* Struct);
+	void InvalidateAll();
+
+private:
+	FBlueprintPropertySchemaCache();
+
+	FRWLock Lock;
+	TMap<FObjectKey, TSharedPtr<const FBlueprintPropertySchema>> Schemas;
+};
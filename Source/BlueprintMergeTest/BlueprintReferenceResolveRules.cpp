@@ -0,0 +1,391 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+
+#include "BlueprintReferenceResolveRules.h"
+#include "BlueprintMergeStats.h"
+#include "AssetRegistry/AssetRegistryModule.h"
+#include "Misc/FileHelper.h"
+#include "Misc/Paths.h"
+#include "Serialization/Csv/CsvParser.h"
+#include "UObject/UnrealType.h"
+#include <regex>
+#include <string>
+
+
+struct FBlueprintReferenceResolveRules::FMatcher
+{
+	// 全てのルールを "(A)|(B)|..." にまとめた正規表現
+	std::regex Combined;
+
+	// 結合した正規表現での、ルールごとのキャプチャグループの番号
+	TArray<int32> GroupIndices;
+
+	// ルールごとの正規表現 (複数のルールに一致するアセットの確認用)
+	TArray<std::regex> Individuals;
+
+	// 結合した正規表現を使うか
+	// 結合に失敗した場合は、ルールごとの正規表現で照合する
+	bool bCombined = false;
+};
+
+namespace
+{
+	// パスの先頭が "Members." のルールは、CDO のメンバー変数を対象にする
+	const TCHAR* MembersPrefix = TEXT("Members.");
+
+	// 後方参照 (\1 や \k<Name>) を含むか
+	// 結合するとグループの番号がずれて、別のグループを参照してしまう
+	bool ContainsBackreference(const FString& Pattern)
+	{
+		for (int32 Index = 0; Index + 1 < Pattern.Len(); ++Index)
+		{
+			if (Pattern[Index] != TEXT('\\'))
+			{
+				continue;
+			}
+
+			// エスケープされた文字は読み飛ばす
+			const TCHAR Next = Pattern[++Index];
+			if ((Next >= TEXT('1') && Next <= TEXT('9')) || (Next == TEXT('k') && Index + 1 < Pattern.Len() && Pattern[Index + 1] == TEXT('<')))
+			{
+				return true;
+			}
+		}
+		return false;
+	}
+}
+
+FBlueprintReferenceResolveRules& FBlueprintReferenceResolveRules::Get()
+{
+	static FBlueprintReferenceResolveRules Instance;
+	return Instance;
+}
+
+FBlueprintReferenceResolveRules::FBlueprintReferenceResolveRules()
+{
+	LoadRules(FPaths::ProjectContentDir() / TEXT("DT_ReferenceResolveRules.csv"));
+	CompileRules();
+
+	// アセットの追加・削除・名前の変更で、索引を作り直す
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry")).Get();
+	AssetRegistry.OnAssetAdded().AddLambda([this](const FAssetData&)
+	{
+		InvalidateIndex();
+	});
+	AssetRegistry.OnAssetRemoved().AddLambda([this](const FAssetData&)
+	{
+		InvalidateIndex();
+	});
+	AssetRegistry.OnAssetRenamed().AddLambda([this](const FAssetData&, const FString&)
+	{
+		InvalidateIndex();
+	});
+}
+
+FBlueprintReferenceResolveRules::~FBlueprintReferenceResolveRules() = default;
+
+void FBlueprintReferenceResolveRules::LoadRules(const FString& Filename)
+{
+	FString Content;
+	if (!FFileHelper::LoadFileToString(Content, *Filename))
+	{
+		// ルールがなければ何もしない
+		return;
+	}
+
+	const FCsvParser Parser(Content);
+	const FCsvParser::FRows& Rows = Parser.GetRows();
+	if (Rows.Num() == 0)
+	{
+		return;
+	}
+
+	// 列はヘッダーの名前で探す (先頭の列は行の名前)
+	const int32 PathColumn = Rows[0].IndexOfByPredicate([](const TCHAR* Cell) { return FCString::Stricmp(Cell, TEXT("PropertyPath")) == 0; });
+	const int32 RuleColumn = Rows[0].IndexOfByPredicate([](const TCHAR* Cell) { return FCString::Stricmp(Cell, TEXT("AssetMatchRule")) == 0; });
+	if (PathColumn == INDEX_NONE || RuleColumn == INDEX_NONE)
+	{
+		UE_LOG(LogTemp, Warning, TEXT("Invalid reference resolve rules header. Filename[%s]"), *Filename);
+		return;
+	}
+
+	for (int32 RowIndex = 1; RowIndex < Rows.Num(); ++RowIndex)
+	{
+		const TArray<const TCHAR*>& Row = Rows[RowIndex];
+		if (!Row.IsValidIndex(PathColumn) || !Row.IsValidIndex(RuleColumn))
+		{
+			continue;
+		}
+
+		const FString PropertyPath = Row[PathColumn];
+		const FString Pattern = Row[RuleColumn];
+		if (!PropertyPath.StartsWith(MembersPrefix) || Pattern.IsEmpty())
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Unsupported reference resolve rule. Row[%s] PropertyPath[%s]"), Row[0], *PropertyPath);
+			continue;
+		}
+		if (ContainsBackreference(Pattern))
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Backreferences are not supported in reference resolve rules. Row[%s] Pattern[%s]"), Row[0], *Pattern);
+			continue;
+		}
+
+		FRule& Rule = Rules.AddDefaulted_GetRef();
+		Rule.RowName = FName(Row[0]);
+		Rule.MemberName = FName(PropertyPath.RightChop(FCString::Strlen(MembersPrefix)));
+		Rule.Pattern = Pattern;
+	}
+}
+
+void FBlueprintReferenceResolveRules::CompileRules()
+{
+	if (Rules.IsEmpty())
+	{
+		return;
+	}
+
+	TUniquePtr<FMatcher> NewMatcher = MakeUnique<FMatcher>();
+
+	// ルールごとにコンパイルして確かめ、キャプチャグループの数を数える
+	// 結合した正規表現では、ルールのグループの前に、ルール全体を囲むグループが 1 つ入る
+	std::string CombinedPattern;
+	int32 NextGroupIndex = 1;
+	for (int32 RuleIndex = 0; RuleIndex < Rules.Num(); ++RuleIndex)
+	{
+		const std::string Pattern(TCHAR_TO_UTF8(*Rules[RuleIndex].Pattern));
+		try
+		{
+			NewMatcher->Individuals.Emplace(Pattern, std::regex::ECMAScript | std::regex::optimize);
+		}
+		catch (const std::regex_error&)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("Invalid reference resolve rule pattern. Row[%s] Pattern[%s]"), *Rules[RuleIndex].RowName.ToString(), *Rules[RuleIndex].Pattern);
+			Rules.RemoveAt(RuleIndex--);
+			continue;
+		}
+
+		if (!CombinedPattern.empty())
+		{
+			CombinedPattern += '|';
+		}
+		CombinedPattern += '(';
+		CombinedPattern += Pattern;
+		CombinedPattern += ')';
+
+		NewMatcher->GroupIndices.Add(NextGroupIndex);
+		NextGroupIndex += 1 + static_cast<int32>(NewMatcher->Individuals.Last().mark_count());
+	}
+
+	if (Rules.IsEmpty())
+	{
+		return;
+	}
+
+	try
+	{
+		NewMatcher->Combined.assign(CombinedPattern, std::regex::ECMAScript | std::regex::optimize);
+		NewMatcher->bCombined = true;
+	}
+	catch (const std::regex_error&)
+	{
+		// 個別にはコンパイルできたので、ルールごとの正規表現で照合する
+		UE_LOG(LogTemp, Warning, TEXT("Failed to combine reference resolve rule patterns. Matching each rule separately."));
+	}
+
+	Matcher = MoveTemp(NewMatcher);
+}
+
+void FBlueprintReferenceResolveRules::InvalidateIndex()
+{
+	bIndexBuilt = false;
+}
+
+void FBlueprintReferenceResolveRules::BuildIndex()
+{
+	check(IsInGameThread());
+
+	for (FRule& Rule : Rules)
+	{
+		Rule.Assets.Reset();
+		Rule.AssetSet.Reset();
+	}
+	bIndexBuilt = true;
+
+	if (!Matcher)
+	{
+		return;
+	}
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry")).Get();
+	TArray<FAssetData> Assets;
+	AssetRegistry.GetAllAssets(Assets, true);
+
+	// アセット名ごとに、結合した正規表現を一度だけ照合する
+	TStringBuilder<256> AssetName;
+	std::cmatch Match;
+	for (const FAssetData& Asset : Assets)
+	{
+		AssetName.Reset();
+		Asset.AssetName.AppendString(AssetName);
+		const FTCHARToUTF8 Utf8Name(AssetName.ToString(), AssetName.Len());
+		const char* NameBegin = Utf8Name.Get();
+		const char* NameEnd = NameBegin + Utf8Name.Length();
+
+		int32 FirstRule = 0;
+		if (Matcher->bCombined)
+		{
+			if (!std::regex_match(NameBegin, NameEnd, Match, Matcher->Combined))
+			{
+				continue;
+			}
+
+			// 結合した正規表現は、全体が一致する最初のルールのグループに一致する
+			// 後ろのルールにも一致することがあるので、一致したアセットに限って個別に確かめる
+			while (!Match[Matcher->GroupIndices[FirstRule]].matched)
+			{
+				++FirstRule;
+			}
+		}
+		else
+		{
+			while (FirstRule < Rules.Num() && !std::regex_match(NameBegin, NameEnd, Matcher->Individuals[FirstRule]))
+			{
+				++FirstRule;
+			}
+			if (FirstRule == Rules.Num())
+			{
+				continue;
+			}
+		}
+
+		const FCandidate Candidate{ Asset.GetSoftObjectPath(), Asset.AssetClassPath };
+		for (int32 RuleIndex = FirstRule; RuleIndex < Rules.Num(); ++RuleIndex)
+		{
+			if (RuleIndex == FirstRule || std::regex_match(NameBegin, NameEnd, Matcher->Individuals[RuleIndex]))
+			{
+				Rules[RuleIndex].Assets.Add(Candidate);
+				Rules[RuleIndex].AssetSet.Add(Candidate.Path);
+			}
+		}
+	}
+
+	for (FRule& Rule : Rules)
+	{
+		Rule.Assets.Sort([](const FCandidate& A, const FCandidate& B)
+		{
+			return A.Path.LexicalLess(B.Path);
+		});
+	}
+}
+
+bool FBlueprintReferenceResolveRules::IsBrokenReference(const FObjectPropertyBase* Property, const void* Value, const FSoftObjectPath& CurrentPath)
+{
+	if (!Property->IsA<FSoftObjectProperty>())
+	{
+		// ハード参照は読み込まれているので、破棄されたオブジェクトだけが壊れている
+		const UObject* Current = Property->GetObjectPropertyValue(Value);
+		return Current && !IsValid(Current);
+	}
+
+	if (CurrentPath.IsNull() || CurrentPath.ResolveObject())
+	{
+		return false;
+	}
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry")).Get();
+	return !AssetRegistry.GetAssetByObjectPath(CurrentPath).IsValid();
+}
+
+int32 FBlueprintReferenceResolveRules::ResolveMemberReferences(UObject* Object, const TSet<FName>& AppliedMembers)
+{
+	check(IsInGameThread());
+
+	if (!Object || Rules.IsEmpty())
+	{
+		return 0;
+	}
+
+	BLUEPRINT_MERGE_SCOPE(ResolveReferences);
+
+	if (!bIndexBuilt)
+	{
+		BuildIndex();
+	}
+
+	IAssetRegistry& AssetRegistry = FModuleManager::LoadModuleChecked<FAssetRegistryModule>(FName("AssetRegistry")).Get();
+
+	int32 NumResolved = 0;
+	for (const FRule& Rule : Rules)
+	{
+		FObjectPropertyBase* Property = FindFProperty<FObjectPropertyBase>(Object->GetClass(), Rule.MemberName);
+		if (!Property)
+		{
+			continue;
+		}
+
+		void* Value = Property->ContainerPtrToValuePtr<void>(Object);
+
+		// ソフト参照は読み込まずにパスで確かめる
+		FSoftObjectPath CurrentPath;
+		if (Property->IsA<FSoftObjectProperty>())
+		{
+			CurrentPath = static_cast<const FSoftObjectPtr*>(Value)->ToSoftObjectPath();
+		}
+		else if (UObject* Current = Property->GetObjectPropertyValue(Value))
+		{
+			CurrentPath = FSoftObjectPath(Current);
+		}
+
+		if (CurrentPath.IsNull())
+		{
+			// 空の参照は意図したものとして残す
+			continue;
+		}
+
+		if (!AppliedMembers.Contains(Rule.MemberName) && !IsBrokenReference(Property, Value, CurrentPath))
+		{
+			// マージで変えていないメンバー変数は、参照が壊れていなければ触らない
+			continue;
+		}
+
+		if (Rule.AssetSet.Contains(CurrentPath))
+		{
+			// ルールに一致するアセットを参照している
+			continue;
+		}
+
+		// メンバー変数の型の派生クラス (ブループリントのクラスを含む) を、アセットレジストリから集める
+		TSet<FTopLevelAssetPath> AllowedClasses;
+		AssetRegistry.GetDerivedClassNames({ Property->PropertyClass->GetClassPathName() }, {}, AllowedClasses);
+		AllowedClasses.Add(Property->PropertyClass->GetClassPathName());
+
+		// 候補が複数ある場合は、パスの順で型が合う先頭のアセットを使う
+		// 型は索引のクラスで確かめ、読み込むのは選んだアセットだけにする
+		UObject* Resolved = nullptr;
+		for (const FCandidate& Candidate : Rule.Assets)
+		{
+			if (!AllowedClasses.Contains(Candidate.ClassPath))
+			{
+				continue;
+			}
+
+			UObject* Asset = Candidate.Path.TryLoad();
+			if (Asset && Asset->IsA(Property->PropertyClass))
+			{
+				Resolved = Asset;
+				break;
+			}
+		}
+
+		if (!Resolved)
+		{
+			UE_LOG(LogTemp, Warning, TEXT("No asset matches reference resolve rule. Row[%s] Member[%s] Pattern[%s]"), *Rule.RowName.ToString(), *Rule.MemberName.ToString(), *Rule.Pattern);
+			continue;
+		}
+
+		Property->SetObjectPropertyValue(Value, Resolved);
+		++NumResolved;
+		UE_LOG(LogTemp, Display, TEXT("Resolved reference. Member[%s] From[%s] To[%s]"), *Rule.MemberName.ToString(), *CurrentPath.ToString(), *Resolved->GetPathName());
+	}
+	return NumResolved;
+}
@@ -0,0 +1,83 @@
+﻿// Fill out your copyright notice in the Description page of Project Settings.
+
+#pragma once
+
+#include "CoreMinimal.h"
+#include "UObject/SoftObjectPath.h"
+
+class FObjectPropertyBase;
+
+// アセット参照の解決ルール (Content/DT_ReferenceResolveRules.csv)
+// マージで差分を反映したメンバー変数が、ルールのパターンに一致しないアセットを参照している場合や、
+// 参照先のアセットが存在しない場合に、一致するアセットへ参照を付け替える
+// 参照が空のメンバー変数は付け替えない
+//
+// 全てのルールのパターンは 1 つの正規表現にまとめてコンパイルし、
+// アセットレジストリから名前の索引を作るときに、アセットごとに一度だけ照合する
+// 参照の解決は索引を引くだけで、正規表現は実行しない
+// 結合するとグループの番号がずれるので、後方参照を含むルールは読み込まない
+class FBlueprintReferenceResolveRules
+{
+public:
+	// 最初の呼び出しでルールを読み込む (ゲームスレッドで呼ぶ)
+	static FBlueprintReferenceResolveRules& Get();
+
+	~FBlueprintReferenceResolveRules();
+
+	FBlueprintReferenceResolveRules(const FBlueprintReferenceResolveRules&) = delete;
+	FBlueprintReferenceResolveRules& operator=(const FBlueprintReferenceResolveRules&) = delete;
+
+	// Object のメンバー変数の参照をルールに従って付け替え、付け替えた数を返す (ゲームスレッドで呼ぶ)
+	// AppliedMembers はマージで差分を反映したメンバー変数で、それ以外は参照が壊れている場合だけ付け替える
+	int32 ResolveMemberReferences(UObject* Object, const TSet<FName>& AppliedMembers);
+
+	// アセットの索引を破棄する (次の解決で作り直す)
+	void InvalidateIndex();
+
+	int32 NumRules() const
+	{
+		return Rules.Num();
+	}
+
+private:
+	FBlueprintReferenceResolveRules();
+
+	// ルールに一致したアセット
+	struct FCandidate
+	{
+		FSoftObjectPath Path;
+
+		// 読み込まずに型を確かめるための、アセットのクラス
+		FTopLevelAssetPath ClassPath;
+	};
+
+	struct FRule
+	{
+		// テーブルの行の名前
+		FName RowName;
+
+		// 参照を付け替えるメンバー変数 (PropertyPath の "Members." の後ろ)
+		FName MemberName;
+
+		FString Pattern;
+
+		// 一致したアセット (パスの順)
+		TArray<FCandidate> Assets;
+		TSet<FSoftObjectPath> AssetSet;
+	};
+
+	void LoadRules(const FString& Filename);
+	void CompileRules();
+	void BuildIndex();
+
+	// 参照先のアセットが存在しないか
+	static bool IsBrokenReference(const FObjectPropertyBase* Property, const void* Value, const FSoftObjectPath& CurrentPath);
+
+	TArray<FRule> Rules;
+
+	// 結合した正規表現 (<regex> をヘッダーに出さないため、実装側で定義する)
+	struct FMatcher;
+	TUniquePtr<FMatcher> Matcher;
+
+	bool bIndexBuilt = false;
+};
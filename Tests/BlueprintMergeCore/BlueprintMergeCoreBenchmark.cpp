@@ -0,0 +1,198 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// BlueprintMergeCore.h / BlueprintMergeSequence.h の計測
+// 要素数と変更の割合を変えて、判定と並びのマージの時間を出力する
+//
+// BlueprintMergeCoreBenchmark [Elements=10000] [EditRatio=0.01] [Iterations=20] [Seed=0]
+
+#include "BlueprintMergeCore.h"
+#include "BlueprintMergeSequence.h"
+
+#include <chrono>
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <vector>
+
+using namespace BlueprintMerge::Core;
+
+namespace
+{
+	struct FBenchmarkConfig
+	{
+		std::int32_t NumElements = 10000;
+		double EditRatio = 0.01;
+		std::int32_t NumIterations = 20;
+		std::uint32_t Seed = 0;
+	};
+
+	using FClock = std::chrono::steady_clock;
+
+	double ToMilliseconds(FClock::duration Duration)
+	{
+		return std::chrono::duration<double, std::milli>(Duration).count();
+	}
+
+	// Base に削除・追加・移動を加えた並びを作る
+	std::vector<std::uint32_t> MakeEditedSequence(const std::vector<std::uint32_t>& Base, double EditRatio, std::uint32_t& InOutNextValue, std::mt19937& Random)
+	{
+		std::vector<std::uint32_t> Result = Base;
+		const std::int32_t NumEdits = static_cast<std::int32_t>(Base.size() * EditRatio);
+		for (std::int32_t Edit = 0; Edit < NumEdits && !Result.empty(); ++Edit)
+		{
+			std::uniform_int_distribution<std::size_t> IndexDistribution(0, Result.size() - 1);
+			const std::size_t Index = IndexDistribution(Random);
+			switch (Edit % 3)
+			{
+			case 0:
+				Result.erase(Result.begin() + Index);
+				break;
+			case 1:
+				Result.insert(Result.begin() + Index, InOutNextValue++);
+				break;
+			default:
+			{
+				const std::uint32_t Value = Result[Index];
+				Result.erase(Result.begin() + Index);
+				Result.insert(Result.begin() + IndexDistribution(Random) % (Result.size() + 1), Value);
+				break;
+			}
+			}
+		}
+		return Result;
+	}
+
+	void RunSequenceBenchmark(const FBenchmarkConfig& Config)
+	{
+		std::mt19937 Random(Config.Seed);
+
+		std::vector<std::uint32_t> Base(Config.NumElements);
+		for (std::int32_t Index = 0; Index < Config.NumElements; ++Index)
+		{
+			Base[Index] = static_cast<std::uint32_t>(Index);
+		}
+
+		std::uint32_t NextValue = static_cast<std::uint32_t>(Config.NumElements);
+		const std::vector<std::uint32_t> Left = MakeEditedSequence(Base, Config.EditRatio, NextValue, Random);
+		const std::vector<std::uint32_t> Right = MakeEditedSequence(Base, Config.EditRatio, NextValue, Random);
+
+		FSequenceDiff LeftDiff;
+		FSequenceDiff RightDiff;
+		FSequenceMergeResult MergeResult;
+		FClock::duration DiffTime{};
+		FClock::duration MergeTime{};
+		bool bDiffSucceeded = true;
+		for (std::int32_t Iteration = 0; Iteration < Config.NumIterations; ++Iteration)
+		{
+			const FClock::time_point DiffStart = FClock::now();
+			bDiffSucceeded &= DiffSequences(Base.data(), static_cast<std::int32_t>(Base.size()), Left.data(), static_cast<std::int32_t>(Left.size()),
+				[&](std::int32_t BaseIndex, std::int32_t OtherIndex) { return Base[BaseIndex] == Left[OtherIndex]; }, LeftDiff, Config.NumElements);
+			bDiffSucceeded &= DiffSequences(Base.data(), static_cast<std::int32_t>(Base.size()), Right.data(), static_cast<std::int32_t>(Right.size()),
+				[&](std::int32_t BaseIndex, std::int32_t OtherIndex) { return Base[BaseIndex] == Right[OtherIndex]; }, RightDiff, Config.NumElements);
+			const FClock::time_point MergeStart = FClock::now();
+			MergeSequences(static_cast<std::int32_t>(Base.size()), static_cast<std::int32_t>(Left.size()), static_cast<std::int32_t>(Right.size()), LeftDiff, RightDiff,
+				[&](std::int32_t LeftIndex, std::int32_t RightIndex) { return Left[LeftIndex] == Right[RightIndex]; }, MergeResult);
+			const FClock::time_point MergeEnd = FClock::now();
+
+			DiffTime += MergeStart - DiffStart;
+			MergeTime += MergeEnd - MergeStart;
+		}
+
+		if (!bDiffSucceeded)
+		{
+			std::printf("Sequence: diff exceeded the edit distance limit\n");
+			return;
+		}
+
+		std::printf("Sequence: Elements[%d] EditDistance[%d/%d] Moves[%d/%d] Diff[%.3fms] Merge[%.3fms] Items[%zu] Conflict[%d]\n",
+			Config.NumElements,
+			LeftDiff.EditDistance, RightDiff.EditDistance,
+			LeftDiff.NumMoves, RightDiff.NumMoves,
+			ToMilliseconds(DiffTime) / Config.NumIterations,
+			ToMilliseconds(MergeTime) / Config.NumIterations,
+			MergeResult.Items.size(),
+			MergeResult.bConflict ? 1 : 0);
+	}
+
+	void RunClassifyBenchmark(const FBenchmarkConfig& Config)
+	{
+		// 各項目の有無と変更をランダムに決めて、判定だけを繰り返す
+		std::mt19937 Random(Config.Seed);
+		std::bernoulli_distribution Edited(Config.EditRatio);
+
+		struct FItem
+		{
+			bool bInBase;
+			bool bInLeft;
+			bool bInRight;
+			bool bLeftModified;
+			bool bRightModified;
+			bool bSameChange;
+		};
+
+		std::vector<FItem> Items(Config.NumElements);
+		for (FItem& Item : Items)
+		{
+			Item.bInBase = !Edited(Random);
+			Item.bInLeft = !Edited(Random);
+			Item.bInRight = !Edited(Random);
+			Item.bLeftModified = Edited(Random);
+			Item.bRightModified = Edited(Random);
+			Item.bSameChange = Edited(Random);
+		}
+
+		std::int32_t NumChanges = 0;
+		std::int32_t NumConflicts = 0;
+		const FClock::time_point Start = FClock::now();
+		for (std::int32_t Iteration = 0; Iteration < Config.NumIterations; ++Iteration)
+		{
+			for (const FItem& Item : Items)
+			{
+				const FDecision Decision = ClassifyThreeWay(Item.bInBase, Item.bInLeft, Item.bInRight,
+					[&Item]() { return Item.bLeftModified; },
+					[&Item]() { return Item.bRightModified; },
+					[&Item]() { return Item.bSameChange; });
+				NumChanges += Decision.HasChange() ? 1 : 0;
+				NumConflicts += Decision.IsConflict() ? 1 : 0;
+			}
+		}
+		const FClock::duration Time = FClock::now() - Start;
+
+		std::printf("Classify: Items[%d] Changes[%d] Conflicts[%d] Time[%.3fms]\n",
+			Config.NumElements,
+			NumChanges / Config.NumIterations,
+			NumConflicts / Config.NumIterations,
+			ToMilliseconds(Time) / Config.NumIterations);
+	}
+}
+
+int main(int Argc, char** Argv)
+{
+	FBenchmarkConfig Config;
+	if (Argc > 1)
+	{
+		Config.NumElements = std::atoi(Argv[1]);
+	}
+	if (Argc > 2)
+	{
+		Config.EditRatio = std::atof(Argv[2]);
+	}
+	if (Argc > 3)
+	{
+		Config.NumIterations = std::atoi(Argv[3]);
+	}
+	if (Argc > 4)
+	{
+		Config.Seed = static_cast<std::uint32_t>(std::strtoul(Argv[4], nullptr, 10));
+	}
+
+	if (Config.NumElements <= 0 || Config.NumIterations <= 0)
+	{
+		std::fprintf(stderr, "Usage: BlueprintMergeCoreBenchmark [Elements] [EditRatio] [Iterations] [Seed]\n");
+		return 1;
+	}
+
+	RunClassifyBenchmark(Config);
+	RunSequenceBenchmark(Config);
+	return 0;
+}
@@ -0,0 +1,346 @@
+// Fill out your copyright notice in the Description page of Project Settings.
+
+// BlueprintMergeCore.h / BlueprintMergeSequence.h のテスト
+// 失敗した検査を全て出力し、1 つでも失敗すれば 1 を返す
+
+#include "BlueprintMergeCore.h"
+#include "BlueprintMergeSequence.h"
+
+#include <cstdio>
+#include <vector>
+
+using namespace BlueprintMerge::Core;
+
+namespace
+{
+	int NumFailures = 0;
+
+	void Check(bool bCondition, const char* Expression, const char* File, int Line)
+	{
+		if (!bCondition)
+		{
+			std::fprintf(stderr, "%s(%d): Check failed: %s\n", File, Line, Expression);
+			++NumFailures;
+		}
+	}
+
+#define CHECK(Expression) Check(!!(Expression), #Expression, __FILE__, __LINE__)
+
+	// 呼ばれた回数を数える比較
+	struct FCountedResult
+	{
+		bool bResult = false;
+		int NumCalls = 0;
+
+		bool operator()()
+		{
+			++NumCalls;
+			return bResult;
+		}
+	};
+
+	// ---------------------------------------------------------------------
+	// ClassifyThreeWay
+
+	void TestClassifyNoChange()
+	{
+		FCountedResult LeftModified{ false };
+		FCountedResult RightModified{ false };
+		FCountedResult SameChange{ true };
+		const FDecision Decision = ClassifyThreeWay(true, true, true, LeftModified, RightModified, SameChange);
+
+		CHECK(Decision.Change == EChange::None);
+		CHECK(!Decision.HasChange());
+		CHECK(SameChange.NumCalls == 0);
+	}
+
+	void TestClassifyOneSidedModify()
+	{
+		FCountedResult SameChange{ true };
+		const FDecision Decision = ClassifyThreeWay(true, true, true, FCountedResult{ false }, FCountedResult{ true }, SameChange);
+
+		CHECK(Decision.Change == EChange::Modify);
+		CHECK(!Decision.bLeftChanged);
+		CHECK(Decision.bRightChanged);
+		CHECK(!Decision.IsConflict());
+		CHECK(SameChange.NumCalls == 0);
+	}
+
+	void TestClassifyRemoveVersusModify()
+	{
+		// 既定では、片側の削除ともう片側の変更はコンフリクト
+		{
+			FCountedResult RightModified{ true };
+			const FDecision Decision = ClassifyThreeWay(true, false, true, FCountedResult{ true }, RightModified, FNever());
+			CHECK(Decision.Change == EChange::Remove);
+			CHECK(Decision.IsConflict());
+			CHECK(RightModified.NumCalls == 1);
+		}
+
+		// 削除した側の変更は調べない
+		{
+			FCountedResult LeftModified{ true };
+			const FDecision Decision = ClassifyThreeWay(true, false, true, LeftModified, FCountedResult{ false }, FNever());
+			CHECK(Decision.Change == EChange::Remove);
+			CHECK(Decision.bLeftChanged);
+			CHECK(!Decision.bRightChanged);
+			CHECK(LeftModified.NumCalls == 0);
+		}
+
+		// 削除を優先する場合は、もう片側の変更を比べずに削除を反映する
+		{
+			FClassifyOptions Options;
+			Options.bRemoveConflictsWithModify = false;
+
+			FCountedResult LeftModified{ true };
+			const FDecision Decision = ClassifyThreeWay(true, true, false, LeftModified, FCountedResult{ true }, FNever(), Options);
+			CHECK(Decision.Change == EChange::Remove);
+			CHECK(!Decision.bLeftChanged);
+			CHECK(Decision.bRightChanged);
+			CHECK(LeftModified.NumCalls == 0);
+		}
+	}
+
+	void TestClassifySameChange()
+	{
+		// 両側が同じ変更をした場合は、片側だけを反映する
+		{
+			FCountedResult SameChange{ true };
+			const FDecision Decision = ClassifyThreeWay(true, true, true, FCountedResult{ true }, FCountedResult{ true }, SameChange);
+			CHECK(Decision.Change == EChange::Modify);
+			CHECK(Decision.bLeftChanged);
+			CHECK(!Decision.bRightChanged);
+			CHECK(SameChange.NumCalls == 1);
+		}
+
+		// 異なる変更はコンフリクト
+		{
+			const FDecision Decision = ClassifyThreeWay(true, true, true, FCountedResult{ true }, FCountedResult{ true }, FCountedResult{ false });
+			CHECK(Decision.Change == EChange::Modify);
+			CHECK(Decision.IsConflict());
+		}
+
+		// 両側で削除した場合は、内容を比べずに同じ変更とみなす
+		{
+			FCountedResult SameChange{ false };
+			const FDecision Decision = ClassifyThreeWay(true, false, false, FCountedResult{ true }, FCountedResult{ true }, SameChange);
+			CHECK(Decision.Change == EChange::Remove);
+			CHECK(Decision.bLeftChanged);
+			CHECK(!Decision.bRightChanged);
+			CHECK(SameChange.NumCalls == 0);
+		}
+	}
+
+	void TestClassifyAddAdd()
+	{
+		// 片側だけの追加は、Base との比較をしない
+		{
+			FCountedResult LeftModified{ true };
+			const FDecision Decision = ClassifyThreeWay(false, true, false, LeftModified, FCountedResult{ true }, FNever());
+			CHECK(Decision.Change == EChange::Add);
+			CHECK(Decision.bLeftChanged);
+			CHECK(!Decision.bRightChanged);
+			CHECK(LeftModified.NumCalls == 0);
+		}
+
+		// 両側で同じ項目を追加した
+		{
+			const FDecision Decision = ClassifyThreeWay(false, true, true, FCountedResult{ true }, FCountedResult{ true }, FCountedResult{ true });
+			CHECK(Decision.Change == EChange::Add);
+			CHECK(Decision.bLeftChanged);
+			CHECK(!Decision.IsConflict());
+		}
+
+		// 両側で同じキーに異なる項目を追加した
+		{
+			const FDecision Decision = ClassifyThreeWay(false, true, true, FCountedResult{ true }, FCountedResult{ true }, FCountedResult{ false });
+			CHECK(Decision.Change == EChange::Add);
+			CHECK(Decision.IsConflict());
+		}
+
+		// どこにもない項目
+		{
+			const FDecision Decision = ClassifyThreeWay(false, false, false, FNever(), FNever(), FNever());
+			CHECK(Decision.Change == EChange::None);
+			CHECK(!Decision.HasChange());
+		}
+	}
+
+	// ---------------------------------------------------------------------
+	// DiffSequences / MergeSequences
+
+	// 要素の値をそのままハッシュにする
+	bool Diff(const std::vector<int>& Base, const std::vector<int>& Other, FSequenceDiff& OutDiff, std::int32_t MaxEditDistance = DefaultMaxEditDistance)
+	{
+		std::vector<std::uint32_t> BaseHashes(Base.begin(), Base.end());
+		std::vector<std::uint32_t> OtherHashes(Other.begin(), Other.end());
+		return DiffSequences(BaseHashes.data(), static_cast<std::int32_t>(Base.size()), OtherHashes.data(), static_cast<std::int32_t>(Other.size()),
+			[&](std::int32_t BaseIndex, std::int32_t OtherIndex) { return Base[BaseIndex] == Other[OtherIndex]; },
+			OutDiff, MaxEditDistance);
+	}
+
+	struct FMergedSequence
+	{
+		std::vector<int> Values;
+		FSequenceMergeResult Result;
+	};
+
+	FMergedSequence Merge(const std::vector<int>& Base, const std::vector<int>& Left, const std::vector<int>& Right)
+	{
+		FSequenceDiff LeftDiff;
+		FSequenceDiff RightDiff;
+		CHECK(Diff(Base, Left, LeftDiff));
+		CHECK(Diff(Base, Right, RightDiff));
+
+		FMergedSequence Merged;
+		MergeSequences(static_cast<std::int32_t>(Base.size()), static_cast<std::int32_t>(Left.size()), static_cast<std::int32_t>(Right.size()), LeftDiff, RightDiff,
+			[&](std::int32_t LeftIndex, std::int32_t RightIndex) { return Left[LeftIndex] == Right[RightIndex]; },
+			Merged.Result);
+
+		for (const FSequenceItem& Item : Merged.Result.Items)
+		{
+			const std::vector<int>& Source = Item.Side == ESequenceSide::Left ? Left : (Item.Side == ESequenceSide::Right ? Right : Base);
+			Merged.Values.push_back(Source[Item.Index]);
+		}
+		return Merged;
+	}
+
+	void TestDiffSequences()
+	{
+		// 同じ並び
+		{
+			FSequenceDiff SequenceDiff;
+			CHECK(Diff({ 1, 2, 3 }, { 1, 2, 3 }, SequenceDiff));
+			CHECK(SequenceDiff.EditDistance == 0);
+			CHECK(SequenceDiff.NumMoves == 0);
+			CHECK((SequenceDiff.BaseToOther == std::vector<std::int32_t>{ 0, 1, 2 }));
+		}
+
+		// 削除と追加
+		{
+			FSequenceDiff SequenceDiff;
+			CHECK(Diff({ 1, 2, 3, 4 }, { 1, 3, 4, 5 }, SequenceDiff));
+			CHECK(SequenceDiff.EditDistance == 2);
+			CHECK(SequenceDiff.NumMoves == 0);
+			CHECK(SequenceDiff.IsDeleted(1));
+			CHECK((SequenceDiff.BaseToOther == std::vector<std::int32_t>{ 0, -1, 1, 2 }));
+			CHECK(SequenceDiff.OtherToBase[3] == -1);
+		}
+
+		// 移動は、同じ内容の削除と追加の組として記録する
+		{
+			FSequenceDiff SequenceDiff;
+			CHECK(Diff({ 1, 2, 3, 4, 5 }, { 1, 3, 4, 5, 2 }, SequenceDiff));
+			CHECK(SequenceDiff.NumMoves == 1);
+			CHECK(SequenceDiff.BaseMovedTo[1] == 4);
+			CHECK(SequenceDiff.OtherMovedFrom[4] == 1);
+			CHECK(!SequenceDiff.IsDeleted(1));
+		}
+
+		// 編集距離が上限を超えた場合は諦める
+		{
+			FSequenceDiff SequenceDiff;
+			CHECK(!Diff({ 1, 2, 3, 4 }, { 5, 6, 7, 8 }, SequenceDiff, 3));
+			CHECK(Diff({ 1, 2, 3, 4 }, { 5, 6, 7, 8 }, SequenceDiff, 8));
+			CHECK(SequenceDiff.EditDistance == 8);
+		}
+	}
+
+	void TestMergeOneSidedMove()
+	{
+		const FMergedSequence Merged = Merge({ 1, 2, 3, 4, 5 }, { 1, 3, 4, 5, 2 }, { 1, 2, 3, 4, 5 });
+		CHECK((Merged.Values == std::vector<int>{ 1, 3, 4, 5, 2 }));
+		CHECK(Merged.Result.bLeftChanged);
+		CHECK(!Merged.Result.bRightChanged);
+		CHECK(!Merged.Result.bConflict);
+	}
+
+	void TestMergeMoveAndInsert()
+	{
+		// Left は末尾の要素を先頭に移動し、Right は途中に追加した
+		const FMergedSequence Merged = Merge({ 1, 2, 3, 4, 5 }, { 5, 1, 2, 3, 4 }, { 1, 2, 3, 9, 4, 5 });
+		CHECK((Merged.Values == std::vector<int>{ 5, 1, 2, 3, 9, 4 }));
+		CHECK(!Merged.Result.bConflict);
+	}
+
+	void TestMergeDeleteVersusMove()
+	{
+		// 移動した要素をもう片側が削除した場合は、削除を優先する
+		{
+			const FMergedSequence Merged = Merge({ 1, 2, 3, 4 }, { 2, 3, 4, 1 }, { 2, 3, 4 });
+			CHECK((Merged.Values == std::vector<int>{ 2, 3, 4 }));
+			CHECK(!Merged.Result.bConflict);
+		}
+
+		// 左右を入れ替えても同じ
+		{
+			const FMergedSequence Merged = Merge({ 1, 2, 3, 4 }, { 2, 3, 4 }, { 2, 3, 4, 1 });
+			CHECK((Merged.Values == std::vector<int>{ 2, 3, 4 }));
+			CHECK(!Merged.Result.bConflict);
+		}
+	}
+
+	void TestMergeConflictingMoves()
+	{
+		// 両側が同じ要素を別々の位置に移動した
+		const FMergedSequence Merged = Merge({ 1, 2, 3, 4, 5 }, { 2, 3, 4, 5, 1 }, { 2, 3, 1, 4, 5 });
+		CHECK(Merged.Result.bConflict);
+	}
+
+	void TestMergeBothSidedInserts()
+	{
+		// 同じ位置に同じ要素を追加した場合は、1 つだけ残す
+		{
+			const FMergedSequence Merged = Merge({ 1, 2, 3 }, { 1, 9, 2, 3 }, { 1, 9, 2, 3 });
+			CHECK((Merged.Values == std::vector<int>{ 1, 9, 2, 3 }));
+			CHECK(Merged.Result.bLeftChanged);
+			CHECK(Merged.Result.bRightChanged);
+			CHECK(!Merged.Result.bConflict);
+		}
+
+		// 別々の位置への追加は両方残す
+		{
+			const FMergedSequence Merged = Merge({ 1, 2, 3 }, { 1, 8, 2, 3 }, { 1, 2, 3, 9 });
+			CHECK((Merged.Values == std::vector<int>{ 1, 8, 2, 3, 9 }));
+			CHECK(!Merged.Result.bConflict);
+		}
+
+		// 同じ位置に異なる要素を追加した場合はコンフリクト
+		{
+			const FMergedSequence Merged = Merge({ 1, 2, 3 }, { 1, 8, 2, 3 }, { 1, 9, 2, 3 });
+			CHECK(Merged.Result.bConflict);
+		}
+
+		// 空の Base に両側で追加した
+		{
+			const FMergedSequence Merged = Merge({}, { 1, 2 }, { 1, 2 });
+			CHECK((Merged.Values == std::vector<int>{ 1, 2 }));
+			CHECK(!Merged.Result.bConflict);
+		}
+	}
+}
+
+int main()
+{
+	TestClassifyNoChange();
+	TestClassifyOneSidedModify();
+	TestClassifyRemoveVersusModify();
+	TestClassifySameChange();
+	TestClassifyAddAdd();
+
+	TestDiffSequences();
+	TestMergeOneSidedMove();
+	TestMergeMoveAndInsert();
+	TestMergeDeleteVersusMove();
+	TestMergeConflictingMoves();
+	TestMergeBothSidedInserts();
+
+	if (NumFailures > 0)
+	{
+		std::fprintf(stderr, "%d check(s) failed\n", NumFailures);
+		return 1;
+	}
+
+	std::printf("All checks passed\n");
+	return 0;
+}